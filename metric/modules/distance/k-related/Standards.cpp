@@ -9,7 +9,10 @@ Copyright (c) 2018 Michael Welsch
 #define _METRIC_DISTANCE_K_RELATED_STANDARDS_CPP
 
 #include "Standards.hpp"
+#include "histogram_kernels.hpp"
+#include "simd_kernels.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 namespace metric {
@@ -20,6 +23,9 @@ auto Euclidian<V>::operator()(const Container& a, const Container& b) const ->
     typename std::enable_if<!std::is_same<Container, V>::value, distance_type>::type
 {
     static_assert(std::is_floating_point<value_type>::value, "T must be a float type");
+    if constexpr (simd_kernels::is_dense_of<Container, value_type>) {
+        return std::sqrt(distance_type(simd_kernels::squared_euclidean(a.data(), b.data(), std::min(a.size(), b.size()))));
+    }
     distance_type sum = 0;
     for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end() && it2 != b.end(); ++it1, ++it2) {
         sum += (*it1 - *it2) * (*it1 - *it2);
@@ -36,14 +42,25 @@ auto Euclidian<V>::operator()(const V& a, const V& b) const -> distance_type
     return std::sqrt(sum);
 }
 
+template <typename V>
+auto Euclidian<V>::operator()(const std::vector<int>& a, const std::vector<int>& b) const -> distance_type
+{
+    static_assert(std::is_floating_point<value_type>::value, "T must be a float type");
+    return std::sqrt(distance_type(histogram_kernels::squared_euclidean(a.data(), b.data(), std::min(a.size(), b.size()))));
+}
+
 template <typename V>
 template <typename Container>
 auto Euclidian_thresholded<V>::operator()(const Container& a, const Container& b) const -> distance_type
 {
     static_assert(std::is_floating_point<value_type>::value, "T must be a float type");
     distance_type sum = 0;
-    for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end() || it2 != b.end(); ++it1, ++it2) {
-        sum += (*it1 - *it2) * (*it1 - *it2);
+    if constexpr (simd_kernels::is_dense_of<Container, value_type>) {
+        sum = simd_kernels::squared_euclidean(a.data(), b.data(), std::min(a.size(), b.size()));
+    } else {
+        for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end() && it2 != b.end(); ++it1, ++it2) {
+            sum += (*it1 - *it2) * (*it1 - *it2);
+        }
     }
     return std::min(thres, value_type(factor * sqrt(sum)));
 }
@@ -53,8 +70,11 @@ template <typename Container>
 auto Manhatten<V>::operator()(const Container& a, const Container& b) const -> distance_type
 {
     static_assert(std::is_floating_point<value_type>::value, "T must be a float type");
+    if constexpr (simd_kernels::is_dense_of<Container, value_type>) {
+        return simd_kernels::manhatten(a.data(), b.data(), std::min(a.size(), b.size()));
+    }
     distance_type sum = 0;
-    for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end() || it2 != b.end(); ++it1, ++it2) {
+    for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end() && it2 != b.end(); ++it1, ++it2) {
         sum += std::abs(*it1 - *it2);
     }
     return sum;
@@ -66,7 +86,7 @@ auto P_norm<V>::operator()(const Container& a, const Container& b) const -> dist
 {
     static_assert(std::is_floating_point<value_type>::value, "T must be a float type");
     distance_type sum = 0;
-    for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end() || it2 != b.end(); ++it1, ++it2) {
+    for (auto it1 = a.begin(), it2 = b.begin(); it1 != a.end() && it2 != b.end(); ++it1, ++it2) {
         sum += std::pow(std::abs(*it1 - *it2), p);
     }
     return std::pow(sum, 1 / p);
@@ -76,8 +96,12 @@ template <typename V>
 template <typename Container>
 auto Cosine<V>::operator()(const Container& A, const Container& B) const -> distance_type
 {
+    if constexpr (simd_kernels::is_dense_of<Container, value_type>) {
+        auto sums = simd_kernels::dot_and_norms(A.data(), B.data(), std::min(A.size(), B.size()));
+        return value_type(sums.dot) / (std::sqrt(value_type(sums.a_sq_norm)) * std::sqrt(value_type(sums.b_sq_norm)));
+    }
     value_type dot = 0, denom_a = 0, denom_b = 0;
-    for (auto it1 = A.begin(), it2 = B.begin(); it1 != A.end() || it2 != B.end(); ++it1, ++it2) {
+    for (auto it1 = A.begin(), it2 = B.begin(); it1 != A.end() && it2 != B.end(); ++it1, ++it2) {
         dot += *it1 * *it2;
         denom_a += *it1 * *it1;
         denom_b += *it2 * *it2;
@@ -85,12 +109,23 @@ auto Cosine<V>::operator()(const Container& A, const Container& B) const -> dist
     return dot / (std::sqrt(denom_a) * std::sqrt(denom_b));
 }
 
+template <typename V>
+auto Cosine<V>::operator()(const std::vector<int>& A, const std::vector<int>& B) const -> distance_type
+{
+    auto sums = histogram_kernels::dot_and_norms(A.data(), B.data(), std::min(A.size(), B.size()));
+    return value_type(sums.dot) / (std::sqrt(value_type(sums.a_sq_norm)) * std::sqrt(value_type(sums.b_sq_norm)));
+}
+
 template <typename V>
 template <typename Container>
 auto CosineInverted<V>::operator()(const Container& A, const Container& B) const -> distance_type
 {
+    if constexpr (simd_kernels::is_dense_of<Container, value_type>) {
+        auto sums = simd_kernels::dot_and_norms(A.data(), B.data(), std::min(A.size(), B.size()));
+        return std::abs(1 - value_type(sums.dot) / (std::sqrt(value_type(sums.a_sq_norm)) * std::sqrt(value_type(sums.b_sq_norm))));
+    }
     value_type dot = 0, denom_a = 0, denom_b = 0;
-    for (auto it1 = A.begin(), it2 = B.begin(); it1 != A.end() || it2 != B.end(); ++it1, ++it2) {
+    for (auto it1 = A.begin(), it2 = B.begin(); it1 != A.end() && it2 != B.end(); ++it1, ++it2) {
         dot += *it1 * *it2;
         denom_a += *it1 * *it1;
         denom_b += *it2 * *it2;
@@ -102,8 +137,11 @@ template <typename V>
 template <typename Container>
 V Chebyshev<V>::operator()(const Container& lhs, const Container& rhs) const
 {
+    if constexpr (simd_kernels::is_dense<Container>) {
+        return simd_kernels::chebyshev(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()));
+    }
     distance_type res = 0;
-    for (std::size_t i = 0; i < lhs.size(); i++) {
+    for (std::size_t i = 0; i < std::min<std::size_t>(lhs.size(), rhs.size()); i++) {
         auto m = std::abs(lhs[i] - rhs[i]);
         if (m > res)
             res = m;
@@ -111,5 +149,16 @@ V Chebyshev<V>::operator()(const Container& lhs, const Container& rhs) const
     return res;
 }
 
+template <typename Metric, typename Container>
+std::vector<typename Metric::distance_type> distance(const Metric& metric, const Container& one, const std::vector<Container>& many)
+{
+    std::vector<typename Metric::distance_type> distances;
+    distances.reserve(many.size());
+    for (const auto& record : many) {
+        distances.push_back(metric(one, record));
+    }
+    return distances;
+}
+
 }  // namespace metric
 #endif
@@ -8,6 +8,8 @@ Copyright (c) 2018 Michael Welsch
 #ifndef _METRIC_DISTANCE_K_RELATED_STANDARDS_HPP
 #define _METRIC_DISTANCE_K_RELATED_STANDARDS_HPP
 
+#include <vector>
+
 namespace metric {
 
 /**
@@ -42,6 +44,15 @@ struct Euclidian {
      */
 
     distance_type operator()(const V& a, const V& b) const;
+
+    /**
+     * @brief Calculate Euclidian distance of integer histograms by the exact integer kernel
+     *
+     * @param a first histogram
+     * @param b second histogram
+     * @return euclidian distance between a and b
+     */
+    distance_type operator()(const std::vector<int>& a, const std::vector<int>& b) const;
 };
 
 /**
@@ -164,6 +175,15 @@ struct Cosine {
      */
     template <typename Container>
     distance_type operator()(const Container& a, const Container& b) const;
+
+    /**
+     * @brief calculate cosine similariy of integer histograms by the exact integer kernel
+     *
+     * @param a first histogram
+     * @param b second histogram
+     * @return cosine similarity between a and b
+     */
+    distance_type operator()(const std::vector<int>& a, const std::vector<int>& b) const;
 };
 
 /**
@@ -213,6 +233,17 @@ struct Chebyshev {
     distance_type operator()(const Container& lhs, const Container& rhs) const;
 };
 
+/**
+ * @brief Calculate distances from one record to the each of many, f.e. from a point to all the centroids
+ *
+ * @param metric any metric of the records
+ * @param one record
+ * @param many records
+ * @return distances in the order of many
+ */
+template <typename Metric, typename Container>
+std::vector<typename Metric::distance_type> distance(const Metric& metric, const Container& one, const std::vector<Container>& many);
+
 }  // namespace metric
 
 #include "Standards.cpp"
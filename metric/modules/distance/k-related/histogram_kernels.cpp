@@ -0,0 +1,166 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+#ifndef _METRIC_DISTANCE_K_RELATED_HISTOGRAM_KERNELS_CPP
+#define _METRIC_DISTANCE_K_RELATED_HISTOGRAM_KERNELS_CPP
+
+#include "histogram_kernels.hpp"
+#include "simd_kernels.hpp"
+
+#if defined(METRIC_HISTOGRAM_KERNELS_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace metric {
+
+namespace histogram_kernels {
+
+    namespace details {
+
+        inline std::int64_t squared_euclidean_scalar(const int* a, const int* b, std::size_t size)
+        {
+            std::int64_t sum = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                std::int64_t delta = std::int64_t(a[i]) - b[i];
+                sum += delta * delta;
+            }
+            return sum;
+        }
+
+        inline Sums dot_and_norms_scalar(const int* a, const int* b, std::size_t size)
+        {
+            Sums sums;
+            for (std::size_t i = 0; i < size; i++) {
+                sums.dot += std::int64_t(a[i]) * b[i];
+                sums.a_sq_norm += std::int64_t(a[i]) * a[i];
+                sums.b_sq_norm += std::int64_t(b[i]) * b[i];
+            }
+            return sums;
+        }
+
+#if defined(METRIC_HISTOGRAM_KERNELS_AVX2)
+
+        __attribute__((target("avx2"))) inline __m256i add_pairs(__m256i sum, __m256i pairs)
+        {
+            // pmaddwd sums are int32, they are widened before the accumulation
+            sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(pairs)));
+            return _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(pairs, 1)));
+        }
+
+        __attribute__((target("avx2"))) inline std::int64_t horizontal_sum(__m256i sum)
+        {
+            __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            return _mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1);
+        }
+
+        __attribute__((target("avx2"))) inline bool fits(__m256i max_abs, std::uint32_t limit)
+        {
+            // abs of INT_MIN stays negative, unsigned max keeps it as the largest value
+            __m128i half = _mm_max_epu32(_mm256_castsi256_si128(max_abs), _mm256_extracti128_si256(max_abs, 1));
+            half = _mm_max_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+            half = _mm_max_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+            return std::uint32_t(_mm_cvtsi128_si32(half)) <= limit;
+        }
+
+        __attribute__((target("avx2"))) inline bool squared_euclidean_avx2(const int* a, const int* b, std::size_t size, std::int64_t& result)
+        {
+            __m256i sum = _mm256_setzero_si256();
+            __m256i max_abs = _mm256_setzero_si256();
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+                __m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 8));
+                __m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i));
+                __m256i b1 = _mm256_loadu_si256((const __m256i*)(b + i + 8));
+                // values are checked instead of the differences, which could overflow int32
+                max_abs = _mm256_max_epu32(max_abs, _mm256_max_epu32(_mm256_abs_epi32(a0), _mm256_abs_epi32(a1)));
+                max_abs = _mm256_max_epu32(max_abs, _mm256_max_epu32(_mm256_abs_epi32(b0), _mm256_abs_epi32(b1)));
+                __m256i delta0 = _mm256_sub_epi32(a0, b0);
+                __m256i delta1 = _mm256_sub_epi32(a1, b1);
+                // packing mixes the order of the lanes, the sum doesn't depend on it
+                __m256i delta = _mm256_packs_epi32(delta0, delta1);
+                sum = add_pairs(sum, _mm256_madd_epi16(delta, delta));
+            }
+            // differences of the values up to 16383 fit int16
+            if (!fits(max_abs, 16383)) {
+                return false;
+            }
+            result = horizontal_sum(sum) + squared_euclidean_scalar(a + i, b + i, size - i);
+            return true;
+        }
+
+        __attribute__((target("avx2"))) inline bool dot_and_norms_avx2(const int* a, const int* b, std::size_t size, Sums& result)
+        {
+            __m256i dot = _mm256_setzero_si256();
+            __m256i a_sq_norm = _mm256_setzero_si256();
+            __m256i b_sq_norm = _mm256_setzero_si256();
+            __m256i max_abs = _mm256_setzero_si256();
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+                __m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 8));
+                __m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i));
+                __m256i b1 = _mm256_loadu_si256((const __m256i*)(b + i + 8));
+                max_abs = _mm256_max_epu32(max_abs, _mm256_max_epu32(_mm256_abs_epi32(a0), _mm256_abs_epi32(a1)));
+                max_abs = _mm256_max_epu32(max_abs, _mm256_max_epu32(_mm256_abs_epi32(b0), _mm256_abs_epi32(b1)));
+                // both are packed the same way, so the lanes still match
+                __m256i a16 = _mm256_packs_epi32(a0, a1);
+                __m256i b16 = _mm256_packs_epi32(b0, b1);
+                dot = add_pairs(dot, _mm256_madd_epi16(a16, b16));
+                a_sq_norm = add_pairs(a_sq_norm, _mm256_madd_epi16(a16, a16));
+                b_sq_norm = add_pairs(b_sq_norm, _mm256_madd_epi16(b16, b16));
+            }
+            if (!fits(max_abs, 32767)) {
+                return false;
+            }
+            result = dot_and_norms_scalar(a + i, b + i, size - i);
+            result.dot += horizontal_sum(dot);
+            result.a_sq_norm += horizontal_sum(a_sq_norm);
+            result.b_sq_norm += horizontal_sum(b_sq_norm);
+            return true;
+        }
+
+#endif
+
+    }  // namespace details
+
+    inline bool has_avx2()
+    {
+#if defined(METRIC_HISTOGRAM_KERNELS_AVX2)
+        // AVX-512 CPUs have AVX2 too
+        return simd_kernels::level() != simd_kernels::Level::Scalar;
+#else
+        return false;
+#endif
+    }
+
+    inline std::int64_t squared_euclidean(const int* a, const int* b, std::size_t size)
+    {
+#if defined(METRIC_HISTOGRAM_KERNELS_AVX2)
+        std::int64_t result;
+        if (has_avx2() && details::squared_euclidean_avx2(a, b, size, result)) {
+            return result;
+        }
+#endif
+        return details::squared_euclidean_scalar(a, b, size);
+    }
+
+    inline Sums dot_and_norms(const int* a, const int* b, std::size_t size)
+    {
+#if defined(METRIC_HISTOGRAM_KERNELS_AVX2)
+        Sums result;
+        if (has_avx2() && details::dot_and_norms_avx2(a, b, size, result)) {
+            return result;
+        }
+#endif
+        return details::dot_and_norms_scalar(a, b, size);
+    }
+
+}  // namespace histogram_kernels
+
+}  // namespace metric
+#endif
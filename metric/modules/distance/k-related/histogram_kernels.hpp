@@ -0,0 +1,75 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+#ifndef _METRIC_DISTANCE_K_RELATED_HISTOGRAM_KERNELS_HPP
+#define _METRIC_DISTANCE_K_RELATED_HISTOGRAM_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define METRIC_HISTOGRAM_KERNELS_AVX2
+#endif
+
+namespace metric {
+
+/**
+ * @brief Exact integer kernels for the histogram records (std::vector<int> of small counts), used by the
+ * Euclidian and Cosine overloads. Values are narrowed to int16 in the registers and multiplied pairwise by
+ * AVX2 pmaddwd into int64 sums; if some value is too large for int16 products the scalar int64 loop is used,
+ * so the result is always exact. AVX2 is detected at runtime by simd_kernels::level(), the build doesn't need -mavx2.
+ */
+namespace histogram_kernels {
+
+    /**
+     * @brief dot product and squared norms of two histograms
+     */
+    struct Sums {
+        std::int64_t dot = 0;
+        std::int64_t a_sq_norm = 0;
+        std::int64_t b_sq_norm = 0;
+    };
+
+    /**
+     * @brief
+     * @return true if the AVX2 kernels are used on this CPU
+     */
+    bool has_avx2();
+
+    /**
+     * @brief
+     * @return sum of the squared differences of the first size values
+     */
+    std::int64_t squared_euclidean(const int* a, const int* b, std::size_t size);
+
+    Sums dot_and_norms(const int* a, const int* b, std::size_t size);
+
+    namespace details {
+
+        std::int64_t squared_euclidean_scalar(const int* a, const int* b, std::size_t size);
+
+        Sums dot_and_norms_scalar(const int* a, const int* b, std::size_t size);
+
+#if defined(METRIC_HISTOGRAM_KERNELS_AVX2)
+        /**
+         * @brief
+         * @return false if some value doesn't fit int16, result is not valid then
+         */
+        bool squared_euclidean_avx2(const int* a, const int* b, std::size_t size, std::int64_t& result);
+
+        bool dot_and_norms_avx2(const int* a, const int* b, std::size_t size, Sums& result);
+#endif
+
+    }  // namespace details
+
+}  // namespace histogram_kernels
+
+}  // namespace metric
+
+#include "histogram_kernels.cpp"
+
+#endif  // Header Guard
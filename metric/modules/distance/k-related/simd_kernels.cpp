@@ -0,0 +1,335 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+#ifndef _METRIC_DISTANCE_K_RELATED_SIMD_KERNELS_CPP
+#define _METRIC_DISTANCE_K_RELATED_SIMD_KERNELS_CPP
+
+#include "simd_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(METRIC_SIMD_KERNELS_X86)
+#include <immintrin.h>
+#endif
+
+namespace metric {
+
+namespace simd_kernels {
+
+    inline Level level()
+    {
+#if defined(METRIC_SIMD_KERNELS_X86)
+        static const Level detected = __builtin_cpu_supports("avx512f")
+            ? Level::AVX512
+            : (__builtin_cpu_supports("avx2") ? Level::AVX2 : Level::Scalar);
+        return detected;
+#else
+        return Level::Scalar;
+#endif
+    }
+
+    namespace details {
+
+        template <typename T>
+        T squared_euclidean_scalar(const T* a, const T* b, std::size_t size)
+        {
+            T sum = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                sum += (a[i] - b[i]) * (a[i] - b[i]);
+            }
+            return sum;
+        }
+
+        template <typename T>
+        T manhatten_scalar(const T* a, const T* b, std::size_t size)
+        {
+            T sum = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                sum += std::abs(a[i] - b[i]);
+            }
+            return sum;
+        }
+
+        template <typename T>
+        T chebyshev_scalar(const T* a, const T* b, std::size_t size)
+        {
+            T result = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                result = std::max(result, T(std::abs(a[i] - b[i])));
+            }
+            return result;
+        }
+
+        template <typename T>
+        Sums<T> dot_and_norms_scalar(const T* a, const T* b, std::size_t size)
+        {
+            Sums<T> sums;
+            for (std::size_t i = 0; i < size; i++) {
+                sums.dot += a[i] * b[i];
+                sums.a_sq_norm += a[i] * a[i];
+                sums.b_sq_norm += b[i] * b[i];
+            }
+            return sums;
+        }
+
+#if defined(METRIC_SIMD_KERNELS_X86)
+
+        // registers and operations of the each instruction set and type, kernels below are written once over them
+
+        template <typename T>
+        struct Avx2;
+
+        template <>
+        struct Avx2<float> {
+            using Register = __m256;
+            static constexpr std::size_t width = 8;
+
+            __attribute__((target("avx2"))) static Register zero() { return _mm256_setzero_ps(); }
+            __attribute__((target("avx2"))) static Register load(const float* p) { return _mm256_loadu_ps(p); }
+            __attribute__((target("avx2"))) static Register add(Register a, Register b) { return _mm256_add_ps(a, b); }
+            __attribute__((target("avx2"))) static Register sub(Register a, Register b) { return _mm256_sub_ps(a, b); }
+            __attribute__((target("avx2"))) static Register mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+            __attribute__((target("avx2"))) static Register max(Register a, Register b) { return _mm256_max_ps(a, b); }
+            __attribute__((target("avx2"))) static Register abs(Register a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            __attribute__((target("avx2"))) static float sum(Register a)
+            {
+                __m128 half = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+                half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+                half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+                return _mm_cvtss_f32(half);
+            }
+            __attribute__((target("avx2"))) static float maximum(Register a)
+            {
+                __m128 half = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+                half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+                half = _mm_max_ss(half, _mm_shuffle_ps(half, half, 1));
+                return _mm_cvtss_f32(half);
+            }
+        };
+
+        template <>
+        struct Avx2<double> {
+            using Register = __m256d;
+            static constexpr std::size_t width = 4;
+
+            __attribute__((target("avx2"))) static Register zero() { return _mm256_setzero_pd(); }
+            __attribute__((target("avx2"))) static Register load(const double* p) { return _mm256_loadu_pd(p); }
+            __attribute__((target("avx2"))) static Register add(Register a, Register b) { return _mm256_add_pd(a, b); }
+            __attribute__((target("avx2"))) static Register sub(Register a, Register b) { return _mm256_sub_pd(a, b); }
+            __attribute__((target("avx2"))) static Register mul(Register a, Register b) { return _mm256_mul_pd(a, b); }
+            __attribute__((target("avx2"))) static Register max(Register a, Register b) { return _mm256_max_pd(a, b); }
+            __attribute__((target("avx2"))) static Register abs(Register a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+            __attribute__((target("avx2"))) static double sum(Register a)
+            {
+                __m128d half = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+                return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+            }
+            __attribute__((target("avx2"))) static double maximum(Register a)
+            {
+                __m128d half = _mm_max_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+                return _mm_cvtsd_f64(_mm_max_sd(half, _mm_unpackhi_pd(half, half)));
+            }
+        };
+
+        template <typename T>
+        struct Avx512;
+
+        // GCC 12 gives -Wuninitialized for the intrinsics built over _mm512_undefined_* (reduce, extract, cast to
+        // the lower half, unmasked max), the zero masked forms are used instead
+
+        template <>
+        struct Avx512<float> {
+            using Register = __m512;
+            static constexpr std::size_t width = 16;
+
+            __attribute__((target("avx512f"))) static Register zero() { return _mm512_setzero_ps(); }
+            __attribute__((target("avx512f"))) static Register load(const float* p) { return _mm512_loadu_ps(p); }
+            __attribute__((target("avx512f"))) static Register add(Register a, Register b) { return _mm512_add_ps(a, b); }
+            __attribute__((target("avx512f"))) static Register sub(Register a, Register b) { return _mm512_sub_ps(a, b); }
+            __attribute__((target("avx512f"))) static Register mul(Register a, Register b) { return _mm512_mul_ps(a, b); }
+            __attribute__((target("avx512f"))) static Register max(Register a, Register b) { return _mm512_maskz_max_ps(0xFFFF, a, b); }
+            __attribute__((target("avx512f"))) static Register abs(Register a) { return _mm512_abs_ps(a); }
+            __attribute__((target("avx512f"))) static float sum(Register a)
+            {
+                __m512d halves = _mm512_castps_pd(a);
+                __m256 half = _mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, halves, 0)),
+                    _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, halves, 1)));
+                return Avx2<float>::sum(half);
+            }
+            __attribute__((target("avx512f"))) static float maximum(Register a)
+            {
+                __m512d halves = _mm512_castps_pd(a);
+                __m256 half = _mm256_max_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, halves, 0)),
+                    _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, halves, 1)));
+                return Avx2<float>::maximum(half);
+            }
+        };
+
+        template <>
+        struct Avx512<double> {
+            using Register = __m512d;
+            static constexpr std::size_t width = 8;
+
+            __attribute__((target("avx512f"))) static Register zero() { return _mm512_setzero_pd(); }
+            __attribute__((target("avx512f"))) static Register load(const double* p) { return _mm512_loadu_pd(p); }
+            __attribute__((target("avx512f"))) static Register add(Register a, Register b) { return _mm512_add_pd(a, b); }
+            __attribute__((target("avx512f"))) static Register sub(Register a, Register b) { return _mm512_sub_pd(a, b); }
+            __attribute__((target("avx512f"))) static Register mul(Register a, Register b) { return _mm512_mul_pd(a, b); }
+            __attribute__((target("avx512f"))) static Register max(Register a, Register b) { return _mm512_maskz_max_pd(0xFF, a, b); }
+            __attribute__((target("avx512f"))) static Register abs(Register a) { return _mm512_abs_pd(a); }
+            __attribute__((target("avx512f"))) static double sum(Register a)
+            {
+                return Avx2<double>::sum(_mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, a, 0), _mm512_maskz_extractf64x4_pd(0xF, a, 1)));
+            }
+            __attribute__((target("avx512f"))) static double maximum(Register a)
+            {
+                return Avx2<double>::maximum(_mm256_max_pd(_mm512_maskz_extractf64x4_pd(0xF, a, 0), _mm512_maskz_extractf64x4_pd(0xF, a, 1)));
+            }
+        };
+
+        // the same kernels are compiled for the each instruction set, target of the caller has to match the operations
+
+#define METRIC_SIMD_KERNELS_DEFINE(TARGET, SUFFIX, OPS)                                                                   \
+    template <typename T>                                                                                                 \
+    __attribute__((target(TARGET))) T squared_euclidean_##SUFFIX(const T* a, const T* b, std::size_t size)               \
+    {                                                                                                                     \
+        using Ops = OPS<T>;                                                                                               \
+        auto sum = Ops::zero();                                                                                           \
+        std::size_t i = 0;                                                                                                \
+        for (; i + Ops::width <= size; i += Ops::width) {                                                                 \
+            auto delta = Ops::sub(Ops::load(a + i), Ops::load(b + i));                                                    \
+            sum = Ops::add(sum, Ops::mul(delta, delta));                                                                  \
+        }                                                                                                                 \
+        return Ops::sum(sum) + squared_euclidean_scalar(a + i, b + i, size - i);                                          \
+    }                                                                                                                     \
+                                                                                                                          \
+    template <typename T>                                                                                                 \
+    __attribute__((target(TARGET))) T manhatten_##SUFFIX(const T* a, const T* b, std::size_t size)                       \
+    {                                                                                                                     \
+        using Ops = OPS<T>;                                                                                               \
+        auto sum = Ops::zero();                                                                                           \
+        std::size_t i = 0;                                                                                                \
+        for (; i + Ops::width <= size; i += Ops::width) {                                                                 \
+            sum = Ops::add(sum, Ops::abs(Ops::sub(Ops::load(a + i), Ops::load(b + i))));                                  \
+        }                                                                                                                 \
+        return Ops::sum(sum) + manhatten_scalar(a + i, b + i, size - i);                                                  \
+    }                                                                                                                     \
+                                                                                                                          \
+    template <typename T>                                                                                                 \
+    __attribute__((target(TARGET))) T chebyshev_##SUFFIX(const T* a, const T* b, std::size_t size)                       \
+    {                                                                                                                     \
+        using Ops = OPS<T>;                                                                                               \
+        auto result = Ops::zero();                                                                                        \
+        std::size_t i = 0;                                                                                                \
+        for (; i + Ops::width <= size; i += Ops::width) {                                                                 \
+            result = Ops::max(result, Ops::abs(Ops::sub(Ops::load(a + i), Ops::load(b + i))));                           \
+        }                                                                                                                 \
+        return std::max(Ops::maximum(result), chebyshev_scalar(a + i, b + i, size - i));                                 \
+    }                                                                                                                     \
+                                                                                                                          \
+    template <typename T>                                                                                                 \
+    __attribute__((target(TARGET))) Sums<T> dot_and_norms_##SUFFIX(const T* a, const T* b, std::size_t size)             \
+    {                                                                                                                     \
+        using Ops = OPS<T>;                                                                                               \
+        auto dot = Ops::zero();                                                                                           \
+        auto a_sq_norm = Ops::zero();                                                                                     \
+        auto b_sq_norm = Ops::zero();                                                                                     \
+        std::size_t i = 0;                                                                                                \
+        for (; i + Ops::width <= size; i += Ops::width) {                                                                 \
+            auto a_values = Ops::load(a + i);                                                                             \
+            auto b_values = Ops::load(b + i);                                                                             \
+            dot = Ops::add(dot, Ops::mul(a_values, b_values));                                                            \
+            a_sq_norm = Ops::add(a_sq_norm, Ops::mul(a_values, a_values));                                                \
+            b_sq_norm = Ops::add(b_sq_norm, Ops::mul(b_values, b_values));                                                \
+        }                                                                                                                 \
+        auto sums = dot_and_norms_scalar(a + i, b + i, size - i);                                                         \
+        sums.dot += Ops::sum(dot);                                                                                        \
+        sums.a_sq_norm += Ops::sum(a_sq_norm);                                                                            \
+        sums.b_sq_norm += Ops::sum(b_sq_norm);                                                                            \
+        return sums;                                                                                                      \
+    }
+
+        METRIC_SIMD_KERNELS_DEFINE("avx2", avx2, Avx2)
+        METRIC_SIMD_KERNELS_DEFINE("avx512f", avx512, Avx512)
+
+#undef METRIC_SIMD_KERNELS_DEFINE
+
+#endif
+
+    }  // namespace details
+
+    // float and double go to the best kernel of the CPU, the other types to the scalar loop
+
+    template <typename T>
+    T squared_euclidean(const T* a, const T* b, std::size_t size)
+    {
+#if defined(METRIC_SIMD_KERNELS_X86)
+        if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+            if (level() == Level::AVX512) {
+                return details::squared_euclidean_avx512(a, b, size);
+            }
+            if (level() == Level::AVX2) {
+                return details::squared_euclidean_avx2(a, b, size);
+            }
+        }
+#endif
+        return details::squared_euclidean_scalar(a, b, size);
+    }
+
+    template <typename T>
+    T manhatten(const T* a, const T* b, std::size_t size)
+    {
+#if defined(METRIC_SIMD_KERNELS_X86)
+        if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+            if (level() == Level::AVX512) {
+                return details::manhatten_avx512(a, b, size);
+            }
+            if (level() == Level::AVX2) {
+                return details::manhatten_avx2(a, b, size);
+            }
+        }
+#endif
+        return details::manhatten_scalar(a, b, size);
+    }
+
+    template <typename T>
+    T chebyshev(const T* a, const T* b, std::size_t size)
+    {
+#if defined(METRIC_SIMD_KERNELS_X86)
+        if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+            if (level() == Level::AVX512) {
+                return details::chebyshev_avx512(a, b, size);
+            }
+            if (level() == Level::AVX2) {
+                return details::chebyshev_avx2(a, b, size);
+            }
+        }
+#endif
+        return details::chebyshev_scalar(a, b, size);
+    }
+
+    template <typename T>
+    Sums<T> dot_and_norms(const T* a, const T* b, std::size_t size)
+    {
+#if defined(METRIC_SIMD_KERNELS_X86)
+        if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+            if (level() == Level::AVX512) {
+                return details::dot_and_norms_avx512(a, b, size);
+            }
+            if (level() == Level::AVX2) {
+                return details::dot_and_norms_avx2(a, b, size);
+            }
+        }
+#endif
+        return details::dot_and_norms_scalar(a, b, size);
+    }
+
+}  // namespace simd_kernels
+
+}  // namespace metric
+#endif
@@ -0,0 +1,118 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+#ifndef _METRIC_DISTANCE_K_RELATED_SIMD_KERNELS_HPP
+#define _METRIC_DISTANCE_K_RELATED_SIMD_KERNELS_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define METRIC_SIMD_KERNELS_X86
+#endif
+
+namespace metric {
+
+/**
+ * @brief Kernels of the k-related metrics for the dense containers of float and double (std::vector, std::array,
+ * blaze dense vectors: anything with data() and size()). AVX2 and AVX-512 versions are compiled per function,
+ * so the build doesn't need -march, and the best one is chosen at runtime, with the scalar loop for the other CPUs.
+ * Vector kernels sum in a different order than the scalar loop, so results can differ in the last bits.
+ */
+namespace simd_kernels {
+
+    enum class Level { Scalar, AVX2, AVX512 };
+
+    /**
+     * @brief
+     * @return best instruction set of this CPU, detected once
+     */
+    Level level();
+
+    /**
+     * @brief value type of the containers the kernels take, void for the others
+     */
+    template <typename Container, typename = void>
+    struct dense_value {
+        using type = void;
+    };
+
+    template <typename Container>
+    struct dense_value<Container,
+        std::void_t<decltype(std::declval<const Container&>().data()), decltype(std::declval<const Container&>().size())>> {
+        using type = std::remove_cv_t<std::remove_pointer_t<decltype(std::declval<const Container&>().data())>>;
+    };
+
+    template <typename Container>
+    constexpr bool is_dense = std::is_same<typename dense_value<Container>::type, float>::value
+        || std::is_same<typename dense_value<Container>::type, double>::value;
+
+    /**
+     * @brief dense container of exactly T, kernels accumulate in the value type, so the metrics that sum in a wider
+     * type than the values (Euclidian<double> over floats) keep the scalar loop
+     */
+    template <typename Container, typename T>
+    constexpr bool is_dense_of = is_dense<Container> && std::is_same<typename dense_value<Container>::type, T>::value;
+
+    /**
+     * @brief dot product and squared norms of two vectors
+     */
+    template <typename T>
+    struct Sums {
+        T dot = 0;
+        T a_sq_norm = 0;
+        T b_sq_norm = 0;
+    };
+
+    /**
+     * @brief
+     * @return sum of the squared differences of the first size values
+     */
+    template <typename T>
+    T squared_euclidean(const T* a, const T* b, std::size_t size);
+
+    /**
+     * @brief
+     * @return sum of the absolute differences
+     */
+    template <typename T>
+    T manhatten(const T* a, const T* b, std::size_t size);
+
+    /**
+     * @brief
+     * @return max of the absolute differences
+     */
+    template <typename T>
+    T chebyshev(const T* a, const T* b, std::size_t size);
+
+    template <typename T>
+    Sums<T> dot_and_norms(const T* a, const T* b, std::size_t size);
+
+    namespace details {
+
+        template <typename T>
+        T squared_euclidean_scalar(const T* a, const T* b, std::size_t size);
+
+        template <typename T>
+        T manhatten_scalar(const T* a, const T* b, std::size_t size);
+
+        template <typename T>
+        T chebyshev_scalar(const T* a, const T* b, std::size_t size);
+
+        template <typename T>
+        Sums<T> dot_and_norms_scalar(const T* a, const T* b, std::size_t size);
+
+    }  // namespace details
+
+}  // namespace simd_kernels
+
+}  // namespace metric
+
+#include "simd_kernels.cpp"
+
+#endif  // Header Guard
@@ -29,6 +29,7 @@ Copyright (c) PANDA Team
 #include "mapping/ensembles.hpp"
 #include "mapping/affprop.hpp"
 #include "mapping/dbscan.hpp"
+#include "mapping/hdbscan.hpp"
 #include "mapping/kmeans.hpp"
 #include "mapping/kmedoids.hpp"
 #include "mapping/hierarchClustering.hpp"
@@ -196,6 +196,45 @@ namespace affprop_details {
         return { a, cnts };
     }
 
+    // main algorithm, for any matrix with size() and operator()(i, j)
+    template <typename T, typename DistanceMatrix>
+    std::tuple<std::vector<std::size_t>, std::vector<std::size_t>, std::vector<std::size_t>> affprop(
+        const DistanceMatrix& DM, T preference, int maxiter, T tol, T damp)
+    {
+
+        // check arguments
+        auto n = DM.size();
+        assert(n >= 2);  //the number of samples must be at least 2.
+        assert(tol > 0);  //tol must be a positive value.
+        assert(0 <= damp && damp < 1);  // damp must be between 0 and 1.
+        assert(0 <= preference && preference < 1);  // preference must be between 0 and 1.
+
+        // build similarity matrix with preference
+        auto S = similarity_matrix(DM, preference);
+        // initialize messages
+        blaze::DynamicMatrix<T, blaze::rowMajor> R(n, n, 0);
+        blaze::DynamicMatrix<T, blaze::rowMajor> A(n, n, 0);
+        // main loop
+        int t = 0;
+        bool isConverged = false;
+        while (!isConverged && t < maxiter) {
+            t += 1;
+
+            // compute new messages
+            T maxabsR = update_responsibilities(R, S, A, damp);
+            T maxabsA = update_availabilities(A, R, damp);
+
+            // determine convergence
+            T ch = std::max(maxabsA, maxabsR) / (1 - damp);
+            isConverged = (ch < tol);
+        }
+        // extract exemplars and assignments
+        auto exemplars = extract_exemplars<T>(A, R);
+        auto [assignments, counts] = get_assignments<T>(S, exemplars);
+
+        return { assignments, exemplars, counts };
+    }
+
 }  // end namespace affprop_details
 
 }
@@ -39,38 +39,7 @@ template <typename recType, typename Metric, typename T>
 std::tuple<std::vector<std::size_t>, std::vector<std::size_t>, std::vector<std::size_t>> affprop(
     const Matrix<recType, Metric, T>& DM, T preference = 0.5, int maxiter = 200, T tol = 1.0e-6, T damp = 0.5)
 {
-
-    // check arguments
-    auto n = DM.size();
-    assert(n >= 2);  //the number of samples must be at least 2.
-    assert(tol > 0);  //tol must be a positive value.
-    assert(0 <= damp && damp < 1);  // damp must be between 0 and 1.
-    assert(0 <= preference && preference < 1);  // preference must be between 0 and 1.
-
-    // build similarity matrix with preference
-    auto S = metric::affprop_details::similarity_matrix(DM, preference);
-    // initialize messages
-    blaze::DynamicMatrix<T, blaze::rowMajor> R(n, n);
-    blaze::DynamicMatrix<T, blaze::rowMajor> A(n, n);
-    // main loop
-    int t = 0;
-    bool isConverged = false;
-    while (!isConverged && t < maxiter) {
-        t += 1;
-
-        // compute new messages
-        T maxabsR = metric::affprop_details::update_responsibilities(R, S, A, damp);
-        T maxabsA = metric::affprop_details::update_availabilities(A, R, damp);
-
-        // determine convergence
-        T ch = std::max(maxabsA, maxabsR) / (1 - damp);
-        isConverged = (ch < tol);
-    }
-    // extract exemplars and assignments
-    auto exemplars = metric::affprop_details::extract_exemplars<T>(A, R);
-    auto [assignments, counts] = metric::affprop_details::get_assignments<T>(S, exemplars);
-
-    return { assignments, exemplars, counts };
+    return affprop_details::affprop(DM, preference, maxiter, tol, damp);
 }
 
 }  // namespace metric
@@ -12,6 +12,9 @@ Copyright (c) 2018 M.Welsch
 #include <deque>
 #include <numeric>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include "../distance/k-related/Standards.hpp"
 namespace metric {
 
@@ -67,46 +70,294 @@ namespace dbscan_details {
         return cnt;
     }
 
+    // main algorithm, for any matrix with size() and operator()(i, j)
+    template <typename T, typename DistanceMatrix>
+    std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> dbscan(const DistanceMatrix& DM, T eps,
+        std::size_t minpts)
+    {
+
+        // check arguments
+        auto n = DM.size();
+
+        assert(n >= 2);  // error("There must be at least two points.")
+        assert(eps > 0);  // error("eps must be a positive real value.")
+        assert(minpts >= 1);  // error("minpts must be a positive integer.")
+
+        // initialize
+        std::vector<int> seeds;
+        std::vector<int> counts;
+        std::vector<int> assignments(n, int(0));
+        std::vector<bool> visited(n, false);
+        std::vector<int> visitseq(n);
+        std::iota(visitseq.begin(), visitseq.end(), 0);  // (generates a linear index vector [0, 1, 2, ...])
+
+        // main loop
+        int k = 0;
+        for (int p : visitseq) {
+            if (assignments[p] == 0 && !visited[p]) {
+                visited[p] = true;
+                auto nbs = dbscan_details::region_query(DM, p, eps);
+                if (nbs.size() >= minpts) {
+                    k += 1;
+                    auto cnt = dbscan_details::update_cluster(DM, k, p, eps, minpts, nbs, assignments, visited);
+                    seeds.push_back(p);
+                    counts.push_back(cnt);
+                }
+            }
+        }
+
+        // make output
+        return { assignments, seeds, counts };
+    }
+
+    // ------------------------------------------------------------
+    // parallel DBSCAN
+
+    // indices taken by a worker at once, small enough to balance the rows of different cost
+    const std::size_t PARALLEL_GRAIN = 16;
+
+    inline unsigned threads_count(unsigned num_threads)
+    {
+        return num_threads > 0 ? num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    /*
+    calls f(i) for the each i in [0, size), workers take the next PARALLEL_GRAIN indices when they are done
+    */
+    template <typename F>
+    void parallel_for(std::size_t size, unsigned num_threads, F f)
+    {
+        num_threads = (unsigned)std::min<std::size_t>(num_threads, (size + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN);
+        if (num_threads <= 1) {
+            for (std::size_t i = 0; i < size; i++) {
+                f(i);
+            }
+            return;
+        }
+        std::atomic<std::size_t> next(0);
+        auto work = [&]() {
+            for (auto begin = next.fetch_add(PARALLEL_GRAIN); begin < size; begin = next.fetch_add(PARALLEL_GRAIN)) {
+                for (auto i = begin; i < std::min(size, begin + PARALLEL_GRAIN); i++) {
+                    f(i);
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < num_threads; t++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /*
+    lock-free union-find: a root is linked under the smaller root by CAS, so the root of a set is its minimal index
+    */
+    class DisjointSets {
+    public:
+        explicit DisjointSets(std::size_t size)
+            : parent_(size)
+        {
+            for (std::size_t i = 0; i < size; i++) {
+                parent_[i].store(i, std::memory_order_relaxed);
+            }
+        }
+
+        int find(int x)
+        {
+            while (true) {
+                int parent = parent_[x].load(std::memory_order_acquire);
+                if (parent == x) {
+                    return x;
+                }
+                // path halving, a failed CAS only means that another thread has shortened the path
+                int grandparent = parent_[parent].load(std::memory_order_acquire);
+                if (parent != grandparent) {
+                    parent_[x].compare_exchange_weak(parent, grandparent, std::memory_order_acq_rel);
+                }
+                x = grandparent;
+            }
+        }
+
+        void unite(int a, int b)
+        {
+            while (true) {
+                a = find(a);
+                b = find(b);
+                if (a == b) {
+                    return;
+                }
+                if (a > b) {
+                    std::swap(a, b);
+                }
+                // b can be linked by another thread meanwhile, then roots are found again
+                int expected = b;
+                if (parent_[b].compare_exchange_strong(expected, a, std::memory_order_acq_rel)) {
+                    return;
+                }
+            }
+        }
+
+    private:
+        std::vector<std::atomic<int>> parent_;
+    };
+
+    /*
+    clusters are connected components of the core points, so they are merged in any order; numbered by the minimal
+    core point and a border point taken by the cluster of the smallest number, it is the output of the sequential scan
+    */
+    inline std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> cluster_neighbourhoods(
+        const std::vector<std::vector<int>>& neighbours, std::size_t minpts, unsigned num_threads)
+    {
+        auto n = neighbours.size();
+        std::vector<char> core(n);
+        for (std::size_t p = 0; p < n; p++) {
+            core[p] = neighbours[p].size() >= minpts;
+        }
+
+        DisjointSets sets(n);
+        parallel_for(n, num_threads, [&](std::size_t p) {
+            if (!core[p]) {
+                return;
+            }
+            for (auto q : neighbours[p]) {
+                if (q > (int)p && core[q]) {
+                    sets.unite(p, q);
+                }
+            }
+        });
+
+        std::vector<int> seeds;
+        std::vector<int> counts;
+        std::vector<int> assignments(n, 0);
+        for (std::size_t p = 0; p < n; p++) {
+            if (!core[p]) {
+                continue;
+            }
+            // root is less than p, so it is numbered already
+            auto root = sets.find(p);
+            if (root == (int)p) {
+                seeds.push_back(p);
+                counts.push_back(0);
+                assignments[p] = seeds.size();
+            } else {
+                assignments[p] = assignments[root];
+            }
+        }
+
+        // only the border points are written, only the core points are read
+        parallel_for(n, num_threads, [&](std::size_t p) {
+            if (core[p]) {
+                return;
+            }
+            for (auto q : neighbours[p]) {
+                if (core[q] && (assignments[p] == 0 || assignments[q] < assignments[p])) {
+                    assignments[p] = assignments[q];
+                }
+            }
+        });
+
+        for (auto k : assignments) {
+            if (k > 0) {
+                counts[k - 1]++;
+            }
+        }
+
+        return { assignments, seeds, counts };
+    }
+
+    template <typename T, typename DistanceMatrix>
+    std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(const DistanceMatrix& DM, T eps,
+        std::size_t minpts, unsigned num_threads)
+    {
+        assert(eps > 0);  // error("eps must be a positive real value.")
+        assert(minpts >= 1);  // error("minpts must be a positive integer.")
+
+        num_threads = threads_count(num_threads);
+        std::vector<std::vector<int>> neighbours(DM.size());
+        parallel_for(DM.size(), num_threads, [&](std::size_t p) {
+            for (std::size_t i = 0; i < DM.size(); ++i) {
+                if (DM(p, i) < eps) {
+                    neighbours[p].push_back(i);
+                }
+            }
+        });
+
+        return cluster_neighbourhoods(neighbours, minpts, num_threads);
+    }
+
 }  //namespace dbscan_details
 
-// main algorithm
 template <typename recType, typename Metric, typename T>
 std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> dbscan(const Matrix<recType, Metric, T>& DM,
                                                                         T eps, std::size_t minpts)
 {
+    return dbscan_details::dbscan(DM, eps, minpts);
+}
 
-    // check arguments
-    auto n = DM.size();
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> dbscan(const LazyMatrix<recType, Metric, T>& DM,
+                                                                        T eps, std::size_t minpts)
+{
+    return dbscan_details::dbscan(DM, eps, minpts);
+}
+
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const Matrix<recType, Metric, T>& DM, T eps, std::size_t minpts, unsigned num_threads)
+{
+    return dbscan_details::parallel_dbscan(DM, eps, minpts, num_threads);
+}
+
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const LazyMatrix<recType, Metric, T>& DM, T eps, std::size_t minpts, unsigned num_threads)
+{
+    return dbscan_details::parallel_dbscan(DM, eps, minpts, num_threads);
+}
 
-    assert(n >= 2);  // error("There must be at least two points.")
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const std::vector<recType>& records, const Metric& metric, T eps, std::size_t minpts, unsigned num_threads)
+{
     assert(eps > 0);  // error("eps must be a positive real value.")
     assert(minpts >= 1);  // error("minpts must be a positive integer.")
 
-    // initialize
-    std::vector<int> seeds;
-    std::vector<int> counts;
-    std::vector<int> assignments(n, int(0));
-    std::vector<bool> visited(n, false);
-    std::vector<int> visitseq(n);
-    std::iota(visitseq.begin(), visitseq.end(), 0);  // (generates a linear index vector [0, 1, 2, ...])
-
-    // main loop
-    int k = 0;
-    for (int p : visitseq) {
-        if (assignments[p] == 0 && !visited[p]) {
-            visited[p] = true;
-            auto nbs = dbscan_details::region_query(DM, p, eps);
-            if (nbs.size() >= minpts) {
-                k += 1;
-                auto cnt = dbscan_details::update_cluster(DM, k, p, eps, minpts, nbs, assignments, visited);
-                seeds.push_back(p);
-                counts.push_back(cnt);
+    // each pair is computed once, by the worker of its first point
+    auto n = records.size();
+    num_threads = dbscan_details::threads_count(num_threads);
+    std::vector<std::vector<int>> following(n);
+    dbscan_details::parallel_for(n, num_threads, [&](std::size_t i) {
+        for (std::size_t j = i + 1; j < n; j++) {
+            if (metric(records[i], records[j]) < eps) {
+                following[i].push_back(j);
             }
         }
+    });
+
+    // every point is neighbour to itself, as in the distance matrix
+    std::vector<std::vector<int>> neighbours(n);
+    for (std::size_t i = 0; i < n; i++) {
+        neighbours[i].push_back(i);
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        for (auto j : following[i]) {
+            neighbours[i].push_back(j);
+            neighbours[j].push_back(i);
+        }
     }
 
-    // make output
-    return { assignments, seeds, counts };
+    return dbscan_details::cluster_neighbourhoods(neighbours, minpts, num_threads);
+}
+
+inline std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const std::vector<std::vector<int>>& neighbours, std::size_t minpts, unsigned num_threads)
+{
+    assert(minpts >= 1);  // error("minpts must be a positive integer.")
+
+    return dbscan_details::cluster_neighbourhoods(neighbours, minpts, dbscan_details::threads_count(num_threads));
 }
 
 }  // namespace metric
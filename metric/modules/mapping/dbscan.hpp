@@ -21,7 +21,9 @@ A DBSCAN implementation based on distance matrix.
 
 #include <vector>
 #include <string>
+#include <tuple>
 #include "../space/matrix.hpp"
+#include "../space/lazy_matrix.hpp"
 namespace metric {
 
 /**
@@ -37,6 +39,60 @@ namespace metric {
 template <typename recType, typename Metric, typename T>
 std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> dbscan(const metric::Matrix<recType, Metric, T>& dm, T eps, std::size_t minpts);
 
+/**
+ * @brief DBSCAN over the distances computed on demand, for the datasets whose full matrix doesn't fit the memory
+ *
+ * @param dm lazy distance matrix
+ * @param eps the maximum distance between neighbor objects
+ * @param minpts minimum number of neighboring objects needed to form a cluster
+ * @return same as for the full matrix
+ */
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> dbscan(const metric::LazyMatrix<recType, Metric, T>& dm, T eps, std::size_t minpts);
+
+/**
+ * @brief DBSCAN with the neighbourhoods queried by several threads; core points are merged into clusters by the
+ * lock-free union-find over the core-core edges, then border points are assigned. The output is the same as of dbscan
+ *
+ * @param dm distance matrix, full or lazy
+ * @param eps the maximum distance between neighbor objects
+ * @param minpts minimum number of neighboring objects needed to form a cluster
+ * @param num_threads worker threads, 0 means hardware concurrency
+ * @return same as dbscan
+ */
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const metric::Matrix<recType, Metric, T>& dm, T eps, std::size_t minpts, unsigned num_threads = 0);
+
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const metric::LazyMatrix<recType, Metric, T>& dm, T eps, std::size_t minpts, unsigned num_threads = 0);
+
+/**
+ * @brief parallel DBSCAN over the records, each pair distance is computed once and no matrix is stored
+ *
+ * @param records data records
+ * @param metric metric object, called from several threads
+ * @param eps the maximum distance between neighbor objects
+ * @param minpts minimum number of neighboring objects needed to form a cluster
+ * @param num_threads worker threads, 0 means hardware concurrency
+ * @return same as dbscan
+ */
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const std::vector<recType>& records, const Metric& metric, T eps, std::size_t minpts, unsigned num_threads = 0);
+
+/**
+ * @brief parallel DBSCAN over the found eps-neighbourhoods, for the callers that find them without all pairs
+ *
+ * @param neighbours symmetric neighbourhoods, the each includes the point itself
+ * @param minpts minimum number of neighboring objects needed to form a cluster
+ * @param num_threads worker threads, 0 means hardware concurrency
+ * @return same as dbscan
+ */
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> parallel_dbscan(
+    const std::vector<std::vector<int>>& neighbours, std::size_t minpts, unsigned num_threads = 0);
+
 }  // namespace metric
 
 #include "dbscan.cpp"
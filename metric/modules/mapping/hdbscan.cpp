@@ -0,0 +1,373 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+#ifndef _METRIC_MAPPING_HDBSCAN_CPP
+#define _METRIC_MAPPING_HDBSCAN_CPP
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+#include "dbscan.hpp"
+#include "hdbscan.hpp"
+
+namespace metric {
+
+namespace hdbscan_details {
+
+    /*
+    distance to the (minpts - 1)-th nearest of the others, the record itself is the first neighbour;
+    distances are reordered
+    */
+    template <typename T>
+    T core_distance(std::vector<T>& distances, std::size_t minpts)
+    {
+        if (minpts <= 1) {
+            return 0;
+        }
+        if (distances.size() < minpts - 1) {
+            return std::numeric_limits<T>::max();
+        }
+        std::nth_element(distances.begin(), distances.begin() + (minpts - 2), distances.end());
+        return distances[minpts - 2];
+    }
+
+    /*
+    entry of the condensed tree: a record or a child cluster leaves the parent cluster at lambda = 1 / distance
+    */
+    struct Condensed {
+        int parent;
+        int child;
+        double lambda;
+        std::size_t size;
+    };
+
+}  // namespace hdbscan_details
+
+template <typename T>
+template <typename recType, typename Metric>
+HDBSCAN<T>::HDBSCAN(const std::vector<recType>& records, const Metric& metric, std::size_t minpts, unsigned num_threads)
+{
+    assert(minpts >= 1);  // error("minpts must be a positive integer.")
+
+    auto n = records.size();
+    core_distances_.resize(n);
+    dbscan_details::parallel_for(n, dbscan_details::threads_count(num_threads), [&](std::size_t i) {
+        std::vector<T> distances;
+        distances.reserve(n);
+        for (std::size_t j = 0; j < n; j++) {
+            if (j != i) {
+                distances.push_back(metric(records[i], records[j]));
+            }
+        }
+        core_distances_[i] = hdbscan_details::core_distance(distances, minpts);
+    });
+
+    // Prim over the mutual reachability distances, computed again instead of storing the matrix
+    if (n > 0) {
+        std::vector<T> best(n, std::numeric_limits<T>::max());
+        std::vector<int> from(n, 0);
+        std::vector<char> in_tree(n, 0);
+        std::size_t last = 0;
+        in_tree[0] = 1;
+        for (std::size_t step = 1; step < n; step++) {
+            std::size_t next = n;
+            for (std::size_t v = 0; v < n; v++) {
+                if (in_tree[v]) {
+                    continue;
+                }
+                T distance = std::max({ T(metric(records[last], records[v])), core_distances_[last], core_distances_[v] });
+                if (distance < best[v]) {
+                    best[v] = distance;
+                    from[v] = last;
+                }
+                if (next == n || best[v] < best[next]) {
+                    next = v;
+                }
+            }
+            in_tree[next] = 1;
+            // records that are never core are connected at infinity only, as in the forest of the candidate pairs
+            if (best[next] < std::numeric_limits<T>::max()) {
+                tree_.push_back({ from[next], (int)next, best[next] });
+            }
+            last = next;
+        }
+    }
+    sort_tree();
+}
+
+template <typename T>
+HDBSCAN<T>::HDBSCAN(std::size_t size, const std::vector<Edge>& pairs, std::size_t minpts)
+{
+    assert(minpts >= 1);  // error("minpts must be a positive integer.")
+
+    std::vector<std::vector<T>> distances(size);
+    for (const auto& pair : pairs) {
+        distances[pair.a].push_back(pair.distance);
+        distances[pair.b].push_back(pair.distance);
+    }
+    core_distances_.resize(size);
+    for (std::size_t i = 0; i < size; i++) {
+        core_distances_[i] = hdbscan_details::core_distance(distances[i], minpts);
+    }
+
+    // Kruskal over the mutual reachability distances
+    std::vector<Edge> edges;
+    edges.reserve(pairs.size());
+    for (const auto& pair : pairs) {
+        T distance = std::max({ pair.distance, core_distances_[pair.a], core_distances_[pair.b] });
+        if (distance < std::numeric_limits<T>::max()) {
+            edges.push_back({ pair.a, pair.b, distance });
+        }
+    }
+    std::stable_sort(
+        edges.begin(), edges.end(), [](const Edge& x, const Edge& y) { return x.distance < y.distance; });
+
+    dbscan_details::DisjointSets sets(size);
+    for (const auto& edge : edges) {
+        if (sets.find(edge.a) != sets.find(edge.b)) {
+            sets.unite(edge.a, edge.b);
+            tree_.push_back(edge);
+        }
+    }
+}
+
+template <typename T>
+void HDBSCAN<T>::sort_tree()
+{
+    std::stable_sort(
+        tree_.begin(), tree_.end(), [](const Edge& x, const Edge& y) { return x.distance < y.distance; });
+}
+
+template <typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> HDBSCAN<T>::extract(T eps) const
+{
+    assert(eps > 0);  // error("eps must be a positive real value.")
+
+    dbscan_details::DisjointSets sets(size());
+    for (const auto& edge : tree_) {
+        if (!(edge.distance < eps)) {
+            break;
+        }
+        sets.unite(edge.a, edge.b);
+    }
+
+    // ends of the edges shorter than eps are core at eps, so only the other records are noise
+    std::vector<int> cluster_ids(size(), -1);
+    for (std::size_t p = 0; p < size(); p++) {
+        if (core_distances_[p] < eps) {
+            cluster_ids[p] = sets.find(p);
+        }
+    }
+    return number_clusters(cluster_ids);
+}
+
+template <typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> HDBSCAN<T>::extract_stable(
+    std::size_t min_cluster_size) const
+{
+    // a single record is never a cluster, every record would be one then
+    min_cluster_size = std::max<std::size_t>(min_cluster_size, 2);
+    int n = size();
+    if (n == 0) {
+        return {};
+    }
+
+    // single linkage dendrogram: leaves are the records, node n + k is the merge of the k-th tree edge
+    double min_distance = 0;
+    for (const auto& edge : tree_) {
+        if (edge.distance > 0) {
+            min_distance = edge.distance;
+            break;
+        }
+    }
+    // equal records are merged at the level above the closest different ones
+    double max_lambda = min_distance > 0 ? 2 / min_distance : 1;
+
+    std::vector<int> left;
+    std::vector<int> right;
+    std::vector<double> merge_lambda;
+    std::vector<std::size_t> node_size(n, 1);
+    std::vector<int> top(n);
+    for (int p = 0; p < n; p++) {
+        top[p] = p;
+    }
+    dbscan_details::DisjointSets sets(n);
+    auto merge = [&](int a, int b, double lambda) {
+        int root_a = sets.find(a);
+        int root_b = sets.find(b);
+        left.push_back(top[root_a]);
+        right.push_back(top[root_b]);
+        merge_lambda.push_back(lambda);
+        node_size.push_back(node_size[top[root_a]] + node_size[top[root_b]]);
+        sets.unite(root_a, root_b);
+        top[sets.find(a)] = node_size.size() - 1;
+    };
+    for (const auto& edge : tree_) {
+        merge(edge.a, edge.b, edge.distance > 0 ? 1 / double(edge.distance) : max_lambda);
+    }
+    // components of the forest are joined at the infinite distance
+    for (int p = 1; p < n; p++) {
+        if (sets.find(p) != sets.find(0)) {
+            merge(0, p, 0);
+        }
+    }
+    int root = node_size.size() - 1;
+
+    // condensed tree: groups smaller than min_cluster_size split from a cluster are its records falling out,
+    // clusters are labeled from n, the root is n, children are labeled after their parents
+    std::vector<hdbscan_details::Condensed> condensed;
+    std::vector<int> relabel(node_size.size(), -1);
+    int next_label = n;
+    relabel[root] = next_label++;
+    std::vector<int> stack = { root };
+    std::vector<int> leaves_stack;
+    auto fall_out = [&](int node, int parent, double lambda) {
+        leaves_stack.assign(1, node);
+        while (!leaves_stack.empty()) {
+            int current = leaves_stack.back();
+            leaves_stack.pop_back();
+            if (current < n) {
+                condensed.push_back({ parent, current, lambda, 1 });
+            } else {
+                leaves_stack.push_back(left[current - n]);
+                leaves_stack.push_back(right[current - n]);
+            }
+        }
+    };
+    while (!stack.empty()) {
+        int node = stack.back();
+        stack.pop_back();
+        if (node < n) {
+            continue;
+        }
+        int l = left[node - n];
+        int r = right[node - n];
+        double lambda = merge_lambda[node - n];
+        bool l_cluster = node_size[l] >= min_cluster_size;
+        bool r_cluster = node_size[r] >= min_cluster_size;
+        if (l_cluster && r_cluster) {
+            for (int child : { l, r }) {
+                relabel[child] = next_label++;
+                condensed.push_back({ relabel[node], relabel[child], lambda, node_size[child] });
+                stack.push_back(child);
+            }
+        } else if (l_cluster) {
+            relabel[l] = relabel[node];
+            fall_out(r, relabel[node], lambda);
+            stack.push_back(l);
+        } else if (r_cluster) {
+            relabel[r] = relabel[node];
+            fall_out(l, relabel[node], lambda);
+            stack.push_back(r);
+        } else {
+            fall_out(l, relabel[node], lambda);
+            fall_out(r, relabel[node], lambda);
+        }
+    }
+
+    // stability of a cluster: sum of (lambda of leaving - lambda of birth) of its records
+    int num_clusters = next_label - n;
+    std::vector<double> birth(num_clusters, 0);
+    std::vector<int> parent_cluster(num_clusters, -1);
+    std::vector<std::vector<int>> children(num_clusters);
+    for (const auto& entry : condensed) {
+        if (entry.child >= n) {
+            birth[entry.child - n] = entry.lambda;
+            parent_cluster[entry.child - n] = entry.parent - n;
+            children[entry.parent - n].push_back(entry.child - n);
+        }
+    }
+    std::vector<double> stability(num_clusters, 0);
+    for (const auto& entry : condensed) {
+        stability[entry.parent - n] += (entry.lambda - birth[entry.parent - n]) * entry.size;
+    }
+
+    // excess of mass: a cluster is selected if it is more stable than its selected descendants together;
+    // the root isn't a cluster
+    std::vector<char> selected(num_clusters, 0);
+    for (int c = num_clusters - 1; c > 0; c--) {
+        double children_stability = 0;
+        for (auto child : children[c]) {
+            children_stability += stability[child];
+        }
+        if (!children[c].empty() && children_stability > stability[c]) {
+            stability[c] = children_stability;
+            continue;
+        }
+        selected[c] = 1;
+        stack.assign(children[c].begin(), children[c].end());
+        while (!stack.empty()) {
+            int descendant = stack.back();
+            stack.pop_back();
+            selected[descendant] = 0;
+            stack.insert(stack.end(), children[descendant].begin(), children[descendant].end());
+        }
+    }
+
+    // record belongs to the selected cluster it leaves or to its selected ancestor, parents go first
+    std::vector<int> owner(num_clusters, -1);
+    for (int c = 1; c < num_clusters; c++) {
+        owner[c] = selected[c] ? c : owner[parent_cluster[c]];
+    }
+    std::vector<int> cluster_ids(n, -1);
+    for (const auto& entry : condensed) {
+        if (entry.child < n) {
+            cluster_ids[entry.child] = owner[entry.parent - n];
+        }
+    }
+    return number_clusters(cluster_ids);
+}
+
+template <typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> HDBSCAN<T>::number_clusters(
+    const std::vector<int>& cluster_ids) const
+{
+    std::vector<int> seeds;
+    std::vector<int> counts;
+    std::vector<int> assignments(cluster_ids.size(), 0);
+    std::vector<int> numbers;
+    for (std::size_t p = 0; p < cluster_ids.size(); p++) {
+        auto id = cluster_ids[p];
+        if (id < 0) {
+            continue;
+        }
+        if ((std::size_t)id >= numbers.size()) {
+            numbers.resize(id + 1, 0);
+        }
+        if (numbers[id] == 0) {
+            seeds.push_back(p);
+            counts.push_back(0);
+            numbers[id] = seeds.size();
+        }
+        assignments[p] = numbers[id];
+        counts[numbers[id] - 1]++;
+    }
+    return { assignments, seeds, counts };
+}
+
+template <typename T>
+const std::vector<T>& HDBSCAN<T>::core_distances() const
+{
+    return core_distances_;
+}
+
+template <typename T>
+const std::vector<typename HDBSCAN<T>::Edge>& HDBSCAN<T>::spanning_tree() const
+{
+    return tree_;
+}
+
+template <typename T>
+std::size_t HDBSCAN<T>::size() const
+{
+    return core_distances_.size();
+}
+
+}  // namespace metric
+
+#endif
@@ -0,0 +1,132 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+
+#ifndef _METRIC_MAPPING_HDBSCAN_HPP
+#define _METRIC_MAPPING_HDBSCAN_HPP
+
+/*
+A HDBSCAN implementation over the minimum spanning tree of the mutual reachability distances.
+*/
+
+//   References:
+//
+//       Ricardo J. G. B. Campello, Davoud Moulavi, and Joerg Sander
+//       Density-based clustering based on hierarchical density estimates. 2013.
+//
+//       Leland McInnes and John Healy
+//       Accelerated hierarchical density based clustering. 2017.
+
+#include <tuple>
+#include <vector>
+
+namespace metric {
+
+/**
+ * @class HDBSCAN
+ *
+ * @brief Density hierarchy of the records: core distance of a record is the distance to its minpts-th neighbour
+ * (the record itself is the first one, as in dbscan), mutual reachability distance of two records is the max of
+ * their distance and both core distances. The hierarchy is the minimum spanning tree of the mutual reachability
+ * distances, it is built once, then clusters of any density level or the most stable clusters are extracted
+ * without clustering again.
+ *
+ */
+template <typename T>
+class HDBSCAN {
+public:
+    /**
+     * @brief edge of the spanning tree
+     */
+    struct Edge {
+        int a;
+        int b;
+        T distance;
+    };
+
+    /**
+     * @brief Construct the hierarchy over all pairs of the records, no distance matrix is stored
+     *
+     * @param records data records
+     * @param metric metric object, called from several threads
+     * @param minpts minimum number of neighboring objects of the core record
+     * @param num_threads workers of the core distances, 0 means hardware concurrency
+     */
+    template <typename recType, typename Metric>
+    HDBSCAN(const std::vector<recType>& records, const Metric& metric, std::size_t minpts, unsigned num_threads = 0);
+
+    /**
+     * @brief Construct the hierarchy over the candidate pairs only, the pairs that are not given are treated as
+     * infinitely far, so the result is a spanning forest; records with less than minpts - 1 candidates are never core
+     *
+     * @param size number of the records
+     * @param pairs candidate pairs with their distances, each pair once
+     * @param minpts minimum number of neighboring objects of the core record
+     */
+    HDBSCAN(std::size_t size, const std::vector<Edge>& pairs, std::size_t minpts);
+
+    /**
+     * @brief clusters of the density level eps, as DBSCAN* does: records with the core distance less than eps are
+     * connected by the tree edges shorter than eps, the others are noise. For minpts 1 and 2 it is the same as dbscan,
+     * for the larger minpts border records of dbscan are noise here. O(n) over the sorted tree
+     *
+     * @param eps the maximum distance between neighbor objects
+     * @return same as dbscan: cluster number of the each record (0 for noise), minimal record of the each cluster
+     * and size of the each cluster, clusters are numbered in order of their minimal records
+     */
+    std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> extract(T eps) const;
+
+    /**
+     * @brief clusters of the different density levels that persist longest in the hierarchy (excess of mass),
+     * so no global eps is needed. Merges of the equal distance are taken in the order of the tree edges
+     *
+     * @param min_cluster_size smaller groups split from a cluster are its noise, not the new clusters
+     * @return same as extract
+     */
+    std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> extract_stable(std::size_t min_cluster_size) const;
+
+    /**
+     * @brief
+     *
+     * @return core distance of the each record, max of T if the record has less than minpts - 1 candidates
+     */
+    const std::vector<T>& core_distances() const;
+
+    /**
+     * @brief
+     *
+     * @return edges of the minimum spanning tree (forest), sorted by the mutual reachability distance
+     */
+    const std::vector<Edge>& spanning_tree() const;
+
+    /**
+     * @brief
+     *
+     * @return number of the records
+     */
+    std::size_t size() const;
+
+private:
+    /**
+     * @brief sorts the tree edges
+     */
+    void sort_tree();
+
+    /**
+     * @brief assignments to the cluster ids (>= 0, -1 for noise) numbered as dbscan does
+     */
+    std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> number_clusters(
+        const std::vector<int>& cluster_ids) const;
+
+    std::vector<T> core_distances_;
+    std::vector<Edge> tree_;
+};
+
+}  // namespace metric
+
+#include "hdbscan.cpp"
+#endif
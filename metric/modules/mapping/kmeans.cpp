@@ -25,6 +25,7 @@ Copyright (c) 2018 M.Welsch
     idx: A vector containing the cluster index
     */
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <random>
@@ -153,6 +154,10 @@ namespace kmeans_details {
     {
 
         std::vector<std::vector<T>> old_means = means;
+        // sums are accumulated from zero, not on top of the previous means
+        for (auto& mean : means) {
+            std::fill(mean.begin(), mean.end(), T(0));
+        }
 
         std::vector<int> count(k, int(0));
         for (int i = 0; i < std::min(assignments.size(), data.size()); ++i) {
@@ -0,0 +1,518 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+
+#ifndef _METRIC_MAPPING_KMEANS_ENGINE_CPP
+#define _METRIC_MAPPING_KMEANS_ENGINE_CPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>
+#include "kmeans_engine.hpp"
+
+namespace metric {
+namespace kmeans_engine {
+
+    template <typename T>
+    T Euclidian::distance(T dot, T a_squared_norm, T b_squared_norm)
+    {
+        return std::sqrt(std::max(T(0), a_squared_norm + b_squared_norm - 2 * dot));
+    }
+
+    template <typename T>
+    T Cosine::distance(T dot, T a_squared_norm, T b_squared_norm)
+    {
+        T norms = std::sqrt(a_squared_norm * b_squared_norm);
+        T cosine = norms > 0 ? dot / norms : T(0);
+        return std::sqrt(std::max(T(0), 2 - 2 * cosine));
+    }
+
+    template <typename T>
+    T Spherical::distance(T dot, T, T)
+    {
+        return std::sqrt(std::max(T(0), 2 - 2 * dot));
+    }
+
+    namespace details {
+
+        // rows of the block share the tile of the means while it is in cache
+        const std::size_t BLOCK_ROWS = 64;
+        // accumulators of the tile stay in L1
+        const std::size_t TILE_MEANS = 256;
+
+        inline unsigned threads_count(const Options& options)
+        {
+            unsigned num_threads = options.num_threads > 0 ? options.num_threads : std::thread::hardware_concurrency();
+            return std::max(num_threads, 1u);
+        }
+
+        /*
+        small ranges are not worth a thread
+        */
+        inline unsigned workers_count(std::size_t size, unsigned num_threads)
+        {
+            return (unsigned)std::min<std::size_t>(num_threads, std::max<std::size_t>(size / BLOCK_ROWS, 1));
+        }
+
+        /*
+        splits [0, size) into contiguous ranges, one per worker, f(begin, end, worker)
+        */
+        template <typename F>
+        void parallel_for(std::size_t size, unsigned num_threads, F f)
+        {
+            num_threads = workers_count(size, num_threads);
+            if (num_threads <= 1) {
+                f(std::size_t(0), size, 0u);
+                return;
+            }
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < num_threads; t++) {
+                workers.emplace_back(
+                    [t, num_threads, size, &f]() { f(size * t / num_threads, size * (t + 1) / num_threads, t); });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        template <typename T>
+        T dot(const T* a, const T* b, std::size_t size)
+        {
+            T sum = 0;
+            for (std::size_t j = 0; j < size; j++) {
+                sum += a[j] * b[j];
+            }
+            return sum;
+        }
+
+        template <typename T>
+        std::vector<T> squared_norms(const std::vector<T>& matrix, std::size_t cols, unsigned num_threads)
+        {
+            std::vector<T> norms(matrix.size() / cols);
+            parallel_for(norms.size(), num_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+                for (auto i = begin; i < end; i++) {
+                    norms[i] = dot(&matrix[i * cols], &matrix[i * cols], cols);
+                }
+            });
+            return norms;
+        }
+
+        /*
+        rows of the matrix become unit vectors, zero rows stay as they are
+        */
+        template <typename T>
+        void normalize_rows(std::vector<T>& matrix, std::size_t cols, unsigned num_threads)
+        {
+            parallel_for(matrix.size() / cols, num_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+                for (auto i = begin; i < end; i++) {
+                    T* row = &matrix[i * cols];
+                    T norm = std::sqrt(dot(row, row, cols));
+                    if (norm > 0) {
+                        for (std::size_t j = 0; j < cols; j++) {
+                            row[j] /= norm;
+                        }
+                    }
+                }
+            });
+        }
+
+        /*
+        means as cols x k matrix, so the innermost loop of the product goes over contiguous means
+        */
+        template <typename T>
+        std::vector<T> transpose(const std::vector<T>& means, std::size_t k, std::size_t cols)
+        {
+            std::vector<T> means_t(means.size());
+            for (std::size_t c = 0; c < k; c++) {
+                for (std::size_t j = 0; j < cols; j++) {
+                    means_t[j * k + c] = means[c * cols + j];
+                }
+            }
+            return means_t;
+        }
+
+        /*
+        dots[r * k + c] = <data[rows[r]], means[c]> for the block of rows
+        */
+        template <typename T>
+        void block_dots(const std::vector<T>& data, std::size_t cols, const std::size_t* rows, std::size_t num_rows,
+            const std::vector<T>& means_t, std::size_t k, T* dots)
+        {
+            std::fill(dots, dots + num_rows * k, T(0));
+            for (std::size_t tile = 0; tile < k; tile += TILE_MEANS) {
+                std::size_t tile_end = std::min(k, tile + TILE_MEANS);
+                for (std::size_t r = 0; r < num_rows; r++) {
+                    const T* row = &data[rows[r] * cols];
+                    T* out = dots + r * k;
+                    for (std::size_t j = 0; j < cols; j++) {
+                        T value = row[j];
+                        const T* mean_values = &means_t[j * k];
+                        for (std::size_t c = tile; c < tile_end; c++) {
+                            out[c] += value * mean_values[c];
+                        }
+                    }
+                }
+            }
+        }
+
+        /*
+        the closest and the second closest means for the rows, block by block
+        */
+        template <typename Measure, typename T>
+        std::size_t assign_rows(const std::vector<T>& data, std::size_t cols, const std::vector<T>& norms,
+            const std::size_t* rows, std::size_t num_rows, const std::vector<T>& means_t,
+            const std::vector<T>& mean_norms, std::vector<int>& assignments, T* upper, T* lower)
+        {
+            std::size_t k = mean_norms.size();
+            std::vector<T> dots(BLOCK_ROWS * k);
+            std::size_t changed = 0;
+
+            for (std::size_t block = 0; block < num_rows; block += BLOCK_ROWS) {
+                std::size_t block_size = std::min(BLOCK_ROWS, num_rows - block);
+                block_dots(data, cols, rows + block, block_size, means_t, k, dots.data());
+
+                for (std::size_t r = 0; r < block_size; r++) {
+                    auto i = rows[block + r];
+                    T closest = std::numeric_limits<T>::max();
+                    T second = std::numeric_limits<T>::max();
+                    int index = 0;
+                    const T* row_dots = &dots[r * k];
+                    if constexpr (Measure::normalized) {
+                        // distance decreases with the dot product, only the two largest dots are converted
+                        T largest = std::numeric_limits<T>::lowest();
+                        T second_largest = std::numeric_limits<T>::lowest();
+                        for (std::size_t c = 0; c < k; c++) {
+                            if (row_dots[c] > largest) {
+                                second_largest = largest;
+                                largest = row_dots[c];
+                                index = (int)c;
+                            } else if (row_dots[c] > second_largest) {
+                                second_largest = row_dots[c];
+                            }
+                        }
+                        closest = Measure::distance(largest, T(1), T(1));
+                        second = k > 1 ? Measure::distance(second_largest, T(1), T(1)) : std::numeric_limits<T>::max();
+                    } else {
+                        for (std::size_t c = 0; c < k; c++) {
+                            T distance = Measure::distance(row_dots[c], norms[i], mean_norms[c]);
+                            if (distance < closest) {
+                                second = closest;
+                                closest = distance;
+                                index = (int)c;
+                            } else if (distance < second) {
+                                second = distance;
+                            }
+                        }
+                    }
+                    if (assignments[i] != index) {
+                        assignments[i] = index;
+                        changed++;
+                    }
+                    if (upper != nullptr) {
+                        upper[i] = closest;
+                        lower[i] = second;
+                    }
+                }
+            }
+
+            return changed;
+        }
+
+        /*
+        means initialization based on the [kmeans++](https://en.wikipedia.org/wiki/K-means%2B%2B) algorithm
+        over the candidate rows, closest distances are updated for the each new mean in parallel
+        */
+        template <typename Measure, typename T>
+        std::vector<T> seed_means(const std::vector<T>& data, std::size_t cols, const std::vector<T>& norms,
+            const std::vector<std::size_t>& candidates, int k, std::mt19937_64& random, unsigned num_threads)
+        {
+            std::vector<T> means(k * cols);
+            std::vector<double> closest(candidates.size(), std::numeric_limits<double>::max());
+
+            std::size_t chosen = std::uniform_int_distribution<std::size_t>(0, candidates.size() - 1)(random);
+            for (int c = 0; c < k; c++) {
+                const T* mean = &data[candidates[chosen] * cols];
+                std::copy(mean, mean + cols, &means[c * cols]);
+                T mean_norm = norms[candidates[chosen]];
+
+                parallel_for(candidates.size(), num_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+                    for (auto i = begin; i < end; i++) {
+                        auto row = candidates[i];
+                        double distance = Measure::distance(dot(&data[row * cols], mean, cols), norms[row], mean_norm);
+                        closest[i] = std::min(closest[i], distance * distance);
+                    }
+                });
+
+                // next mean is picked with probability proportional to the squared distance to the closest mean
+                double total = std::accumulate(closest.begin(), closest.end(), 0.0);
+                double target = std::uniform_real_distribution<double>(0, total)(random);
+                chosen = 0;
+                for (double sum = closest[0]; sum < target && chosen + 1 < closest.size(); sum += closest[++chosen]) {
+                }
+            }
+
+            return means;
+        }
+
+        /*
+        means of the assigned rows, empty clusters keep the previous means
+        */
+        template <typename T>
+        std::vector<int> update_means(const std::vector<T>& data, std::size_t cols, const std::vector<int>& assignments,
+            std::vector<T>& means, int k, unsigned num_threads)
+        {
+            std::size_t rows = assignments.size();
+            num_threads = workers_count(rows, num_threads);
+            std::vector<std::vector<double>> sums(num_threads, std::vector<double>(k * cols, 0.0));
+            std::vector<std::vector<int>> counts(num_threads, std::vector<int>(k, 0));
+
+            parallel_for(rows, num_threads, [&](std::size_t begin, std::size_t end, unsigned t) {
+                for (auto i = begin; i < end; i++) {
+                    double* sum = &sums[t][assignments[i] * cols];
+                    const T* row = &data[i * cols];
+                    for (std::size_t j = 0; j < cols; j++) {
+                        sum[j] += row[j];
+                    }
+                    counts[t][assignments[i]]++;
+                }
+            });
+
+            for (unsigned t = 1; t < num_threads; t++) {
+                for (std::size_t j = 0; j < sums[0].size(); j++) {
+                    sums[0][j] += sums[t][j];
+                }
+                for (int c = 0; c < k; c++) {
+                    counts[0][c] += counts[t][c];
+                }
+            }
+            for (int c = 0; c < k; c++) {
+                if (counts[0][c] > 0) {
+                    for (std::size_t j = 0; j < cols; j++) {
+                        means[c * cols + j] = T(sums[0][c * cols + j] / counts[0][c]);
+                    }
+                }
+            }
+
+            return counts[0];
+        }
+
+        template <typename Measure, typename T>
+        Result<T> lloyd(const std::vector<T>& data, std::size_t cols, int k, const Options& options)
+        {
+            std::size_t rows = data.size() / cols;
+            unsigned num_threads = threads_count(options);
+            std::mt19937_64 random(options.seed);
+            auto norms = squared_norms(data, cols, num_threads);
+
+            std::vector<std::size_t> all_rows(rows);
+            std::iota(all_rows.begin(), all_rows.end(), 0);
+            auto means = seed_means<Measure>(data, cols, norms, all_rows, k, random, num_threads);
+            auto mean_norms = squared_norms(means, cols, 1);
+            auto means_t = transpose(means, k, cols);
+
+            std::vector<int> assignments(rows, -1);
+            std::vector<T> upper(rows);
+            std::vector<T> lower(rows);
+            parallel_for(rows, num_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+                assign_rows<Measure>(data, cols, norms, &all_rows[begin], end - begin, means_t, mean_norms,
+                    assignments, upper.data(), lower.data());
+            });
+
+            std::vector<int> counts;
+            std::vector<T> movements(k);
+            std::vector<T> half_gaps(k);
+            std::vector<T> mean_dots(k * k);
+            std::vector<std::size_t> mean_rows(k);
+            std::iota(mean_rows.begin(), mean_rows.end(), 0);
+
+            for (int iteration = 1;; iteration++) {
+                auto old_means = means;
+                auto old_norms = mean_norms;
+                counts = update_means(data, cols, assignments, means, k, num_threads);
+                if constexpr (Measure::normalized) {
+                    normalize_rows(means, cols, 1);
+                }
+                if (iteration >= options.max_iterations) {
+                    break;
+                }
+                mean_norms = squared_norms(means, cols, 1);
+                means_t = transpose(means, k, cols);
+
+                // how far the each mean moved and half of the distance to its closest other mean
+                int most_moved = 0;
+                for (int c = 0; c < k; c++) {
+                    movements[c] = Measure::distance(
+                        dot(&old_means[c * cols], &means[c * cols], cols), old_norms[c], mean_norms[c]);
+                    if (movements[c] > movements[most_moved]) {
+                        most_moved = c;
+                    }
+                }
+                T second_movement = 0;
+                for (int c = 0; c < k; c++) {
+                    if (c != most_moved) {
+                        second_movement = std::max(second_movement, movements[c]);
+                    }
+                }
+                parallel_for(k, num_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+                    block_dots(means, cols, &mean_rows[begin], end - begin, means_t, k, &mean_dots[begin * k]);
+                });
+                for (int c = 0; c < k; c++) {
+                    T closest = std::numeric_limits<T>::max();
+                    for (int other = 0; other < k; other++) {
+                        if (other != c) {
+                            closest = std::min(
+                                closest, Measure::distance(mean_dots[c * k + other], mean_norms[c], mean_norms[other]));
+                        }
+                    }
+                    half_gaps[c] = closest / 2;
+                }
+
+                // rows whose bounds can't prove the own mean is still the closest one are compared with all the means
+                std::vector<std::size_t> changed(num_threads, 0);
+                std::vector<std::vector<std::size_t>> candidates(num_threads);
+                parallel_for(rows, num_threads, [&](std::size_t begin, std::size_t end, unsigned t) {
+                    auto& thread_candidates = candidates[t];
+                    for (auto i = begin; i < end; i++) {
+                        int own = assignments[i];
+                        upper[i] += movements[own];
+                        lower[i] -= own == most_moved ? second_movement : movements[most_moved];
+
+                        T bound = std::max(half_gaps[own], lower[i]);
+                        if (upper[i] <= bound) {
+                            continue;
+                        }
+                        upper[i] = Measure::distance(
+                            dot(&data[i * cols], &means[own * cols], cols), norms[i], mean_norms[own]);
+                        if (upper[i] <= bound) {
+                            continue;
+                        }
+                        thread_candidates.push_back(i);
+                    }
+                    changed[t] = assign_rows<Measure>(data, cols, norms, thread_candidates.data(),
+                        thread_candidates.size(), means_t, mean_norms, assignments, upper.data(), lower.data());
+                });
+
+                if (std::accumulate(changed.begin(), changed.end(), std::size_t(0)) == 0) {
+                    break;
+                }
+            }
+
+            return { assignments, means, counts };
+        }
+
+        template <typename Measure, typename T>
+        Result<T> mini_batch(const std::vector<T>& data, std::size_t cols, int k, const Options& options)
+        {
+            std::size_t rows = data.size() / cols;
+            unsigned num_threads = threads_count(options);
+            std::mt19937_64 random(options.seed);
+            auto norms = squared_norms(data, cols, num_threads);
+            std::size_t batch_size = std::max<std::size_t>(options.batch_size, 1);
+
+            // seeding over all the rows would cost as much as the whole clustering
+            std::vector<std::size_t> sample(rows);
+            std::iota(sample.begin(), sample.end(), 0);
+            std::size_t sample_size = std::min(rows, std::max(3 * batch_size, 4 * (std::size_t)k));
+            for (std::size_t i = 0; i < sample_size; i++) {
+                std::swap(sample[i], sample[std::uniform_int_distribution<std::size_t>(i, rows - 1)(random)]);
+            }
+            sample.resize(sample_size);
+            auto means = seed_means<Measure>(data, cols, norms, sample, k, random, num_threads);
+            auto mean_norms = squared_norms(means, cols, 1);
+            auto means_t = transpose(means, k, cols);
+
+            std::vector<int> assignments(rows, -1);
+            std::vector<std::size_t> updates(k, 0);
+            // rows of the batch are sampled without replacement (partial shuffle of the row permutation), so the
+            // threads assign the distinct rows and never write the same assignment
+            batch_size = std::min(batch_size, rows);
+            std::vector<std::size_t> permutation(rows);
+            std::iota(permutation.begin(), permutation.end(), 0);
+            std::vector<std::size_t> batch(batch_size);
+            for (int iteration = 0; iteration < options.max_iterations; iteration++) {
+                for (std::size_t i = 0; i < batch_size; i++) {
+                    std::swap(permutation[i], permutation[std::uniform_int_distribution<std::size_t>(i, rows - 1)(random)]);
+                    batch[i] = permutation[i];
+                }
+                parallel_for(batch_size, num_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+                    assign_rows<Measure>(data, cols, norms, &batch[begin], end - begin, means_t, mean_norms,
+                        assignments, (T*)nullptr, (T*)nullptr);
+                });
+
+                // the each mean moves to the row with the rate decreasing by the number of its updates
+                for (auto row : batch) {
+                    int c = assignments[row];
+                    T rate = T(1) / T(++updates[c]);
+                    T* mean = &means[c * cols];
+                    const T* values = &data[row * cols];
+                    for (std::size_t j = 0; j < cols; j++) {
+                        mean[j] += rate * (values[j] - mean[j]);
+                    }
+                }
+                if constexpr (Measure::normalized) {
+                    normalize_rows(means, cols, 1);
+                }
+                mean_norms = squared_norms(means, cols, 1);
+                means_t = transpose(means, k, cols);
+            }
+
+            std::vector<std::size_t> all_rows(rows);
+            std::iota(all_rows.begin(), all_rows.end(), 0);
+            parallel_for(rows, num_threads, [&](std::size_t begin, std::size_t end, unsigned) {
+                assign_rows<Measure>(data, cols, norms, &all_rows[begin], end - begin, means_t, mean_norms,
+                    assignments, (T*)nullptr, (T*)nullptr);
+            });
+            std::vector<int> counts(k, 0);
+            for (auto c : assignments) {
+                counts[c]++;
+            }
+
+            return { assignments, means, counts };
+        }
+
+    }  // namespace details
+
+    template <typename Measure, typename T>
+    Result<T> lloyd(const std::vector<T>& data, std::size_t cols, int k, const Options& options)
+    {
+        static_assert(std::is_floating_point<T>::value, "kmeans engine requires floating point data");
+        assert(k > 0);
+        assert(data.size() / cols >= (std::size_t)k);
+
+        if constexpr (Measure::normalized) {
+            auto normalized_data = data;
+            details::normalize_rows(normalized_data, cols, details::threads_count(options));
+            return details::lloyd<Measure>(normalized_data, cols, k, options);
+        } else {
+            return details::lloyd<Measure>(data, cols, k, options);
+        }
+    }
+
+    template <typename Measure, typename T>
+    Result<T> mini_batch(const std::vector<T>& data, std::size_t cols, int k, const Options& options)
+    {
+        static_assert(std::is_floating_point<T>::value, "kmeans engine requires floating point data");
+        assert(k > 0);
+        assert(data.size() / cols >= (std::size_t)k);
+
+        if constexpr (Measure::normalized) {
+            auto normalized_data = data;
+            details::normalize_rows(normalized_data, cols, details::threads_count(options));
+            return details::mini_batch<Measure>(normalized_data, cols, k, options);
+        } else {
+            return details::mini_batch<Measure>(data, cols, k, options);
+        }
+    }
+
+}  // namespace kmeans_engine
+}  // namespace metric
+
+#endif
@@ -0,0 +1,120 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+
+#ifndef _METRIC_MAPPING_KMEANS_ENGINE_HPP
+#define _METRIC_MAPPING_KMEANS_ENGINE_HPP
+
+/*
+    K-means for big data sets, like hundreds of thousands of word vectors.
+    Data is one contiguous row-major matrix (rows x cols), the measure is a type, so there is no dispatch
+    in the inner loops. Distances are computed from dot products, that makes the assignment a blocked
+    product of the points and the transposed means, split between threads.
+    Lloyd iterations keep Hamerly bounds (upper bound to the own mean, lower bound to the second closest one),
+    so after the first iterations most of the points are not compared with all the means.
+    Spherical measure normalizes rows once and means after the each update, so the assignment is the max dot product.
+    Mini-batch variant updates the means by random samples of the data and assigns all the points once at the end.
+
+    std::vector<float> data(rows * cols);
+    auto [assignments, means, counts] = metric::kmeans_engine::lloyd<metric::kmeans_engine::Euclidian>(data, cols, 1024);
+    assignments: index of the mean for the each row
+    means: k x cols row-major matrix
+    counts: number of rows of the each mean
+*/
+
+//   References:
+//
+//       Greg Hamerly
+//       Making k-means even faster. 2010.
+//
+//       D. Sculley
+//       Web-scale k-means clustering. 2010.
+
+#include <cstdint>
+#include <vector>
+
+namespace metric {
+namespace kmeans_engine {
+
+    /**
+     * @brief Euclidean distance from the dot product and the squared norms of the vectors
+     */
+    struct Euclidian {
+        static constexpr bool normalized = false;
+
+        template <typename T>
+        static T distance(T dot, T a_squared_norm, T b_squared_norm);
+    };
+
+    /**
+     * @brief Chord distance between directions of the vectors, sqrt(2 - 2 cos).
+     * Order is the same as of the cosine distance, but the triangle inequality holds, so the bounds work.
+     */
+    struct Cosine {
+        static constexpr bool normalized = false;
+
+        template <typename T>
+        static T distance(T dot, T a_squared_norm, T b_squared_norm);
+    };
+
+    /**
+     * @brief Spherical k-means: rows (a normalized copy) and means are unit vectors, distance is sqrt(2 - 2 dot).
+     * Clusters are the same as of the cosine distance, but norms are never computed in the loops and
+     * the means are directions, not averages of the vectors of different length.
+     */
+    struct Spherical {
+        static constexpr bool normalized = true;
+
+        template <typename T>
+        static T distance(T dot, T a_squared_norm, T b_squared_norm);
+    };
+
+    struct Options {
+        int max_iterations = 200;
+        // 0 means std::thread::hardware_concurrency()
+        unsigned num_threads = 0;
+        // rows in the each mini-batch (at most all the rows, sampled without replacement), not used by lloyd
+        std::size_t batch_size = 4096;
+        std::uint64_t seed = 1;
+    };
+
+    template <typename T>
+    struct Result {
+        std::vector<int> assignments;
+        std::vector<T> means;
+        std::vector<int> counts;
+    };
+
+    /**
+     * @brief k-means++ seeding and Lloyd iterations with Hamerly bounds until assignments stop changing
+     *
+     * @param data row-major matrix
+     * @param cols number of columns
+     * @param k number of clusters
+     * @param options
+     * @return assignments, means and counts
+     */
+    template <typename Measure, typename T>
+    Result<T> lloyd(const std::vector<T>& data, std::size_t cols, int k, const Options& options = Options());
+
+    /**
+     * @brief k-means++ seeding on a sample and options.max_iterations mini-batch updates
+     *
+     * @param data row-major matrix
+     * @param cols number of columns
+     * @param k number of clusters
+     * @param options
+     * @return assignments, means and counts
+     */
+    template <typename Measure, typename T>
+    Result<T> mini_batch(const std::vector<T>& data, std::size_t cols, int k, const Options& options = Options());
+
+}  // namespace kmeans_engine
+}  // namespace metric
+
+#include "kmeans_engine.cpp"
+#endif
@@ -13,11 +13,13 @@ Copyright (c) 2018 M.Welsch
 #include <vector>
 #include <limits>
 #include "../space/matrix.hpp"
+#include "../space/lazy_matrix.hpp"
 
 namespace metric {
 namespace kmedoids_details {
-    template <typename recType, typename Metric, typename T>
-    T update_cluster(const metric::Matrix<recType, Metric, T>& DM, std::vector<int>& seeds,
+    // any matrix with size() and operator()(i, j): Matrix or LazyMatrix
+    template <template <typename, typename, typename> class DistanceMatrix, typename recType, typename Metric, typename T>
+    T update_cluster(const DistanceMatrix<recType, Metric, T>& DM, std::vector<int>& seeds,
         std::vector<int>& assignments, std::vector<int>& sec_nearest, std::vector<int>& counts)
     {
 
@@ -52,8 +54,8 @@ namespace kmedoids_details {
         return total_distance;
     }
 
-    template <typename recType, typename Metric, typename T>
-    void init_medoids(int k, const metric::Matrix<recType, Metric, T>& DM, std::vector<int>& seeds,
+    template <template <typename, typename, typename> class DistanceMatrix, typename recType, typename Metric, typename T>
+    void init_medoids(int k, const DistanceMatrix<recType, Metric, T>& DM, std::vector<int>& seeds,
         std::vector<int>& assignments, std::vector<int>& sec_nearest, std::vector<int>& counts)
     {
         seeds.clear();
@@ -97,8 +99,8 @@ namespace kmedoids_details {
         }
     }
 
-    template <typename recType, typename Metric, typename T>
-    T cost(int i, int h, const metric::Matrix<recType, Metric, T>& DM, std::vector<int>& seeds,
+    template <template <typename, typename, typename> class DistanceMatrix, typename recType, typename Metric, typename T>
+    T cost(int i, int h, const DistanceMatrix<recType, Metric, T>& DM, std::vector<int>& seeds,
         std::vector<int>& assignments, std::vector<int>& sec_nearest)
     {
         T total = 0;
@@ -124,82 +126,96 @@ namespace kmedoids_details {
         }
         return total;
     }
-}  // namespace kmedoids_details
-
-template <typename recType, typename Metric, typename T>
-std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> kmedoids(
-    const metric::Matrix<recType, Metric, T>& DM, int k)
-{
-
-    // check arguments
-    size_t n = DM.size();
 
-    assert(n >= 2);  // error("There must be at least two points.")
-    assert(k <= n);  // Attempt to run PAM with more clusters than data.
+    template <template <typename, typename, typename> class DistanceMatrix, typename recType, typename Metric, typename T>
+    std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> kmedoids(
+        const DistanceMatrix<recType, Metric, T>& DM, int k)
+    {
 
-    // sum up the distance matrix
-    T Dsum = 0;
-    for (int i = 0; i < DM.size(); ++i) {
-        for (int j = i; j < DM.size(); ++j) {
-            auto distance = DM(i, j);
-            if (i != j)
-                Dsum += 2 * distance;
-            else
-                Dsum += distance;
+        // check arguments
+        size_t n = DM.size();
+
+        assert(n >= 2);  // error("There must be at least two points.")
+        assert(k <= n);  // Attempt to run PAM with more clusters than data.
+
+        // sum up the distance matrix
+        T Dsum = 0;
+        for (int i = 0; i < DM.size(); ++i) {
+            for (int j = i; j < DM.size(); ++j) {
+                auto distance = DM(i, j);
+                if (i != j)
+                    Dsum += 2 * distance;
+                else
+                    Dsum += distance;
+            }
         }
-    }
 
-    std::vector<int> seeds(k);
-    std::vector<int> counts(k, 0);
-    std::vector<int> assignments(n, 0);
-    std::vector<int> sec_nearest(n, 0);  // Index of second closest medoids.  Used by PAM.
-    T total_distance;  // Total distance tp their medoid
-    T epsilon = 1e-15;  // Normalized sensitivity for convergence
-
-    // set initianl medoids
-    kmedoids_details::init_medoids(k, DM, seeds, assignments, sec_nearest, counts);
-
-    T tolerance = epsilon * Dsum / (DM.size() * DM.size());
-
-    while (true) {
-        // initial cluster
-        for (int i = 0; i < counts.size(); ++i) {
-            counts[i] = 0;
-        }
-        total_distance = kmedoids_details::update_cluster(DM, seeds, assignments, sec_nearest, counts);
+        std::vector<int> seeds(k);
+        std::vector<int> counts(k, 0);
+        std::vector<int> assignments(n, 0);
+        std::vector<int> sec_nearest(n, 0);  // Index of second closest medoids.  Used by PAM.
+        T total_distance;  // Total distance tp their medoid
+        T epsilon = 1e-15;  // Normalized sensitivity for convergence
 
-        //vars to keep track of minimum
-        T minTotalCost = std::numeric_limits<T>::max();
-        int minMedoid = 0;
-        int minObject = 0;
+        // set initianl medoids
+        kmedoids_details::init_medoids(k, DM, seeds, assignments, sec_nearest, counts);
 
-        //iterate over each medoid
-        for (int i = 0; i < k; i++) {
-            //iterate over all non-medoids
-            for (int h = 0; h < assignments.size(); h++) {
-                if (seeds[assignments[h]] == h)
-                    continue;
+        T tolerance = epsilon * Dsum / (DM.size() * DM.size());
 
-                //see if the total cost of swapping i & h was less than min
-                T curCost = kmedoids_details::cost(i, h, DM, seeds, assignments, sec_nearest);
-                if (curCost < minTotalCost) {
-                    minTotalCost = curCost;
-                    minMedoid = i;
-                    minObject = h;
+        while (true) {
+            // initial cluster
+            for (int i = 0; i < counts.size(); ++i) {
+                counts[i] = 0;
+            }
+            total_distance = kmedoids_details::update_cluster(DM, seeds, assignments, sec_nearest, counts);
+
+            //vars to keep track of minimum
+            T minTotalCost = std::numeric_limits<T>::max();
+            int minMedoid = 0;
+            int minObject = 0;
+
+            //iterate over each medoid
+            for (int i = 0; i < k; i++) {
+                //iterate over all non-medoids
+                for (int h = 0; h < assignments.size(); h++) {
+                    if (seeds[assignments[h]] == h)
+                        continue;
+
+                    //see if the total cost of swapping i & h was less than min
+                    T curCost = kmedoids_details::cost(i, h, DM, seeds, assignments, sec_nearest);
+                    if (curCost < minTotalCost) {
+                        minTotalCost = curCost;
+                        minMedoid = i;
+                        minObject = h;
+                    }
                 }
             }
-        }
 
-        // convergence check
-        if (minTotalCost >= -tolerance)
-            break;
+            // convergence check
+            if (minTotalCost >= -tolerance)
+                break;
 
-        // install the new medoid if we found a beneficial swap
-        seeds[minMedoid] = minObject;
-        assignments[minObject] = minMedoid;
+            // install the new medoid if we found a beneficial swap
+            seeds[minMedoid] = minObject;
+            assignments[minObject] = minMedoid;
+        }
+
+        return { assignments, seeds, counts };
     }
+}  // namespace kmedoids_details
 
-    return { assignments, seeds, counts };
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> kmedoids(
+    const metric::Matrix<recType, Metric, T>& DM, int k)
+{
+    return kmedoids_details::kmedoids(DM, k);
+}
+
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> kmedoids(
+    const metric::LazyMatrix<recType, Metric, T>& DM, int k)
+{
+    return kmedoids_details::kmedoids(DM, k);
 }
 
 // TO DO: dublicate version
@@ -11,6 +11,7 @@ Copyright (c) 2018 M.Welsch */
 #include <tuple>
 #include <vector>
 #include "../space/matrix.hpp"
+#include "../space/lazy_matrix.hpp"
 
 namespace metric {
 /**
@@ -24,6 +25,17 @@ template <typename recType, typename Metric, typename T>
 std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> kmedoids(
     const metric::Matrix<recType, Metric, T>& DM, int k);
 
+/**
+ * @brief k-medoids over the distances computed on demand
+ *
+ * @param DM lazy distance matrix
+ * @param k number of clusters
+ * @return same as for the full matrix
+ */
+template <typename recType, typename Metric, typename T>
+std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> kmedoids(
+    const metric::LazyMatrix<recType, Metric, T>& DM, int k);
+
 }  // namespace metric
 
 #include "kmedoids.cpp"
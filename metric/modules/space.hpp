@@ -24,5 +24,6 @@ Copyright (c) PANDA Team
 
 #include "space/tree.hpp"
 #include "space/matrix.hpp"
+#include "space/lazy_matrix.hpp"
 
 #endif
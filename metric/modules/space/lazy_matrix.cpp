@@ -0,0 +1,180 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+#ifndef _METRIC_SPACE_LAZY_MATRIX_CPP
+#define _METRIC_SPACE_LAZY_MATRIX_CPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "lazy_matrix.hpp"
+
+namespace metric {
+
+namespace lazy_matrix_details {
+    // blocks with less distances are computed by the calling thread
+    const std::size_t MIN_PARALLEL_BLOCK = 1 << 16;
+    // cache keeps at least this number of blocks if the budget allows
+    const std::size_t MIN_CACHED_BLOCKS = 8;
+    const std::size_t MAX_BLOCK_ROWS = 256;
+    // serial numbers of the matrices, so a thread never takes the block of a destroyed matrix at the same address
+    inline std::atomic<std::uint64_t> next_serial { 1 };
+}  // namespace lazy_matrix_details
+
+/*** constructor: with a vector data records **/
+template <typename recType, typename Metric, typename distType>
+LazyMatrix<recType, Metric, distType>::LazyMatrix(
+    const std::vector<recType>& p, Metric d, std::size_t memory_budget, unsigned num_threads)
+    : metric_(d)
+    , data_(p)
+    , num_threads_(num_threads > 0 ? num_threads : std::max(std::thread::hardware_concurrency(), 1u))
+    , serial_(lazy_matrix_details::next_serial++)
+{
+    std::size_t row_bytes = std::max<std::size_t>(data_.size(), 1) * sizeof(distType);
+    block_rows_ = std::clamp<std::size_t>(
+        memory_budget / (lazy_matrix_details::MIN_CACHED_BLOCKS * row_bytes), 1, lazy_matrix_details::MAX_BLOCK_ROWS);
+    // zero if even one row doesn't fit, distances are computed directly then
+    max_blocks_ = memory_budget / (block_rows_ * row_bytes);
+}
+
+template <typename recType, typename Metric, typename distType>
+distType LazyMatrix<recType, Metric, distType>::operator()(size_t i, size_t j) const
+{
+    if (i == j) {
+        return 0;
+    }
+    if (max_blocks_ == 0) {
+        return metric_(data_[i], data_[j]);
+    }
+
+    // the last block used by the thread is read without the lock, the lock is taken only when neither i nor j is there;
+    // the block stays valid after its eviction as it is shared and never changed
+    struct LastBlock {
+        std::uint64_t serial = 0;
+        std::size_t id = 0;
+        std::shared_ptr<const Block> rows;
+    };
+    thread_local LastBlock last;
+
+    auto n = data_.size();
+    if (last.serial == serial_) {
+        if (last.id == i / block_rows_) {
+            return (*last.rows)[(i % block_rows_) * n + j];
+        }
+        if (last.id == j / block_rows_) {
+            return (*last.rows)[(j % block_rows_) * n + i];
+        }
+    }
+
+    std::shared_ptr<const Block> block;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if ((block = find_block(i / block_rows_))) {
+            last = { serial_, i / block_rows_, block };
+            return (*block)[(i % block_rows_) * n + j];
+        }
+        if ((block = find_block(j / block_rows_))) {
+            last = { serial_, j / block_rows_, block };
+            return (*block)[(j % block_rows_) * n + i];
+        }
+    }
+
+    // computed without the lock, so the other threads keep reading the cache; if two threads compute the same block,
+    // the first one is cached
+    block = compute_block(i / block_rows_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (blocks_.find(i / block_rows_) == blocks_.end()) {
+            lru_.push_front(i / block_rows_);
+            blocks_[i / block_rows_] = { block, lru_.begin() };
+            computed_blocks_++;
+            while (blocks_.size() > max_blocks_) {
+                blocks_.erase(lru_.back());
+                lru_.pop_back();
+            }
+        }
+    }
+    last = { serial_, i / block_rows_, block };
+    return (*block)[(i % block_rows_) * n + j];
+}
+
+template <typename recType, typename Metric, typename distType>
+std::shared_ptr<const typename LazyMatrix<recType, Metric, distType>::Block>
+LazyMatrix<recType, Metric, distType>::find_block(std::size_t id) const
+{
+    auto found = blocks_.find(id);
+    if (found == blocks_.end()) {
+        return nullptr;
+    }
+    if (found->second.lru_position != lru_.begin()) {
+        lru_.splice(lru_.begin(), lru_, found->second.lru_position);
+    }
+    return found->second.rows;
+}
+
+template <typename recType, typename Metric, typename distType>
+std::shared_ptr<const typename LazyMatrix<recType, Metric, distType>::Block>
+LazyMatrix<recType, Metric, distType>::compute_block(std::size_t id) const
+{
+    auto n = data_.size();
+    auto first_row = id * block_rows_;
+    auto rows = std::min(block_rows_, n - first_row);
+    auto block = std::make_shared<Block>(rows * n);
+
+    auto compute = [&](std::size_t begin, std::size_t end) {
+        for (auto k = begin; k < end; k++) {
+            auto i = first_row + k / n;
+            auto j = k % n;
+            (*block)[k] = i == j ? 0 : metric_(data_[i], data_[j]);
+        }
+    };
+
+    std::size_t num_threads = std::min<std::size_t>(num_threads_, block->size() / lazy_matrix_details::MIN_PARALLEL_BLOCK);
+    if (num_threads <= 1) {
+        compute(0, block->size());
+        return block;
+    }
+
+    std::vector<std::thread> workers;
+    std::size_t chunk = (block->size() + num_threads - 1) / num_threads;
+    for (std::size_t t = 0; t < num_threads; t++) {
+        workers.emplace_back(compute, t * chunk, std::min(block->size(), (t + 1) * chunk));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return block;
+}
+
+template <typename recType, typename Metric, typename distType>
+recType LazyMatrix<recType, Metric, distType>::operator[](size_t id) const
+{
+    return data_[id];
+}
+
+template <typename recType, typename Metric, typename distType>
+size_t LazyMatrix<recType, Metric, distType>::size() const
+{
+    return data_.size();
+}
+
+template <typename recType, typename Metric, typename distType>
+size_t LazyMatrix<recType, Metric, distType>::block_rows() const
+{
+    return block_rows_;
+}
+
+template <typename recType, typename Metric, typename distType>
+size_t LazyMatrix<recType, Metric, distType>::computed_blocks() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return computed_blocks_;
+}
+
+}  // namespace metric
+
+#endif
@@ -0,0 +1,130 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Panda Team
+*/
+
+#ifndef _METRIC_SPACE_LAZY_MATRIX_HPP
+#define _METRIC_SPACE_LAZY_MATRIX_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "../distance.hpp"
+
+namespace metric {
+
+/**
+ * @class LazyMatrix
+ *
+ * @brief distance matrix that computes distances on demand, with the same access interface as Matrix, so it can be
+ * passed to dbscan and kmedoids. Rows are computed by blocks, in parallel for the large blocks, and recently
+ * used blocks are kept in the LRU cache within the memory budget. Distance (i, j) is taken from the cached block
+ * of i or of j, as the matrix is symmetric. Access is thread safe: the block used last by the each thread is read
+ * without locking, so a thread can keep one evicted block over the budget until it moves to another block.
+ *
+ */
+template <typename recType, typename Metric = metric::Euclidian<typename recType::value_type>,
+    typename distType = float>
+class LazyMatrix {
+public:
+    static constexpr std::size_t DEFAULT_MEMORY_BUDGET = std::size_t(256) << 20;
+
+    /*** Constructors ***/
+
+    /**
+     * @brief Construct a new LazyMatrix over the data records, nothing is computed here
+     *
+     * @param p vector of data records
+     * @param d metric object to use as distance
+     * @param memory_budget bytes for the cached blocks
+     * @param num_threads threads to compute a block, 0 means hardware concurrency
+     */
+    LazyMatrix(const std::vector<recType>& p, Metric d = Metric(), std::size_t memory_budget = DEFAULT_MEMORY_BUDGET,
+        unsigned num_threads = 0);
+
+    /*** Access Operations ***/
+
+    /**
+     * @brief access a data record by ID
+     *
+     * @param id data record ID
+     * @return data record with ID == id
+     */
+    recType operator[](size_t id) const;
+
+    /**
+     * @brief access a distance by two IDs, computes the block of rows if neither i nor j is cached
+     *
+     * @param i first ID
+     * @param j second ID
+     * @return distance between i and j
+     */
+    distType operator()(size_t i, size_t j) const;
+
+    /*** information ***/
+
+    /**
+     * @brief size of matrix
+     *
+     * @return amount of data records
+     */
+    size_t size() const;
+
+    /**
+     * @brief
+     *
+     * @return rows in one cached block
+     */
+    size_t block_rows() const;
+
+    /**
+     * @brief
+     *
+     * @return number of blocks computed since construction, including the evicted and computed again
+     */
+    size_t computed_blocks() const;
+
+private:
+    using Block = std::vector<distType>;
+
+    struct CachedBlock {
+        std::shared_ptr<const Block> rows;
+        std::list<std::size_t>::iterator lru_position;
+    };
+
+    /**
+     * @brief distances of the rows [id * block_rows, (id + 1) * block_rows) to all the records
+     */
+    std::shared_ptr<const Block> compute_block(std::size_t id) const;
+
+    /**
+     * @brief cached block or nullptr, found block becomes the most recently used, the lock is held by the caller
+     */
+    std::shared_ptr<const Block> find_block(std::size_t id) const;
+
+    /*** Properties ***/
+    Metric metric_;
+    std::vector<recType> data_;
+    std::size_t block_rows_;
+    std::size_t max_blocks_;
+    unsigned num_threads_;
+    std::uint64_t serial_;
+
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<std::size_t, CachedBlock> blocks_;
+    // most recently used first
+    mutable std::list<std::size_t> lru_;
+    mutable std::size_t computed_blocks_ = 0;
+};
+
+}  // namespace metric
+
+#include "lazy_matrix.cpp"
+
+#endif  // Header Guard
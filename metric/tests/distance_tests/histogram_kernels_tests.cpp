@@ -0,0 +1,117 @@
+/*
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+  Copyright (c) 2019 Panda Team
+*/
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "modules/distance.hpp"
+#include "modules/space/matrix.hpp"
+
+#define BOOST_TEST_MODULE Main
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+std::vector<int> make_histogram(std::size_t size, int max_count, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> count(0, max_count);
+    std::vector<int> histogram(size);
+    for (auto& value : histogram) {
+        value = count(random);
+    }
+    return histogram;
+}
+
+// the generic loops over the values as doubles, for the reference
+double reference_euclidian(const std::vector<int>& a, const std::vector<int>& b)
+{
+    double sum = 0;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        sum += double(a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return std::sqrt(sum);
+}
+
+double reference_cosine(const std::vector<int>& a, const std::vector<int>& b)
+{
+    double dot = 0, a_sq_norm = 0, b_sq_norm = 0;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        dot += double(a[i]) * b[i];
+        a_sq_norm += double(a[i]) * a[i];
+        b_sq_norm += double(b[i]) * b[i];
+    }
+    return dot / (std::sqrt(a_sq_norm) * std::sqrt(b_sq_norm));
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(KernelsAreExact)
+{
+    // sizes with and without the tail after the blocks of 16
+    for (std::size_t size : { 0, 5, 16, 1024, 1031 }) {
+        auto a = make_histogram(size, 40, 1);
+        auto b = make_histogram(size, 40, 2);
+
+        BOOST_CHECK_EQUAL(metric::histogram_kernels::squared_euclidean(a.data(), b.data(), size),
+            metric::histogram_kernels::details::squared_euclidean_scalar(a.data(), b.data(), size));
+
+        auto sums = metric::histogram_kernels::dot_and_norms(a.data(), b.data(), size);
+        auto scalar_sums = metric::histogram_kernels::details::dot_and_norms_scalar(a.data(), b.data(), size);
+        BOOST_CHECK_EQUAL(sums.dot, scalar_sums.dot);
+        BOOST_CHECK_EQUAL(sums.a_sq_norm, scalar_sums.a_sq_norm);
+        BOOST_CHECK_EQUAL(sums.b_sq_norm, scalar_sums.b_sq_norm);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LargeValuesFallBackToScalar)
+{
+    auto a = make_histogram(64, 40, 3);
+    auto b = make_histogram(64, 40, 4);
+    // don't fit int16, and the differences of the extremes overflow int32
+    a[3] = 100000;
+    b[20] = -70000;
+    a[40] = std::numeric_limits<int>::max();
+    b[40] = std::numeric_limits<int>::min();
+
+    BOOST_CHECK_EQUAL(metric::histogram_kernels::squared_euclidean(a.data(), b.data(), a.size()),
+        metric::histogram_kernels::details::squared_euclidean_scalar(a.data(), b.data(), a.size()));
+
+    auto sums = metric::histogram_kernels::dot_and_norms(a.data(), b.data(), a.size());
+    auto scalar_sums = metric::histogram_kernels::details::dot_and_norms_scalar(a.data(), b.data(), a.size());
+    BOOST_CHECK_EQUAL(sums.dot, scalar_sums.dot);
+    BOOST_CHECK_EQUAL(sums.a_sq_norm, scalar_sums.a_sq_norm);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsUseKernels)
+{
+    auto a = make_histogram(1024, 10, 5);
+    auto b = make_histogram(1024, 10, 6);
+
+    BOOST_CHECK_CLOSE(metric::Euclidian<float>()(a, b), reference_euclidian(a, b), 1e-4);
+    BOOST_CHECK_CLOSE(metric::Euclidian<double>()(a, b), reference_euclidian(a, b), 1e-12);
+    BOOST_CHECK_CLOSE(metric::Cosine<double>()(a, b), reference_cosine(a, b), 1e-12);
+    BOOST_CHECK_CLOSE(metric::Cosine<float>()(a, b), reference_cosine(a, b), 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(MatrixOfHistograms)
+{
+    std::vector<std::vector<int>> histograms;
+    for (unsigned i = 0; i < 5; i++) {
+        histograms.push_back(make_histogram(100, 5, i));
+    }
+
+    metric::Matrix<std::vector<int>, metric::Euclidian<float>> matrix(histograms);
+    for (std::size_t i = 0; i < histograms.size(); i++) {
+        for (std::size_t j = 0; j < histograms.size(); j++) {
+            BOOST_CHECK_CLOSE(matrix(i, j) + 1, reference_euclidian(histograms[i], histograms[j]) + 1, 1e-4);
+        }
+    }
+}
@@ -0,0 +1,163 @@
+/*
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+  Copyright (c) 2019 Panda Team
+*/
+#include <array>
+#include <cmath>
+#include <deque>
+#include <random>
+
+#include "modules/distance.hpp"
+
+#define BOOST_TEST_MODULE Main
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+template <typename T>
+std::vector<T> make_vector(std::size_t size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<T> value(-1, 1);
+    std::vector<T> result(size);
+    for (auto& x : result) {
+        x = value(random);
+    }
+    return result;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(DenseContainers)
+{
+    BOOST_CHECK(metric::simd_kernels::is_dense<std::vector<float>>);
+    BOOST_CHECK(metric::simd_kernels::is_dense<std::vector<double>>);
+    BOOST_CHECK((metric::simd_kernels::is_dense<std::array<double, 3>>));
+    BOOST_CHECK(metric::simd_kernels::is_dense<blaze::DynamicVector<double>>);
+    BOOST_CHECK(!metric::simd_kernels::is_dense<std::vector<int>>);
+    BOOST_CHECK(!metric::simd_kernels::is_dense<std::deque<double>>);
+    BOOST_CHECK((metric::simd_kernels::is_dense_of<std::vector<float>, float>));
+    BOOST_CHECK((!metric::simd_kernels::is_dense_of<std::vector<float>, double>));
+}
+
+BOOST_AUTO_TEST_CASE(WiderDistanceTypeKeepsPrecision)
+{
+    // float values summed in double, as the generic loop does, not in float
+    std::vector<float> a(100000, 1.0f);
+    std::vector<float> b(100000, 0.0f);
+    a[0] = 1e4f;
+    double squared = 1e8 - 1 + 100000;
+    BOOST_CHECK_EQUAL(metric::Euclidian<double>()(a, b), std::sqrt(squared));
+
+    std::vector<float> c(a.begin(), a.end());
+    c[0] = 1;
+    double dot = 1e4 + 99999;
+    BOOST_CHECK_CLOSE(metric::Cosine<double>()(a, c), dot / (std::sqrt(squared) * std::sqrt(100000.0)), 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(KernelsMatchScalar)
+{
+    namespace kernels = metric::simd_kernels;
+    // sizes with and without the tails after the AVX2 and AVX-512 blocks
+    for (std::size_t size : { 0, 3, 8, 17, 100, 1024 }) {
+        auto a = make_vector<double>(size, 1);
+        auto b = make_vector<double>(size, 2);
+        BOOST_CHECK_CLOSE(kernels::squared_euclidean(a.data(), b.data(), size) + 1,
+            kernels::details::squared_euclidean_scalar(a.data(), b.data(), size) + 1, 1e-10);
+        BOOST_CHECK_CLOSE(kernels::manhatten(a.data(), b.data(), size) + 1,
+            kernels::details::manhatten_scalar(a.data(), b.data(), size) + 1, 1e-10);
+        BOOST_CHECK_EQUAL(kernels::chebyshev(a.data(), b.data(), size),
+            kernels::details::chebyshev_scalar(a.data(), b.data(), size));
+        auto sums = kernels::dot_and_norms(a.data(), b.data(), size);
+        auto scalar_sums = kernels::details::dot_and_norms_scalar(a.data(), b.data(), size);
+        BOOST_CHECK_CLOSE(sums.dot + 100, scalar_sums.dot + 100, 1e-10);
+        BOOST_CHECK_CLOSE(sums.a_sq_norm + 1, scalar_sums.a_sq_norm + 1, 1e-10);
+
+        auto a_float = make_vector<float>(size, 3);
+        auto b_float = make_vector<float>(size, 4);
+        BOOST_CHECK_CLOSE(kernels::squared_euclidean(a_float.data(), b_float.data(), size) + 1,
+            kernels::details::squared_euclidean_scalar(a_float.data(), b_float.data(), size) + 1, 1e-3);
+        BOOST_CHECK_EQUAL(kernels::chebyshev(a_float.data(), b_float.data(), size),
+            kernels::details::chebyshev_scalar(a_float.data(), b_float.data(), size));
+    }
+}
+
+#if defined(METRIC_SIMD_KERNELS_X86)
+BOOST_AUTO_TEST_CASE(Avx2KernelsOnAvx512Cpu)
+{
+    // the dispatch takes the best level, so AVX2 kernels are checked directly
+    namespace kernels = metric::simd_kernels;
+    if (kernels::level() == kernels::Level::Scalar) {
+        return;
+    }
+    auto a = make_vector<double>(103, 8);
+    auto b = make_vector<double>(103, 9);
+    BOOST_CHECK_CLOSE(kernels::details::squared_euclidean_avx2(a.data(), b.data(), a.size()),
+        kernels::details::squared_euclidean_scalar(a.data(), b.data(), a.size()), 1e-10);
+    BOOST_CHECK_CLOSE(kernels::details::manhatten_avx2(a.data(), b.data(), a.size()),
+        kernels::details::manhatten_scalar(a.data(), b.data(), a.size()), 1e-10);
+    BOOST_CHECK_EQUAL(kernels::details::chebyshev_avx2(a.data(), b.data(), a.size()),
+        kernels::details::chebyshev_scalar(a.data(), b.data(), a.size()));
+    BOOST_CHECK_CLOSE(kernels::details::dot_and_norms_avx2(a.data(), b.data(), a.size()).b_sq_norm,
+        kernels::details::dot_and_norms_scalar(a.data(), b.data(), a.size()).b_sq_norm, 1e-10);
+
+    auto a_float = make_vector<float>(103, 10);
+    auto b_float = make_vector<float>(103, 11);
+    BOOST_CHECK_CLOSE(kernels::details::squared_euclidean_avx2(a_float.data(), b_float.data(), a_float.size()),
+        kernels::details::squared_euclidean_scalar(a_float.data(), b_float.data(), a_float.size()), 1e-3);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(MetricsOverDenseAndGenericContainers)
+{
+    auto a = make_vector<double>(37, 5);
+    auto b = make_vector<double>(37, 6);
+    std::deque<double> a_deque(a.begin(), a.end());
+    std::deque<double> b_deque(b.begin(), b.end());
+    blaze::DynamicVector<double> a_blaze(a.size());
+    blaze::DynamicVector<double> b_blaze(b.size());
+    for (std::size_t i = 0; i < a.size(); i++) {
+        a_blaze[i] = a[i];
+        b_blaze[i] = b[i];
+    }
+
+    BOOST_CHECK_CLOSE(metric::Euclidian<double>()(a, b), metric::Euclidian<double>()(a_deque, b_deque), 1e-10);
+    BOOST_CHECK_CLOSE(metric::Euclidian<double>()(a_blaze, b_blaze), metric::Euclidian<double>()(a_deque, b_deque), 1e-10);
+    BOOST_CHECK_CLOSE(metric::Manhatten<double>()(a, b), metric::Manhatten<double>()(a_deque, b_deque), 1e-10);
+    BOOST_CHECK_CLOSE(metric::Cosine<double>()(a, b), metric::Cosine<double>()(a_deque, b_deque), 1e-10);
+    BOOST_CHECK_CLOSE(metric::CosineInverted<double>()(a, b), metric::CosineInverted<double>()(a_deque, b_deque), 1e-10);
+    BOOST_CHECK_EQUAL(metric::Chebyshev<double>()(a, b), metric::Chebyshev<double>()(a_deque, b_deque));
+    BOOST_CHECK_CLOSE(metric::Euclidian_thresholded<double>(10, 2)(a, b), metric::Euclidian_thresholded<double>(10, 2)(a_deque, b_deque), 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(DifferentLengths)
+{
+    // only the common part is compared, the longer record is not read past the shorter one
+    std::deque<double> a = { 1, 2, 3 };
+    std::deque<double> b = { 1, 2, 3, 4, 5 };
+    BOOST_CHECK_EQUAL(metric::Manhatten<double>()(a, b), 0);
+    BOOST_CHECK_EQUAL(metric::P_norm<double>(2)(a, b), 0);
+    BOOST_CHECK_EQUAL(metric::Chebyshev<double>()(std::vector<double>(a.begin(), a.end()), std::vector<double>(b.begin(), b.end())), 0);
+    BOOST_CHECK_CLOSE(metric::Cosine<double>()(a, b), 1, 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(BatchDistance)
+{
+    auto one = make_vector<float>(50, 7);
+    std::vector<std::vector<float>> many;
+    for (unsigned i = 0; i < 10; i++) {
+        many.push_back(make_vector<float>(50, 10 + i));
+    }
+
+    metric::Euclidian<float> euclidian;
+    auto distances = metric::distance(euclidian, one, many);
+    BOOST_REQUIRE_EQUAL(distances.size(), many.size());
+    for (std::size_t i = 0; i < many.size(); i++) {
+        BOOST_CHECK_EQUAL(distances[i], euclidian(one, many[i]));
+    }
+}
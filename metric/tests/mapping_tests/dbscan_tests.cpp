@@ -0,0 +1,99 @@
+/*
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+  Copyright (c) 2019 Panda Team
+*/
+#include <random>
+
+#include "modules/distance.hpp"
+#include "modules/mapping/dbscan.hpp"
+
+#define BOOST_TEST_MODULE Main
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+using Record = std::vector<float>;
+
+// dense blobs, sparse bridges between some of them and uniform noise, so there are border points reachable
+// from the several clusters
+std::vector<Record> make_points(std::size_t size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::normal_distribution<float> blob(0, 0.4);
+    std::uniform_real_distribution<float> uniform(-2, 14);
+    std::uniform_int_distribution<int> kind(0, 9);
+    std::vector<Record> points(size);
+    for (auto& point : points) {
+        auto k = kind(random);
+        if (k < 7) {
+            point = { (k % 4) * 3 + blob(random), (k / 4) * 3 + blob(random) };
+        } else {
+            point = { uniform(random), uniform(random) };
+        }
+    }
+    return points;
+}
+
+void check_same(const std::tuple<std::vector<int>, std::vector<int>, std::vector<int>>& expected,
+    const std::tuple<std::vector<int>, std::vector<int>, std::vector<int>>& result)
+{
+    BOOST_CHECK(std::get<0>(expected) == std::get<0>(result));
+    BOOST_CHECK(std::get<1>(expected) == std::get<1>(result));
+    BOOST_CHECK(std::get<2>(expected) == std::get<2>(result));
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(SameAsSequential)
+{
+    for (unsigned seed = 0; seed < 4; seed++) {
+        auto points = make_points(1000, seed);
+        metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+        for (std::size_t minpts : { 1, 3, 8 }) {
+            auto expected = metric::dbscan(matrix, 0.6f, minpts);
+            BOOST_CHECK_GT(std::get<1>(expected).size(), 1);
+
+            for (unsigned num_threads : { 1, 4, 16 }) {
+                check_same(expected, metric::parallel_dbscan(matrix, 0.6f, minpts, num_threads));
+                check_same(expected, metric::parallel_dbscan(points, metric::Euclidian<float>(), 0.6f, minpts, num_threads));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LazyMatrix)
+{
+    auto points = make_points(500, 5);
+    metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+    metric::LazyMatrix<Record, metric::Euclidian<float>> lazy(points, metric::Euclidian<float>(), 500 * 4 * 32, 2);
+
+    check_same(metric::dbscan(matrix, 0.5f, 4), metric::parallel_dbscan(lazy, 0.5f, 4, 4));
+}
+
+BOOST_AUTO_TEST_CASE(Neighbourhoods)
+{
+    // cores 0 and 3, 6 is a border of the both, 7 is noise
+    std::vector<std::vector<int>> neighbours = {
+        { 0, 1, 2, 6 },
+        { 1, 0 },
+        { 2, 0 },
+        { 3, 4, 5, 6 },
+        { 4, 3 },
+        { 5, 3 },
+        { 6, 3, 0 },
+        { 7 },
+    };
+    auto [assignments, seeds, counts] = metric::parallel_dbscan(neighbours, 4);
+
+    BOOST_CHECK(assignments == std::vector<int>({ 1, 1, 1, 2, 2, 2, 1, 0 }));
+    BOOST_CHECK(seeds == std::vector<int>({ 0, 3 }));
+    BOOST_CHECK(counts == std::vector<int>({ 4, 3 }));
+
+    auto single = metric::parallel_dbscan(std::vector<std::vector<int>>({ { 0 } }), 1);
+    BOOST_CHECK(std::get<0>(single) == std::vector<int>({ 1 }));
+}
@@ -0,0 +1,141 @@
+/*
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+  Copyright (c) 2019 Panda Team
+*/
+#include <map>
+#include <random>
+
+#include "modules/distance.hpp"
+#include "modules/mapping/dbscan.hpp"
+#include "modules/mapping/hdbscan.hpp"
+
+#define BOOST_TEST_MODULE Main
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+using Record = std::vector<float>;
+
+// blobs of the given spreads around (10 * k, 0), then uniform noise
+std::vector<Record> make_points(const std::vector<float>& spreads, std::size_t blob_size, std::size_t noise_size,
+    unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> uniform(-5, 10 * spreads.size());
+    std::vector<Record> points;
+    for (std::size_t k = 0; k < spreads.size(); k++) {
+        std::normal_distribution<float> blob(0, spreads[k]);
+        for (std::size_t i = 0; i < blob_size; i++) {
+            points.push_back({ 10.0f * k + blob(random), blob(random) });
+        }
+    }
+    for (std::size_t i = 0; i < noise_size; i++) {
+        points.push_back({ uniform(random), uniform(random) / 4 });
+    }
+    return points;
+}
+
+std::vector<metric::HDBSCAN<float>::Edge> all_pairs(const std::vector<Record>& points)
+{
+    metric::Euclidian<float> distance;
+    std::vector<metric::HDBSCAN<float>::Edge> pairs;
+    for (std::size_t i = 0; i < points.size(); i++) {
+        for (std::size_t j = i + 1; j < points.size(); j++) {
+            pairs.push_back({ (int)i, (int)j, distance(points[i], points[j]) });
+        }
+    }
+    return pairs;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(LevelsAreDbscan)
+{
+    auto points = make_points({ 0.5, 1, 2 }, 150, 100, 1);
+    metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+
+    for (std::size_t minpts : { 1, 2 }) {
+        metric::HDBSCAN<float> hierarchy(points, metric::Euclidian<float>(), minpts);
+        BOOST_CHECK_EQUAL(hierarchy.size(), points.size());
+        BOOST_CHECK_EQUAL(hierarchy.spanning_tree().size(), points.size() - 1);
+
+        for (float eps : { 0.1f, 0.3f, 0.7f, 1.5f, 4.0f }) {
+            auto [assignments, seeds, counts] = metric::dbscan(matrix, eps, minpts);
+            auto [level_assignments, level_seeds, level_counts] = hierarchy.extract(eps);
+            BOOST_CHECK(assignments == level_assignments);
+            BOOST_CHECK(seeds == level_seeds);
+            BOOST_CHECK(counts == level_counts);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LargerMinptsDropBorders)
+{
+    auto points = make_points({ 0.5, 1 }, 100, 50, 2);
+    metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+    metric::HDBSCAN<float> hierarchy(points, metric::Euclidian<float>(), 5);
+
+    auto [assignments, seeds, counts] = metric::dbscan(matrix, 0.8f, 5);
+    auto [level_assignments, level_seeds, level_counts] = hierarchy.extract(0.8f);
+    for (std::size_t p = 0; p < points.size(); p++) {
+        if (hierarchy.core_distances()[p] < 0.8f) {
+            BOOST_CHECK_EQUAL(level_assignments[p], assignments[p]);
+        } else {
+            BOOST_CHECK_EQUAL(level_assignments[p], 0);
+        }
+    }
+    BOOST_CHECK(seeds == level_seeds);
+}
+
+BOOST_AUTO_TEST_CASE(CandidatePairs)
+{
+    auto points = make_points({ 0.5, 1, 2 }, 60, 30, 3);
+    for (std::size_t minpts : { 1, 3 }) {
+        metric::HDBSCAN<float> hierarchy(points, metric::Euclidian<float>(), minpts);
+        metric::HDBSCAN<float> pairs_hierarchy(points.size(), all_pairs(points), minpts);
+
+        BOOST_CHECK(hierarchy.core_distances() == pairs_hierarchy.core_distances());
+        for (float eps : { 0.3f, 1.0f, 3.0f }) {
+            BOOST_CHECK(hierarchy.extract(eps) == pairs_hierarchy.extract(eps));
+        }
+        // larger minpts make equal mutual reachability distances, so the trees and the stable clusters can differ
+        if (minpts == 1) {
+            BOOST_CHECK(hierarchy.extract_stable(5) == pairs_hierarchy.extract_stable(5));
+        }
+    }
+
+    // pairs of the separate components only, the rest is too far
+    std::vector<metric::HDBSCAN<float>::Edge> pairs = { { 0, 1, 1 }, { 1, 2, 1 }, { 3, 4, 1 }, { 4, 5, 2 } };
+    metric::HDBSCAN<float> forest(7, pairs, 2);
+    BOOST_CHECK_EQUAL(forest.spanning_tree().size(), 4);
+    BOOST_CHECK(std::get<0>(forest.extract(1.5f)) == std::vector<int>({ 1, 1, 1, 2, 2, 0, 0 }));
+    BOOST_CHECK(std::get<0>(forest.extract_stable(3)) == std::vector<int>({ 1, 1, 1, 2, 2, 2, 0 }));
+}
+
+BOOST_AUTO_TEST_CASE(StableClustersOfDifferentDensity)
+{
+    // no eps finds both the dense and the sparse blob without merging or splitting them
+    auto points = make_points({ 0.2, 0.4, 1.2 }, 200, 0, 4);
+    metric::HDBSCAN<float> hierarchy(points, metric::Euclidian<float>(), 5);
+    auto [assignments, seeds, counts] = hierarchy.extract_stable(20);
+
+    BOOST_CHECK_EQUAL(seeds.size(), 3);
+    for (std::size_t k = 0; k < 3; k++) {
+        // most of the blob is one cluster, and that cluster has nothing else
+        std::map<int, std::size_t> clusters;
+        for (std::size_t p = k * 200; p < (k + 1) * 200; p++) {
+            clusters[assignments[p]]++;
+        }
+        BOOST_CHECK_GT(clusters[k + 1], 150);
+        BOOST_CHECK_LE(counts[k], 200);
+    }
+
+    // the same hierarchy gives any level without clustering again
+    BOOST_CHECK_EQUAL(std::get<1>(hierarchy.extract(0.01f)).size(), 0);
+    BOOST_CHECK_EQUAL(std::get<1>(hierarchy.extract(100.0f)).size(), 1);
+}
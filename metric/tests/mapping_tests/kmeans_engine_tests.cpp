@@ -0,0 +1,173 @@
+/*
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+  Copyright (c) 2019 Panda Team
+*/
+#include <limits>
+#include <numeric>
+#include <random>
+#include <set>
+
+#include "modules/mapping/kmeans.hpp"
+#include "modules/mapping/kmeans_engine.hpp"
+
+#define BOOST_TEST_MODULE Main
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+// num_clusters blobs around the far apart centers, row i belongs to the blob i % num_clusters
+std::vector<float> make_blobs(std::size_t rows, std::size_t cols, int num_clusters)
+{
+    std::mt19937 random(7);
+    std::normal_distribution<float> noise(0, 0.1f);
+    std::vector<float> data(rows * cols);
+    for (std::size_t i = 0; i < rows; i++) {
+        for (std::size_t j = 0; j < cols; j++) {
+            data[i * cols + j] = (j % num_clusters == i % num_clusters ? 10.0f : 0.0f) + noise(random);
+        }
+    }
+    return data;
+}
+
+void check_blobs(const std::vector<int>& assignments, const std::vector<int>& counts, int num_clusters)
+{
+    std::set<int> found;
+    for (int c = 0; c < num_clusters; c++) {
+        found.insert(assignments[c]);
+        for (std::size_t i = c; i < assignments.size(); i += num_clusters) {
+            BOOST_REQUIRE_EQUAL(assignments[i], assignments[c]);
+        }
+    }
+    BOOST_CHECK_EQUAL(found.size(), num_clusters);
+    BOOST_CHECK_EQUAL(std::accumulate(counts.begin(), counts.end(), 0), (int)assignments.size());
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(LloydEuclidian)
+{
+    std::size_t cols = 8;
+    auto data = make_blobs(3000, cols, 4);
+    metric::kmeans_engine::Options options;
+    options.num_threads = 3;
+
+    auto [assignments, means, counts] = metric::kmeans_engine::lloyd<metric::kmeans_engine::Euclidian>(data, cols, 4, options);
+
+    BOOST_CHECK_EQUAL(means.size(), 4 * cols);
+    check_blobs(assignments, counts, 4);
+}
+
+BOOST_AUTO_TEST_CASE(LloydCosine)
+{
+    std::size_t cols = 8;
+    auto data = make_blobs(3000, cols, 4);
+
+    auto [assignments, means, counts] = metric::kmeans_engine::lloyd<metric::kmeans_engine::Cosine>(data, cols, 4);
+
+    check_blobs(assignments, counts, 4);
+}
+
+BOOST_AUTO_TEST_CASE(LloydSpherical)
+{
+    std::size_t cols = 8;
+    auto data = make_blobs(3000, cols, 4);
+    // length of the vector doesn't matter for the spherical clustering
+    for (std::size_t i = 0; i < 3000; i += 2) {
+        for (std::size_t j = 0; j < cols; j++) {
+            data[i * cols + j] *= 5;
+        }
+    }
+
+    auto [assignments, means, counts] = metric::kmeans_engine::lloyd<metric::kmeans_engine::Spherical>(data, cols, 4);
+
+    check_blobs(assignments, counts, 4);
+    for (int c = 0; c < 4; c++) {
+        float norm = 0;
+        for (std::size_t j = 0; j < cols; j++) {
+            norm += means[c * cols + j] * means[c * cols + j];
+        }
+        BOOST_CHECK_CLOSE(norm, 1.0f, 0.01);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LloydBoundsKeepClosestMean)
+{
+    // overlapping clusters, so the assignments change for many iterations and the bounds are used
+    std::size_t cols = 6;
+    std::size_t rows = 5000;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    std::vector<float> data(rows * cols);
+    for (auto& value : data) {
+        value = uniform(random);
+    }
+    int k = 20;
+    metric::kmeans_engine::Options options;
+    options.num_threads = 4;
+
+    auto [assignments, means, counts] = metric::kmeans_engine::lloyd<metric::kmeans_engine::Euclidian>(data, cols, k, options);
+
+    // converged assignment is the closest mean for the each row
+    for (std::size_t i = 0; i < rows; i++) {
+        int closest = 0;
+        float closest_distance = std::numeric_limits<float>::max();
+        for (int c = 0; c < k; c++) {
+            float distance = 0;
+            for (std::size_t j = 0; j < cols; j++) {
+                float delta = data[i * cols + j] - means[c * cols + j];
+                distance += delta * delta;
+            }
+            if (distance < closest_distance) {
+                closest_distance = distance;
+                closest = c;
+            }
+        }
+        BOOST_REQUIRE_EQUAL(assignments[i], closest);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MiniBatchSpherical)
+{
+    std::size_t cols = 8;
+    auto data = make_blobs(20000, cols, 4);
+    metric::kmeans_engine::Options options;
+    options.batch_size = 256;
+    options.max_iterations = 50;
+
+    auto [assignments, means, counts] = metric::kmeans_engine::mini_batch<metric::kmeans_engine::Spherical>(data, cols, 4, options);
+
+    check_blobs(assignments, counts, 4);
+}
+
+BOOST_AUTO_TEST_CASE(LegacyMeansAreAverages)
+{
+    // two far apart pairs, means should be the averages of the pairs
+    std::vector<std::vector<double>> data { { 0, 0 }, { 2, 0 }, { 100, 100 }, { 100, 102 } };
+
+    auto [assignments, means, counts] = metric::kmeans(data, 2);
+
+    for (int c = 0; c < 2; c++) {
+        BOOST_CHECK_EQUAL(counts[c], 2);
+        auto expected = means[c][0] < 50 ? std::vector<double> { 1, 0 } : std::vector<double> { 100, 101 };
+        BOOST_CHECK_CLOSE(means[c][0], expected[0], 1e-9);
+        BOOST_CHECK_CLOSE(means[c][1] + 1, expected[1] + 1, 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MiniBatch)
+{
+    std::size_t cols = 8;
+    auto data = make_blobs(20000, cols, 4);
+    metric::kmeans_engine::Options options;
+    options.batch_size = 256;
+    options.max_iterations = 50;
+
+    auto [assignments, means, counts] = metric::kmeans_engine::mini_batch<metric::kmeans_engine::Euclidian>(data, cols, 4, options);
+
+    check_blobs(assignments, counts, 4);
+}
@@ -0,0 +1,119 @@
+/*
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+  Copyright (c) 2019 Panda Team
+*/
+#include <random>
+#include <thread>
+
+#include "modules/distance.hpp"
+#include "modules/space/matrix.hpp"
+#include "modules/space/lazy_matrix.hpp"
+#include "modules/mapping/dbscan.hpp"
+#include "modules/mapping/kmedoids.hpp"
+
+#define BOOST_TEST_MODULE Main
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+using Record = std::vector<float>;
+
+// points around a few centers, so dbscan finds clusters and noise
+std::vector<Record> make_points(std::size_t size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::normal_distribution<float> noise(0, 0.3);
+    std::uniform_int_distribution<int> center(0, 4);
+    std::vector<Record> points(size);
+    for (auto& point : points) {
+        auto c = center(random);
+        point = { c * 3 + noise(random), c * 2 + noise(random), noise(random) };
+    }
+    return points;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(SameDistancesAsMatrix)
+{
+    auto points = make_points(300, 1);
+    metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+    // a budget of eight rows, so blocks are evicted and computed again
+    metric::LazyMatrix<Record, metric::Euclidian<float>> lazy(points, metric::Euclidian<float>(), 300 * 4 * 8);
+
+    BOOST_CHECK_EQUAL(lazy.size(), matrix.size());
+    BOOST_CHECK_EQUAL(lazy.block_rows(), 1);
+    for (std::size_t i = 0; i < points.size(); i++) {
+        for (std::size_t j = 0; j < points.size(); j++) {
+            BOOST_CHECK_EQUAL(lazy(i, j), matrix(i, j));
+        }
+    }
+    BOOST_CHECK_EQUAL(lazy.computed_blocks(), points.size());
+
+    BOOST_CHECK_EQUAL(lazy(0, 1), matrix(0, 1));
+    BOOST_CHECK_EQUAL(lazy.computed_blocks(), points.size() + 1);
+    BOOST_CHECK_EQUAL(lazy(1, 0), matrix(1, 0));
+    BOOST_CHECK_EQUAL(lazy.computed_blocks(), points.size() + 1);
+}
+
+BOOST_AUTO_TEST_CASE(BudgetBelowOneRow)
+{
+    auto points = make_points(50, 2);
+    metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+    metric::LazyMatrix<Record, metric::Euclidian<float>> lazy(points, metric::Euclidian<float>(), 10);
+
+    for (std::size_t i = 0; i < points.size(); i++) {
+        for (std::size_t j = 0; j < points.size(); j++) {
+            BOOST_CHECK_EQUAL(lazy(i, j), matrix(i, j));
+        }
+    }
+    BOOST_CHECK_EQUAL(lazy.computed_blocks(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentAccess)
+{
+    auto points = make_points(400, 3);
+    metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+    metric::LazyMatrix<Record, metric::Euclidian<float>> lazy(points, metric::Euclidian<float>(), 400 * 4 * 64, 2);
+
+    std::vector<std::size_t> mismatches(4, 0);
+    std::vector<std::thread> readers;
+    for (std::size_t t = 0; t < mismatches.size(); t++) {
+        readers.emplace_back([&, t]() {
+            for (std::size_t i = t; i < points.size(); i += 3) {
+                for (std::size_t j = 0; j < points.size(); j++) {
+                    mismatches[t] += lazy(j, i) != matrix(j, i);
+                }
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (auto count : mismatches) {
+        BOOST_CHECK_EQUAL(count, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Clustering)
+{
+    auto points = make_points(200, 4);
+    metric::Matrix<Record, metric::Euclidian<float>> matrix(points);
+    metric::LazyMatrix<Record, metric::Euclidian<float>> lazy(points, metric::Euclidian<float>(), 200 * 4 * 16);
+
+    auto [assignments, seeds, counts] = metric::dbscan(matrix, 0.5f, 5);
+    auto [lazy_assignments, lazy_seeds, lazy_counts] = metric::dbscan(lazy, 0.5f, 5);
+    BOOST_CHECK(assignments == lazy_assignments);
+    BOOST_CHECK(seeds == lazy_seeds);
+    BOOST_CHECK(counts == lazy_counts);
+
+    auto medoids = metric::kmedoids(matrix, 5);
+    auto lazy_medoids = metric::kmedoids(lazy, 5);
+    BOOST_CHECK(std::get<0>(medoids) == std::get<0>(lazy_medoids));
+    BOOST_CHECK(std::get<1>(medoids) == std::get<1>(lazy_medoids));
+}
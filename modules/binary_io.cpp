@@ -0,0 +1,210 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_BINARY_IO_CPP
+#define _NEWS_CLUSTERING_BINARY_IO_CPP
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#if !defined(_WIN64)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#include "binary_io.hpp"
+
+
+namespace news_clustering {
+
+	BinaryWriter::BinaryWriter(std::string& bytes) : bytes_(bytes)
+	{
+	}
+
+
+	template <typename T>
+	void BinaryWriter::write(const T& value)
+	{
+		bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+
+	template <typename T>
+	void BinaryWriter::write_array(const T* values, std::size_t size)
+	{
+		write((std::uint32_t) size);
+		bytes_.append(reinterpret_cast<const char*>(values), size * sizeof(T));
+	}
+
+
+	void BinaryWriter::write_string(std::string_view value)
+	{
+		write_array(value.data(), value.size());
+	}
+
+	//
+
+	BinaryReader::BinaryReader(const char* data, std::size_t size) : data_(data), size_(size)
+	{
+	}
+
+
+	template <typename T>
+	bool BinaryReader::read(T& value)
+	{
+		if (left() < sizeof(T))
+		{
+			return false;
+		}
+		std::memcpy(&value, data_ + position_, sizeof(T));
+		position_ += sizeof(T);
+
+		return true;
+	}
+
+
+	template <typename T>
+	bool BinaryReader::read_array(std::vector<T>& values)
+	{
+		std::uint32_t size;
+		if (!read(size) || left() / sizeof(T) < size)
+		{
+			return false;
+		}
+		values.resize(size);
+		if (size > 0)
+		{
+			std::memcpy(values.data(), data_ + position_, size * sizeof(T));
+		}
+		position_ += size * sizeof(T);
+
+		return true;
+	}
+
+
+	bool BinaryReader::read_string(std::string& value)
+	{
+		std::uint32_t size;
+		if (!read(size) || left() < size)
+		{
+			return false;
+		}
+		value.assign(data_ + position_, size);
+		position_ += size;
+
+		return true;
+	}
+
+
+	bool BinaryReader::skip(std::size_t size)
+	{
+		if (left() < size)
+		{
+			return false;
+		}
+		position_ += size;
+
+		return true;
+	}
+
+
+	std::size_t BinaryReader::position() const
+	{
+		return position_;
+	}
+
+
+	std::size_t BinaryReader::left() const
+	{
+		return size_ - position_;
+	}
+
+	//
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+
+	bool MappedFile::open(const std::string& path, bool sequential)
+	{
+		close();
+
+		#if defined(_WIN64)
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			file_bytes_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			if (!file_bytes_.empty())
+			{
+				data_ = file_bytes_.data();
+				size_ = file_bytes_.size();
+			}
+		#else
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				return false;
+			}
+			struct stat file_stat;
+			if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+			{
+				void* mapped = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapped != MAP_FAILED)
+				{
+					if (sequential)
+					{
+						madvise(mapped, file_stat.st_size, MADV_SEQUENTIAL);
+					}
+					data_ = static_cast<const char*>(mapped);
+					size_ = file_stat.st_size;
+				}
+			}
+			::close(fd);
+		#endif
+
+		return data_ != nullptr;
+	}
+
+
+	void MappedFile::close()
+	{
+		#if !defined(_WIN64)
+			if (data_ != nullptr)
+			{
+				munmap(const_cast<char*>(data_), size_);
+			}
+		#endif
+		file_bytes_.clear();
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+
+	bool MappedFile::is_open() const
+	{
+		return data_ != nullptr;
+	}
+
+
+	const char* MappedFile::data() const
+	{
+		return data_;
+	}
+
+
+	std::size_t MappedFile::size() const
+	{
+		return size_;
+	}
+
+}  // namespace news_clustering
+#endif
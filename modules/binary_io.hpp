@@ -0,0 +1,140 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_BINARY_IO_HPP
+#define _NEWS_CLUSTERING_BINARY_IO_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace news_clustering {
+
+	/**
+	 * @class BinaryWriter
+	 *
+	 * @brief Appends numbers and arrays to the bytes as they are in memory, arrays and strings are prefixed by 32 bit size
+	 */
+	class BinaryWriter {
+
+	public:
+
+		explicit BinaryWriter(std::string& bytes);
+
+		template <typename T>
+		void write(const T& value);
+
+		template <typename T>
+		void write_array(const T* values, std::size_t size);
+
+		void write_string(std::string_view value);
+
+	private:
+
+		std::string& bytes_;
+	};
+
+	/**
+	 * @class BinaryReader
+	 *
+	 * @brief Reads values written by the BinaryWriter one by one, fails instead of reading past the end
+	 */
+	class BinaryReader {
+
+	public:
+
+		BinaryReader(const char* data, std::size_t size);
+
+		/**
+		 * @brief
+		 * @return false if there are not enough bytes
+		 */
+		template <typename T>
+		bool read(T& value);
+
+		/**
+		 * @brief
+		 * @return false if there are not enough bytes
+		 */
+		template <typename T>
+		bool read_array(std::vector<T>& values);
+
+		/**
+		 * @brief
+		 * @return false if there are not enough bytes
+		 */
+		bool read_string(std::string& value);
+
+		/**
+		 * @brief
+		 * @return false if there are not enough bytes
+		 */
+		bool skip(std::size_t size);
+
+		/**
+		 * @brief
+		 * @return number of bytes already read
+		 */
+		std::size_t position() const;
+
+		/**
+		 * @brief
+		 * @return number of bytes left
+		 */
+		std::size_t left() const;
+
+	private:
+
+		const char* data_;
+		std::size_t size_;
+		std::size_t position_ = 0;
+	};
+
+	/**
+	 * @class MappedFile
+	 *
+	 * @brief Read only file in memory: mapped on posix systems, read at once on windows
+	 */
+	class MappedFile {
+
+	public:
+
+		MappedFile() = default;
+
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/**
+		 * @brief
+		 * @param sequential file will be read from the beginning to the end once
+		 * @return false if the file can't be opened or is empty
+		 */
+		bool open(const std::string& path, bool sequential = false);
+
+		void close();
+
+		bool is_open() const;
+
+		const char* data() const;
+
+		std::size_t size() const;
+
+	private:
+
+		const char* data_ = nullptr;
+		std::size_t size_ = 0;
+		std::vector<char> file_bytes_;
+	};
+
+}  // namespace news_clustering
+
+#include "binary_io.cpp"
+
+#endif  // Header Guard
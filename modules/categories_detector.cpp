@@ -40,15 +40,14 @@ namespace news_clustering {
 	}
 
 	
-	std::unordered_map<int, std::vector<std::string>> CategoriesDetector::detect_categories(
-		std::unordered_map<std::string, news_clustering::Language>& file_names, 
-		std::unordered_map<std::string, std::vector<std::string>>& contents, 
+	std::unordered_map<int, DocIds> CategoriesDetector::detect_categories(
+		Corpus& corpus, 
+		const DocIds& docs, 
 		std::unordered_map<news_clustering::Language, std::vector<float>> category_detect_levels
 	)
 	{
-		std::unordered_map<int, std::vector<std::string>> result;
+		std::unordered_map<int, DocIds> result;
 		
-		std::vector<std::string> content;
 		std::vector<double> text_distances;
 		std::vector<int> text_embedding;
 		std::vector<int> category_embedding;
@@ -70,12 +69,11 @@ namespace news_clustering {
 			}
 		}
 		
-		for (auto i = file_names.begin(); i != file_names.end(); i++) 
+		for (auto doc : docs) 
 		{			
-			content = contents[i->first];
-			language = file_names[i->first];
-			// content embedding
-			text_embedding = text_embedders_[language](content, locales_[language]);
+			language = corpus.languages[doc];
+			// content embedding, it is kept in the corpus for the clustering
+			text_embedding = text_embedders_[language].embed(corpus, doc, locales_[language]);
 			
 			text_distances.clear();
 			//text_distances = text_embedders_[i->second].texts_distance(content, categories_[i->second], locales_[i->second]);
@@ -92,14 +90,16 @@ namespace news_clustering {
 			{
 				if (text_distances[index] > category_detect_levels[language][index])
 				{
-					result[index].push_back(i->first);
+					result[index].push_back(doc);
+					corpus.categories[doc] = index;
 					category_found = true;
 					break;
 				}
 			}
 			if (!category_found)
 			{
-				result[-1].push_back(i->first);
+				result[OTHER_CATEGORY].push_back(doc);
+				corpus.categories[doc] = OTHER_CATEGORY;
 			}
 		}
 
@@ -11,6 +11,7 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #include "languages.hpp"
 #include "content_parser.hpp"
 #include "modules/text_embedding.hpp"
+#include "corpus.hpp"
 
 namespace news_clustering {
 
@@ -32,12 +33,12 @@ namespace news_clustering {
 		);
 
 		/**
-		 * @brief 
+		 * @brief found categories are stored to the corpus too, OTHER_CATEGORY if nothing is close enough
 		 * @return 
 		 */
-		std::unordered_map<int, std::vector<std::string>> detect_categories(
-			std::unordered_map<std::string, news_clustering::Language>& file_names, 
-			std::unordered_map<std::string, std::vector<std::string>>& contents, 
+		std::unordered_map<int, DocIds> detect_categories(
+			Corpus& corpus, 
+			const DocIds& docs, 
 			std::unordered_map<news_clustering::Language, std::vector<float>> category_detect_levels
 		);
 
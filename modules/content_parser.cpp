@@ -62,6 +62,62 @@ namespace news_clustering {
 		return result;
 	}
 	
+	std::vector<std::string> ContentParser::parse_content(const std::string& content, char delimeter, int min_word_size)
+	{
+		std::vector<std::string> words, result;
+	
+		std::string line;
+		std::size_t line_start = 0;
+		std::size_t line_end;
+
+		while (line_start < content.size())
+		{
+			line_end = content.find('\n', line_start);
+			if (line_end == std::string::npos)
+			{
+				line_end = content.size();
+			}
+			line.assign(content, line_start, line_end - line_start);
+			words = split_string(line, delimeter, min_word_size);
+			result.insert(result.end(), words.begin(), words.end());
+
+			line_start = line_end + 1;
+		}
+
+		return result;
+	}
+	
+	std::string ContentParser::read_file(const std::string& filename)
+	{
+		std::string content;
+
+		std::ifstream fin(filename, std::ios::in | std::ios::binary);
+		
+		if (!fin.is_open())
+		{
+			std::cerr << "Cannot open file: " << filename << std::endl;
+		}
+		else
+		{
+			fin.seekg(0, std::ios::end);
+			auto size = fin.tellg();
+			if (size < 0)
+			{
+				std::cerr << "Cannot read file: " << filename << std::endl;
+				return content;
+			}
+			content.resize(size);
+			fin.seekg(0, std::ios::beg);
+			if (!fin.read(&content[0], content.size()))
+			{
+				std::cerr << "Cannot read file: " << filename << std::endl;
+				content.clear();
+			}
+		}
+
+		return content;
+	}
+	
 	std::vector<std::vector<std::string>> ContentParser::parse_categories(const std::string& filename, const std::locale& locale, char delimeter)
 	{
 		std::vector<std::string> words;
@@ -239,8 +295,13 @@ namespace news_clustering {
 					{  // the only method if d_type isn't available,
 						// otherwise this is a fallback for FSes where the kernel leaves it DT_UNKNOWN.
 						struct stat stbuf;
-						// stat follows symlinks, lstat doesn't.
-						stat(dirp->d_name, &stbuf);              // TODO: error check
+						// stat follows symlinks, lstat doesn't. d_name is relative to the listed directory, not to cwd
+						std::string entry_path = dirname + "/" + std::string(dirp->d_name);
+						if (stat(entry_path.c_str(), &stbuf) != 0)
+						{
+							// broken symlink or entry removed while listing
+							continue;
+						}
 						is_dir = S_ISDIR(stbuf.st_mode);
 					}
 
@@ -29,6 +29,18 @@ namespace news_clustering {
 		 */
 		std::vector<std::string> parse(const std::string& filename, const std::locale& locale, char delimeter = ' ', int min_word_size = 1);
 
+		/**
+		 * @brief split already loaded file bytes to words, same as parse() does
+		 * @return 
+		 */
+		std::vector<std::string> parse_content(const std::string& content, char delimeter = ' ', int min_word_size = 1);
+
+		/**
+		 * @brief read whole file into memory at once
+		 * @return 
+		 */
+		std::string read_file(const std::string& filename);
+
 		/**
 		 * @brief 
 		 * @return 
@@ -0,0 +1,307 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_CORPUS_CPP
+#define _NEWS_CLUSTERING_CORPUS_CPP
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include "corpus.hpp"
+
+
+namespace news_clustering {
+
+	template <typename T>
+	Arena<T>::Arena(std::size_t block_size) : block_size_(block_size)
+	{
+	}
+
+
+	template <typename T>
+	T* Arena<T>::allocate(std::size_t size)
+	{
+		if (blocks_.empty() || block_used_ + size > block_capacity_)
+		{
+			// big requests get their own block
+			block_capacity_ = std::max(block_size_, size);
+			blocks_.emplace_back(new T[block_capacity_]);
+			block_used_ = 0;
+			bytes_ += block_capacity_ * sizeof(T);
+		}
+
+		T* result = blocks_.back().get() + block_used_;
+		block_used_ += size;
+
+		return result;
+	}
+
+
+	template <typename T>
+	T* Arena<T>::copy(const T* values, std::size_t size)
+	{
+		T* result = allocate(size);
+		std::copy(values, values + size, result);
+
+		return result;
+	}
+
+
+	template <typename T>
+	void Arena<T>::clear()
+	{
+		blocks_.clear();
+		block_used_ = 0;
+		block_capacity_ = 0;
+		bytes_ = 0;
+	}
+
+
+	template <typename T>
+	std::size_t Arena<T>::bytes() const
+	{
+		return bytes_;
+	}
+
+	//
+
+	DocId Corpus::add(const std::string& path)
+	{
+		DocId doc = paths_.size();
+
+		paths_.push_back(path);
+		raws_.emplace_back();
+		tokens_.emplace_back();
+		tokens_loaded_.push_back(false);
+		titles_.emplace_back();
+		entities_.emplace_back();
+		embeddings_.emplace_back();
+		has_embeddings_.push_back(false);
+
+		languages.emplace_back();
+		categories.push_back(UNDEFINED_CATEGORY);
+		threads.push_back(NO_THREAD);
+		sources.push_back(NO_SOURCE);
+
+		return doc;
+	}
+
+
+	DocIds Corpus::ids() const
+	{
+		DocIds result(size());
+		std::iota(result.begin(), result.end(), 0);
+
+		return result;
+	}
+
+
+	std::size_t Corpus::size() const
+	{
+		return paths_.size();
+	}
+
+
+	const std::string& Corpus::path(DocId doc) const
+	{
+		return paths_[doc];
+	}
+
+
+	std::string Corpus::file_name(DocId doc) const
+	{
+		return paths_[doc].substr(paths_[doc].find_last_of("/\\") + 1);
+	}
+
+
+	void Corpus::set_raw(DocId doc, std::string&& raw)
+	{
+		raws_[doc] = std::move(raw);
+	}
+
+
+	const std::string& Corpus::raw(DocId doc) const
+	{
+		return raws_[doc];
+	}
+
+
+	void Corpus::release_raw(DocId doc)
+	{
+		std::string().swap(raws_[doc]);
+	}
+
+
+	void Corpus::set_tokens(DocId doc, const std::vector<std::string>& tokens)
+	{
+		std::size_t num_chars = 0;
+		for (const auto& token : tokens)
+		{
+			num_chars += token.size();
+		}
+
+		std::lock_guard<std::mutex> lock(arena_mutex_);
+
+		char* chars = token_chars_arena_.allocate(num_chars);
+		std::string_view* views = tokens_arena_.allocate(tokens.size());
+		for (std::size_t i = 0; i < tokens.size(); i++)
+		{
+			std::memcpy(chars, tokens[i].data(), tokens[i].size());
+			views[i] = std::string_view(chars, tokens[i].size());
+			chars += tokens[i].size();
+		}
+
+		tokens_[doc] = TokensView(views, tokens.size());
+		tokens_loaded_[doc] = true;
+	}
+
+
+	TokensView Corpus::tokens(DocId doc)
+	{
+		if (!tokens_loaded_[doc] && tokens_loader_)
+		{
+			set_tokens(doc, tokens_loader_(doc));
+		}
+		return tokens_[doc];
+	}
+
+
+	bool Corpus::has_tokens(DocId doc) const
+	{
+		return tokens_loaded_[doc];
+	}
+
+
+	void Corpus::release_tokens()
+	{
+		for (DocId doc = 0; doc < size(); doc++)
+		{
+			tokens_[doc] = TokensView();
+			tokens_loaded_[doc] = false;
+		}
+		token_chars_arena_.clear();
+		tokens_arena_.clear();
+	}
+
+
+	void Corpus::set_tokens_loader(TokensLoader loader)
+	{
+		tokens_loader_ = loader;
+	}
+
+
+	std::size_t Corpus::tokens_bytes() const
+	{
+		return token_chars_arena_.bytes() + tokens_arena_.bytes();
+	}
+
+
+	void Corpus::set_title(DocId doc, const std::string& title)
+	{
+		std::lock_guard<std::mutex> lock(arena_mutex_);
+		titles_[doc] = std::string_view(chars_arena_.copy(title.data(), title.size()), title.size());
+	}
+
+
+	std::string_view Corpus::title(DocId doc) const
+	{
+		return titles_[doc];
+	}
+
+
+	void Corpus::set_entities(DocId doc, const std::vector<EntityId>& entities)
+	{
+		std::lock_guard<std::mutex> lock(arena_mutex_);
+		entities_[doc] = Span<EntityId>(entities_arena_.copy(entities.data(), entities.size()), entities.size());
+	}
+
+
+	Span<EntityId> Corpus::entities(DocId doc) const
+	{
+		return entities_[doc];
+	}
+
+
+	void Corpus::set_source(DocId doc, const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(arena_mutex_);
+
+		auto found = source_ids_.find(name);
+		if (found == source_ids_.end())
+		{
+			found = source_ids_.insert({ name, (std::int32_t) source_names_.size() }).first;
+			source_names_.push_back(name);
+		}
+		sources[doc] = found->second;
+	}
+
+
+	const std::string& Corpus::source_name(std::int32_t source) const
+	{
+		return source_names_[source];
+	}
+
+
+	void Corpus::set_embedding(DocId doc, const std::vector<int>& embedding)
+	{
+		std::size_t num_values = 0;
+		for (auto value : embedding)
+		{
+			num_values += value != 0;
+		}
+
+		std::lock_guard<std::mutex> lock(arena_mutex_);
+
+		EmbeddingValue* values = embeddings_arena_.allocate(num_values);
+		std::size_t k = 0;
+		for (std::size_t i = 0; i < embedding.size(); i++)
+		{
+			if (embedding[i] != 0)
+			{
+				values[k++] = { (std::uint32_t) i, embedding[i] };
+			}
+		}
+
+		embeddings_[doc] = Span<EmbeddingValue>(values, num_values);
+		has_embeddings_[doc] = true;
+	}
+
+
+	void Corpus::set_embedding_values(DocId doc, const std::vector<EmbeddingValue>& values)
+	{
+		std::lock_guard<std::mutex> lock(arena_mutex_);
+
+		embeddings_[doc] = Span<EmbeddingValue>(embeddings_arena_.copy(values.data(), values.size()), values.size());
+		has_embeddings_[doc] = true;
+	}
+
+
+	bool Corpus::has_embedding(DocId doc) const
+	{
+		return has_embeddings_[doc];
+	}
+
+
+	Span<Corpus::EmbeddingValue> Corpus::embedding_values(DocId doc) const
+	{
+		return embeddings_[doc];
+	}
+
+
+	std::vector<int> Corpus::embedding(DocId doc, std::size_t dimensions) const
+	{
+		std::vector<int> result(dimensions, 0);
+		for (const auto& value : embeddings_[doc])
+		{
+			result[value.index] = value.count;
+		}
+
+		return result;
+	}
+
+}  // namespace news_clustering
+#endif
@@ -0,0 +1,340 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_CORPUS_HPP
+#define _NEWS_CLUSTERING_CORPUS_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "languages.hpp"
+#include "dates_store.hpp"
+
+namespace news_clustering {
+
+	using DocId = std::uint32_t;
+	using DocIds = std::vector<DocId>;
+	using EntityId = std::int32_t;
+
+	const int OTHER_CATEGORY = -1;
+	const int UNDEFINED_CATEGORY = -2;
+	const std::int32_t NO_THREAD = -1;
+	const std::int32_t NO_SOURCE = -1;
+
+	/**
+	 * @class Arena
+	 *
+	 * @brief Append only storage: values are allocated in big blocks and never move, so pointers to them stay valid
+	 */
+	template <typename T>
+	class Arena {
+
+	public:
+
+		explicit Arena(std::size_t block_size = 1 << 16);
+
+		/**
+		 * @brief allocate contiguous space for size values
+		 * @return
+		 */
+		T* allocate(std::size_t size);
+
+		/**
+		 * @brief allocate and copy values
+		 * @return
+		 */
+		T* copy(const T* values, std::size_t size);
+
+		/**
+		 * @brief free all blocks, all pointers become invalid
+		 * @return
+		 */
+		void clear();
+
+		/**
+		 * @brief
+		 * @return number of allocated bytes
+		 */
+		std::size_t bytes() const;
+
+	private:
+
+		std::size_t block_size_;
+		std::size_t block_used_ = 0;
+		std::size_t block_capacity_ = 0;
+		std::size_t bytes_ = 0;
+		std::vector<std::unique_ptr<T[]>> blocks_;
+	};
+
+	/**
+	 * @class Span
+	 *
+	 * @brief View of the contiguous values owned by someone else
+	 */
+	template <typename T>
+	class Span {
+
+	public:
+
+		Span() = default;
+
+		Span(const T* data, std::size_t size) : data_(data), size_(size)
+		{
+		};
+
+		const T* begin() const { return data_; };
+		const T* end() const { return data_ + size_; };
+		const T& operator[](std::size_t i) const { return data_[i]; };
+		std::size_t size() const { return size_; };
+		bool empty() const { return size_ == 0; };
+
+	private:
+
+		const T* data_ = nullptr;
+		std::size_t size_ = 0;
+	};
+
+	using TokensView = Span<std::string_view>;
+
+	/**
+	 * @class Corpus
+	 *
+	 * @brief All the documents of the run: each document has dense id and its data is stored in the columns indexed by id.
+	 * Variable size data (tokens, titles, entities, embeddings) is kept in arenas, columns keep only views.
+	 */
+	class Corpus {
+
+	public:
+
+		struct EmbeddingValue
+		{
+			std::uint32_t index;
+			std::int32_t count;
+		};
+
+		using TokensLoader = std::function<std::vector<std::string>(DocId)>;
+
+		Corpus() = default;
+
+		/**
+		 * @brief register document, columns are grown here, so it shouldn't be called concurrently with setters
+		 * @return id of the document
+		 */
+		DocId add(const std::string& path);
+
+		/**
+		 * @brief
+		 * @return ids of all the documents
+		 */
+		DocIds ids() const;
+
+		/**
+		 * @brief
+		 * @return number of documents
+		 */
+		std::size_t size() const;
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		const std::string& path(DocId doc) const;
+
+		/**
+		 * @brief
+		 * @return name of the file without directories
+		 */
+		std::string file_name(DocId doc) const;
+
+		// setters below can be called for different documents from different threads
+
+		/**
+		 * @brief keep raw bytes of the file, f.e. for searching html tags
+		 * @return
+		 */
+		void set_raw(DocId doc, std::string&& raw);
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		const std::string& raw(DocId doc) const;
+
+		/**
+		 * @brief free raw bytes when they are not needed anymore
+		 * @return
+		 */
+		void release_raw(DocId doc);
+
+		/**
+		 * @brief copy words of the document to the arena
+		 * @return
+		 */
+		void set_tokens(DocId doc, const std::vector<std::string>& tokens);
+
+		/**
+		 * @brief tokens that aren't in memory (released or never set) are loaded with the tokens loader if it is set
+		 * @return empty if tokens aren't in memory and there is no loader
+		 */
+		TokensView tokens(DocId doc);
+
+		/**
+		 * @brief
+		 * @return true if tokens of the document are in memory
+		 */
+		bool has_tokens(DocId doc) const;
+
+		/**
+		 * @brief free tokens of all the documents, shouldn't be called concurrently with other methods
+		 * @return
+		 */
+		void release_tokens();
+
+		/**
+		 * @brief how to get tokens of the document that aren't in memory, f.e. read and parse its file again
+		 * @return
+		 */
+		void set_tokens_loader(TokensLoader loader);
+
+		/**
+		 * @brief
+		 * @return number of bytes allocated for tokens
+		 */
+		std::size_t tokens_bytes() const;
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void set_title(DocId doc, const std::string& title);
+
+		/**
+		 * @brief
+		 * @return empty if title wasn't found
+		 */
+		std::string_view title(DocId doc) const;
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void set_entities(DocId doc, const std::vector<EntityId>& entities);
+
+		/**
+		 * @brief
+		 * @return ids of the name entities in order of appearance
+		 */
+		Span<EntityId> entities(DocId doc) const;
+
+		/**
+		 * @brief source names are kept once, documents refer them by id
+		 * @return 
+		 */
+		void set_source(DocId doc, const std::string& name);
+
+		/**
+		 * @brief 
+		 * @return name of the source, f.e. site name
+		 */
+		const std::string& source_name(std::int32_t source) const;
+
+		/**
+		 * @brief store only non zero values of the histogram embedding
+		 * @return
+		 */
+		void set_embedding(DocId doc, const std::vector<int>& embedding);
+
+		/**
+		 * @brief store already sparse embedding, f.e. read from the shard file
+		 * @return
+		 */
+		void set_embedding_values(DocId doc, const std::vector<EmbeddingValue>& values);
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		bool has_embedding(DocId doc) const;
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		Span<EmbeddingValue> embedding_values(DocId doc) const;
+
+		/**
+		 * @brief
+		 * @return dense histogram of the dimensions size
+		 */
+		std::vector<int> embedding(DocId doc, std::size_t dimensions) const;
+
+
+		std::vector<Language> languages;
+		std::vector<int> categories;
+		std::vector<std::int32_t> threads;
+		std::vector<std::int32_t> sources;
+		DatesStore dates;
+
+	private:
+
+		std::vector<std::string> paths_;
+		std::vector<std::string> raws_;
+		std::vector<TokensView> tokens_;
+		std::vector<char> tokens_loaded_;
+		TokensLoader tokens_loader_;
+		std::vector<std::string_view> titles_;
+		std::vector<Span<EntityId>> entities_;
+		std::vector<Span<EmbeddingValue>> embeddings_;
+		std::vector<char> has_embeddings_;
+		std::vector<std::string> source_names_;
+		std::unordered_map<std::string, std::int32_t> source_ids_;
+
+		std::mutex arena_mutex_;
+		Arena<char> chars_arena_;
+		// tokens have their own arenas, so they can be released without titles
+		Arena<char> token_chars_arena_;
+		Arena<std::string_view> tokens_arena_;
+		Arena<EntityId> entities_arena_;
+		Arena<EmbeddingValue> embeddings_arena_;
+	};
+
+	/**
+	 * @class Threads
+	 *
+	 * @brief Found threads: articles of the k-th thread are articles[offsets[k]] ... articles[offsets[k + 1] - 1],
+	 * the most relevant goes first. Seed gives the title of the thread.
+	 */
+	struct Threads
+	{
+		std::vector<DocId> seeds;
+		std::vector<std::size_t> offsets = { 0 };
+		std::vector<DocId> articles;
+
+		/**
+		 * @brief
+		 * @return number of threads
+		 */
+		std::size_t size() const { return seeds.size(); };
+
+		/**
+		 * @brief
+		 * @return articles of the k-th thread
+		 */
+		Span<DocId> thread(std::size_t k) const { return Span<DocId>(articles.data() + offsets[k], offsets[k + 1] - offsets[k]); };
+	};
+
+}  // namespace news_clustering
+
+#include "corpus.cpp"
+
+#endif  // Header Guard
@@ -0,0 +1,121 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_DATES_STORE_CPP
+#define _NEWS_CLUSTERING_DATES_STORE_CPP
+
+#include "dates_store.hpp"
+
+
+namespace news_clustering {
+
+	std::int32_t to_epoch_days(int day, int month, int year)
+	{
+		// civil calendar to days, see http://howardhinnant.github.io/date_algorithms.html
+		year -= month <= 2;
+		const int era = (year >= 0 ? year : year - 399) / 400;
+		const int year_of_era = year - era * 400;
+		const int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+		const int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+		return era * 146097 + day_of_era - 719468;
+	}
+
+
+	void dates_distances(const std::int32_t* days, std::size_t size, std::int32_t today, std::int32_t* distances)
+	{
+		// branchless body, so compiler can vectorize it
+		for (std::size_t i = 0; i < size; i++)
+		{
+			std::int32_t diff = today - days[i];
+			std::int32_t mask = diff >> 31;
+			distances[i] = (diff ^ mask) - mask;
+		}
+	}
+
+	//
+
+	void DatesStore::append(std::size_t article, const std::vector<std::int32_t>& days)
+	{
+		if (article >= rows_.size())
+		{
+			rows_.resize(article + 1, -1);
+		}
+		rows_[article] = offsets_.size() - 1;
+		days_.insert(days_.end(), days.begin(), days.end());
+		offsets_.push_back(days_.size());
+		freshness_computed_ = false;
+	}
+
+
+	std::size_t DatesStore::num_dates(std::size_t article) const
+	{
+		if (article >= rows_.size() || rows_[article] < 0)
+		{
+			return 0;
+		}
+		return offsets_[rows_[article] + 1] - offsets_[rows_[article]];
+	}
+
+
+	std::vector<std::int32_t> DatesStore::days(std::size_t article) const
+	{
+		if (article >= rows_.size() || rows_[article] < 0)
+		{
+			return {};
+		}
+		return std::vector<std::int32_t>(days_.begin() + offsets_[rows_[article]], days_.begin() + offsets_[rows_[article] + 1]);
+	}
+
+
+	void DatesStore::compute_freshness(std::int32_t today)
+	{
+		if (freshness_computed_ && freshness_today_ == today)
+		{
+			return;
+		}
+
+		std::vector<std::int32_t> distances(days_.size());
+		dates_distances(days_.data(), days_.size(), today, distances.data());
+
+		mean_distances_.assign(size(), -1);
+		for (std::size_t i = 0; i < size(); i++)
+		{
+			if (offsets_[i + 1] > offsets_[i])
+			{
+				std::int64_t sum = 0;
+				for (auto k = offsets_[i]; k < offsets_[i + 1]; k++)
+				{
+					sum += distances[k];
+				}
+				mean_distances_[i] = (float) sum / (offsets_[i + 1] - offsets_[i]);
+			}
+		}
+
+		freshness_today_ = today;
+		freshness_computed_ = true;
+	}
+
+
+	float DatesStore::freshness(std::size_t article, std::int32_t today)
+	{
+		compute_freshness(today);
+
+		if (article >= rows_.size() || rows_[article] < 0)
+		{
+			return -1;
+		}
+		return mean_distances_[rows_[article]];
+	}
+
+
+	std::size_t DatesStore::size() const
+	{
+		return offsets_.size() - 1;
+	}
+
+}  // namespace news_clustering
+#endif
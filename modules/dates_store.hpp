@@ -0,0 +1,93 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_DATES_STORE_HPP
+#define _NEWS_CLUSTERING_DATES_STORE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace news_clustering {
+
+	/**
+	 * @brief days since 01.01.1970 for the dd.mm.yyyy date
+	 * @return
+	 */
+	std::int32_t to_epoch_days(int day, int month, int year);
+
+	/**
+	 * @brief distances in days from the each date to the today, computed in one pass over contiguous array
+	 * @return
+	 */
+	void dates_distances(const std::int32_t* days, std::size_t size, std::int32_t today, std::int32_t* distances);
+
+	/**
+	 * @class DatesStore
+	 *
+	 * @brief Columnar store for the found dates: all dates are kept as epoch days in one array with per article offsets.
+	 * Articles are addressed by the document ids of the corpus.
+	 */
+	class DatesStore {
+
+	public:
+
+		DatesStore() = default;
+
+		/**
+		 * @brief add dates (as epoch days) found in the article
+		 * @return
+		 */
+		void append(std::size_t article, const std::vector<std::int32_t>& days);
+
+		/**
+		 * @brief number of dates found in the article
+		 * @return
+		 */
+		std::size_t num_dates(std::size_t article) const;
+
+		/**
+		 * @brief
+		 * @return dates of the article as epoch days
+		 */
+		std::vector<std::int32_t> days(std::size_t article) const;
+
+		/**
+		 * @brief compute mean distance to the today for all articles at once, result is cached until today changes
+		 * @return
+		 */
+		void compute_freshness(std::int32_t today);
+
+		/**
+		 * @brief mean distance in days from the article dates to the today, -1 if article has no dates
+		 * @return
+		 */
+		float freshness(std::size_t article, std::int32_t today);
+
+		/**
+		 * @brief
+		 * @return number of stored articles
+		 */
+		std::size_t size() const;
+
+	private:
+
+		// row of the article in offsets, -1 if article wasn't appended
+		std::vector<std::int64_t> rows_;
+		std::vector<std::size_t> offsets_ = { 0 };
+		std::vector<std::int32_t> days_;
+
+		std::int32_t freshness_today_ = 0;
+		bool freshness_computed_ = false;
+		std::vector<float> mean_distances_;
+	};
+
+}  // namespace news_clustering
+
+#include "dates_store.cpp"
+
+#endif  // Header Guard
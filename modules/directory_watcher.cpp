@@ -0,0 +1,288 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_DIRECTORY_WATCHER_CPP
+#define _NEWS_CLUSTERING_DIRECTORY_WATCHER_CPP
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#if defined(__linux__)
+	#include <cerrno>
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+#include "directory_watcher.hpp"
+
+
+namespace news_clustering {
+
+	namespace {
+
+		bool is_html_file(const std::string& path)
+		{
+			return path.size() > 5 && path.compare(path.size() - 5, 5, ".html") == 0;
+		}
+
+	}  // namespace
+
+
+	DirectoryWatcher::DirectoryWatcher(const std::string& path) : path_(path)
+	{
+		#if defined(__linux__)
+			fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (fd_ < 0)
+			{
+				std::cerr << "Cannot watch directory: " << path_ << ", it will be listed again instead" << std::endl;
+			}
+		#endif
+
+		if (fd_ >= 0)
+		{
+			add_directory(path_);
+		}
+		else
+		{
+			list_files();
+		}
+	}
+
+
+	DirectoryWatcher::~DirectoryWatcher()
+	{
+		#if defined(__linux__)
+			if (fd_ >= 0)
+			{
+				::close(fd_);
+			}
+		#endif
+	}
+
+
+	const std::vector<std::string>& DirectoryWatcher::files() const
+	{
+		return files_;
+	}
+
+
+	bool DirectoryWatcher::wait(std::chrono::milliseconds timeout)
+	{
+		if (fd_ < 0)
+		{
+			std::this_thread::sleep_for(timeout);
+			return list_files();
+		}
+
+		bool changed = false;
+
+		#if defined(__linux__)
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			alignas(inotify_event) char buffer[1 << 16];
+
+			while (true)
+			{
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+				if (left <= 0)
+				{
+					break;
+				}
+
+				pollfd poll_fd = { fd_, POLLIN, 0 };
+				if (poll(&poll_fd, 1, (int) left) <= 0)
+				{
+					continue;
+				}
+
+				ssize_t length;
+				while ((length = read(fd_, buffer, sizeof(buffer))) > 0)
+				{
+					for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len)
+					{
+						auto event = reinterpret_cast<inotify_event*>(p);
+
+						if (event->mask & IN_Q_OVERFLOW)
+						{
+							// events were lost, so the tree is walked again: directories created meanwhile get their
+							// watches (adding a watch of the watched directory again keeps its descriptor), then the
+							// listing drops the files that are gone
+							auto num_files = files_.size();
+							add_directory(path_);
+							changed |= files_.size() > num_files;
+							changed |= list_files();
+							continue;
+						}
+						if (event->mask & IN_IGNORED)
+						{
+							directories_.erase(event->wd);
+							continue;
+						}
+
+						auto directory = directories_.find(event->wd);
+						if (directory == directories_.end() || event->len == 0)
+						{
+							continue;
+						}
+						auto path = directory->second + "/" + event->name;
+
+						if (event->mask & IN_ISDIR)
+						{
+							if (event->mask & (IN_CREATE | IN_MOVED_TO))
+							{
+								auto num_files = files_.size();
+								add_directory(path);
+								changed |= files_.size() > num_files;
+							}
+							else if (event->mask & IN_MOVED_FROM)
+							{
+								changed |= remove_directory(path);
+							}
+						}
+						else if (is_html_file(path))
+						{
+							if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+							{
+								// rewritten file is a change too, its content is checked by the pipeline
+								add_file(path);
+								changed = true;
+							}
+							else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+							{
+								changed |= remove_file(path);
+							}
+						}
+					}
+				}
+			}
+		#endif
+
+		return changed;
+	}
+
+
+	void DirectoryWatcher::add_directory(const std::string& path)
+	{
+		#if defined(__linux__)
+			// directory is watched before listing, so files that land meanwhile are not lost
+			int wd = inotify_add_watch(fd_, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE);
+			if (wd < 0)
+			{
+				std::cerr << "Cannot watch directory: " << path << std::endl;
+				return;
+			}
+			directories_[wd] = path;
+		#endif
+
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(path, error))
+		{
+			if (entry.is_directory(error))
+			{
+				add_directory(entry.path().string());
+			}
+			else if (is_html_file(entry.path().string()))
+			{
+				add_file(entry.path().string());
+			}
+		}
+	}
+
+
+	bool DirectoryWatcher::add_file(const std::string& path)
+	{
+		if (!known_files_.insert(path).second)
+		{
+			return false;
+		}
+		files_.push_back(path);
+
+		return true;
+	}
+
+
+	bool DirectoryWatcher::remove_file(const std::string& path)
+	{
+		if (known_files_.erase(path) == 0)
+		{
+			return false;
+		}
+		files_.erase(std::remove(files_.begin(), files_.end(), path), files_.end());
+
+		return true;
+	}
+
+
+	bool DirectoryWatcher::remove_directory(const std::string& path)
+	{
+		auto prefix = path + "/";
+		auto is_inside = [&prefix](const std::string& file) { return file.compare(0, prefix.size(), prefix) == 0; };
+
+		#if defined(__linux__)
+			// moved away directory keeps its watch, so it is removed here
+			for (auto directory = directories_.begin(); directory != directories_.end(); )
+			{
+				if (directory->second == path || is_inside(directory->second))
+				{
+					inotify_rm_watch(fd_, directory->first);
+					directory = directories_.erase(directory);
+				}
+				else
+				{
+					directory++;
+				}
+			}
+		#endif
+
+		auto num_files = files_.size();
+		files_.erase(std::remove_if(files_.begin(), files_.end(), is_inside), files_.end());
+		for (auto file = known_files_.begin(); file != known_files_.end(); )
+		{
+			file = is_inside(*file) ? known_files_.erase(file) : std::next(file);
+		}
+
+		return files_.size() < num_files;
+	}
+
+
+	bool DirectoryWatcher::list_files()
+	{
+		std::unordered_set<std::string> listed_files;
+		std::error_code error;
+		for (auto entry = std::filesystem::recursive_directory_iterator(path_, error); entry != std::filesystem::recursive_directory_iterator(); entry.increment(error))
+		{
+			if (!entry->is_directory(error) && is_html_file(entry->path().string()))
+			{
+				listed_files.insert(entry->path().string());
+			}
+		}
+
+		// files that are still there keep their order, new ones go to the end
+		bool changed = false;
+		for (auto file = files_.begin(); file != files_.end(); )
+		{
+			if (listed_files.find(*file) == listed_files.end())
+			{
+				known_files_.erase(*file);
+				file = files_.erase(file);
+				changed = true;
+			}
+			else
+			{
+				file++;
+			}
+		}
+		for (const auto& file : listed_files)
+		{
+			changed |= add_file(file);
+		}
+
+		return changed;
+	}
+
+}  // namespace news_clustering
+#endif
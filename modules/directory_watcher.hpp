@@ -0,0 +1,73 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_DIRECTORY_WATCHER_HPP
+#define _NEWS_CLUSTERING_DIRECTORY_WATCHER_HPP
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace news_clustering {
+
+	/**
+	 * @class DirectoryWatcher
+	 *
+	 * @brief Keeps the list of html files of the directory and its subdirectories up to date. On linux changes come
+	 * from inotify, so the tree is walked only once; on other systems the directory is listed again after every wait.
+	 */
+	class DirectoryWatcher {
+
+	public:
+
+		explicit DirectoryWatcher(const std::string& path);
+
+		~DirectoryWatcher();
+
+		DirectoryWatcher(const DirectoryWatcher&) = delete;
+		DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+		/**
+		 * @brief
+		 * @return html files in order of appearance
+		 */
+		const std::vector<std::string>& files() const;
+
+		/**
+		 * @brief collect changes for the timeout
+		 * @return true if html files were added, rewritten or removed
+		 */
+		bool wait(std::chrono::milliseconds timeout);
+
+	private:
+
+		std::string path_;
+		std::vector<std::string> files_;
+		std::unordered_set<std::string> known_files_;
+
+		// inotify descriptor and watched directories by watch descriptor
+		int fd_ = -1;
+		std::unordered_map<int, std::string> directories_;
+
+		void add_directory(const std::string& path);
+
+		bool add_file(const std::string& path);
+
+		bool remove_file(const std::string& path);
+
+		bool remove_directory(const std::string& path);
+
+		bool list_files();
+	};
+
+}  // namespace news_clustering
+
+#include "directory_watcher.cpp"
+
+#endif  // Header Guard
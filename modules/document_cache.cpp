@@ -0,0 +1,371 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_DOCUMENT_CACHE_CPP
+#define _NEWS_CLUSTERING_DOCUMENT_CACHE_CPP
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "document_cache.hpp"
+#include "binary_io.hpp"
+
+
+namespace news_clustering {
+
+	namespace {
+
+		const char CACHE_MAGIC[8] = { 'T', 'G', 'N', 'C', 'A', 'C', 'H', 'E' };
+		const std::uint32_t CACHE_VERSION = 1;
+		const std::size_t CACHE_HEADER_SIZE = sizeof(CACHE_MAGIC) + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+		// payload size and key
+		const std::size_t RECORD_HEADER_SIZE = sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+		const std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+		const std::uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+		const std::uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+		const std::uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+		const std::uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+
+		inline std::uint64_t rotl64(std::uint64_t x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+
+		inline std::uint64_t read64(const char* p)
+		{
+			std::uint64_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+
+		inline std::uint32_t read32(const char* p)
+		{
+			std::uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+
+		inline std::uint64_t xxh64_round(std::uint64_t acc, std::uint64_t input)
+		{
+			acc += input * PRIME64_2;
+			acc = rotl64(acc, 31);
+			return acc * PRIME64_1;
+		}
+
+
+		inline std::uint64_t xxh64_merge_round(std::uint64_t acc, std::uint64_t value)
+		{
+			acc ^= xxh64_round(0, value);
+			return acc * PRIME64_1 + PRIME64_4;
+		}
+
+	}  // namespace
+
+
+	std::uint64_t xxh64(const char* data, std::size_t size, std::uint64_t seed)
+	{
+		const char* p = data;
+		const char* end = data + size;
+		std::uint64_t hash;
+
+		if (size >= 32)
+		{
+			std::uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+			std::uint64_t v2 = seed + PRIME64_2;
+			std::uint64_t v3 = seed;
+			std::uint64_t v4 = seed - PRIME64_1;
+
+			// four independent lanes over 32 byte stripes
+			const char* limit = end - 32;
+			do
+			{
+				v1 = xxh64_round(v1, read64(p));
+				v2 = xxh64_round(v2, read64(p + 8));
+				v3 = xxh64_round(v3, read64(p + 16));
+				v4 = xxh64_round(v4, read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+
+			hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+			hash = xxh64_merge_round(hash, v1);
+			hash = xxh64_merge_round(hash, v2);
+			hash = xxh64_merge_round(hash, v3);
+			hash = xxh64_merge_round(hash, v4);
+		}
+		else
+		{
+			hash = seed + PRIME64_5;
+		}
+
+		hash += (std::uint64_t) size;
+
+		for (; p + 8 <= end; p += 8)
+		{
+			hash ^= xxh64_round(0, read64(p));
+			hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+		}
+		if (p + 4 <= end)
+		{
+			hash ^= (std::uint64_t) read32(p) * PRIME64_1;
+			hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+			p += 4;
+		}
+		for (; p < end; p++)
+		{
+			hash ^= (std::uint64_t) (unsigned char) *p * PRIME64_5;
+			hash = rotl64(hash, 11) * PRIME64_1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= PRIME64_2;
+		hash ^= hash >> 29;
+		hash *= PRIME64_3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
+	//
+
+	DocumentCache::DocumentCache(const std::string& path, std::uint64_t fingerprint) : path_(path), fingerprint_(fingerprint)
+	{
+		open();
+	}
+
+
+	DocumentCache::~DocumentCache()
+	{
+		close();
+	}
+
+
+	bool DocumentCache::contains(std::uint64_t key) const
+	{
+		return records_.find(key) != records_.end();
+	}
+
+
+	bool DocumentCache::find(std::uint64_t key, Entry& entry) const
+	{
+		auto found = records_.find(key);
+		if (found == records_.end())
+		{
+			return false;
+		}
+
+		// reading is bounded by the record, damaged record is a miss
+		BinaryReader reader(data_ + found->second.offset + RECORD_HEADER_SIZE, found->second.size - RECORD_HEADER_SIZE);
+		std::int32_t language;
+		std::uint8_t has_embedding;
+		if (!reader.read(language) || !reader.read(entry.category) || !reader.read_string(entry.title) ||
+			!reader.read_string(entry.source) || !reader.read_array(entry.entities) || !reader.read_array(entry.days) ||
+			!reader.read(has_embedding) || !reader.read_array(entry.embedding))
+		{
+			return false;
+		}
+		entry.language = (LanguageId) language;
+		entry.has_embedding = has_embedding != 0;
+
+		return true;
+	}
+
+
+	void DocumentCache::restore(Corpus& corpus, DocId doc, const Entry& entry)
+	{
+		corpus.languages[doc] = Language(entry.language);
+		corpus.categories[doc] = entry.category;
+		if (!entry.source.empty())
+		{
+			corpus.set_source(doc, entry.source);
+		}
+		corpus.set_title(doc, entry.title);
+		corpus.set_entities(doc, entry.entities);
+		corpus.dates.append(doc, entry.days);
+		if (entry.has_embedding)
+		{
+			corpus.set_embedding_values(doc, entry.embedding);
+		}
+	}
+
+
+	void DocumentCache::put(std::uint64_t key, Corpus& corpus, DocId doc)
+	{
+		std::string payload;
+		BinaryWriter payload_writer(payload);
+		auto entities = corpus.entities(doc);
+		auto embedding = corpus.embedding_values(doc);
+		auto days = corpus.dates.days(doc);
+
+		payload_writer.write((std::int32_t) corpus.languages[doc].id());
+		payload_writer.write((std::int32_t) corpus.categories[doc]);
+		payload_writer.write_string(corpus.title(doc));
+		payload_writer.write_string(corpus.sources[doc] != NO_SOURCE ? std::string_view(corpus.source_name(corpus.sources[doc])) : std::string_view());
+		payload_writer.write_array(entities.begin(), entities.size());
+		payload_writer.write_array(days.data(), days.size());
+		payload_writer.write((std::uint8_t) corpus.has_embedding(doc));
+		payload_writer.write_array(embedding.begin(), embedding.size());
+
+		BinaryWriter writer(pending_);
+		writer.write((std::uint32_t) payload.size());
+		writer.write(key);
+		pending_ += payload;
+		pending_keys_.push_back(key);
+	}
+
+
+	bool DocumentCache::flush()
+	{
+		if (pending_.empty())
+		{
+			return true;
+		}
+
+		// records that are overwritten by the pending ones become dead
+		std::size_t live_bytes = live_bytes_;
+		for (auto key : pending_keys_)
+		{
+			auto found = records_.find(key);
+			if (found != records_.end())
+			{
+				live_bytes -= found->second.size;
+				records_.erase(found);
+			}
+		}
+		std::size_t dead_bytes = valid_size_ > 0 ? valid_size_ - CACHE_HEADER_SIZE - live_bytes : 0;
+
+		// the file is mapped again on every exit, records_ is never left pointing into the closed mapping;
+		// pending records are kept after a failure, so the next flush writes them again
+		struct Reopen
+		{
+			DocumentCache& cache;
+			~Reopen() { cache.open(); }
+		} reopen{ *this };
+
+		std::error_code error;
+		bool rewrite = valid_size_ == 0 || dead_bytes > live_bytes + pending_.size();
+		if (!rewrite)
+		{
+			// incomplete record of the interrupted run is cut off before appending
+			close();
+			std::filesystem::resize_file(path_, valid_size_, error);
+			std::ofstream file(path_, std::ios::binary | std::ios::app);
+			file.write(pending_.data(), pending_.size());
+			file.close();
+			if (error || !file)
+			{
+				std::cerr << "Cannot write file: " << path_ << std::endl;
+				return false;
+			}
+		}
+		else
+		{
+			// live records keep their order in the log
+			std::vector<Record> live_records;
+			for (const auto& record : records_)
+			{
+				live_records.push_back(record.second);
+			}
+			std::sort(live_records.begin(), live_records.end(), [](const Record& a, const Record& b) { return a.offset < b.offset; });
+
+			auto temp_path = path_ + ".tmp";
+			std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+			std::string header;
+			BinaryWriter writer(header);
+			header.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+			writer.write(CACHE_VERSION);
+			writer.write(fingerprint_);
+			file.write(header.data(), header.size());
+			for (const auto& record : live_records)
+			{
+				file.write(data_ + record.offset, record.size);
+			}
+			file.write(pending_.data(), pending_.size());
+			file.close();
+
+			close();
+			std::filesystem::rename(temp_path, path_, error);
+			if (error || !file)
+			{
+				std::cerr << "Cannot write file: " << path_ << std::endl;
+				return false;
+			}
+		}
+
+		pending_.clear();
+		pending_keys_.clear();
+
+		return true;
+	}
+
+
+	std::size_t DocumentCache::size() const
+	{
+		return records_.size();
+	}
+
+
+	void DocumentCache::open()
+	{
+		records_.clear();
+		valid_size_ = 0;
+		live_bytes_ = 0;
+
+		file_.open(path_);
+		data_ = file_.data();
+		data_size_ = file_.size();
+
+		BinaryReader reader(data_, data_size_);
+		char magic[sizeof(CACHE_MAGIC)];
+		std::uint32_t version;
+		std::uint64_t fingerprint;
+		if (
+			!reader.read(magic) || std::memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+			!reader.read(version) || version != CACHE_VERSION ||
+			!reader.read(fingerprint) || fingerprint != fingerprint_
+		)
+		{
+			// other format or config, cache is started from scratch on flush
+			return;
+		}
+
+		std::uint32_t payload_size;
+		std::uint64_t key;
+		valid_size_ = reader.position();
+		while (reader.read(payload_size) && reader.read(key) && reader.left() >= payload_size)
+		{
+			Record record = { valid_size_, RECORD_HEADER_SIZE + payload_size };
+
+			auto found = records_.find(key);
+			if (found != records_.end())
+			{
+				live_bytes_ -= found->second.size;
+			}
+			records_[key] = record;
+			live_bytes_ += record.size;
+
+			reader.skip(payload_size);
+			valid_size_ += record.size;
+		}
+	}
+
+
+	void DocumentCache::close()
+	{
+		file_.close();
+		data_ = nullptr;
+		data_size_ = 0;
+	}
+
+}  // namespace news_clustering
+#endif
@@ -0,0 +1,130 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_DOCUMENT_CACHE_HPP
+#define _NEWS_CLUSTERING_DOCUMENT_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "binary_io.hpp"
+#include "corpus.hpp"
+
+namespace news_clustering {
+
+	/**
+	 * @brief 64 bit xxHash (XXH64) of the bytes
+	 * @return
+	 */
+	std::uint64_t xxh64(const char* data, std::size_t size, std::uint64_t seed = 0);
+
+	/**
+	 * @class DocumentCache
+	 *
+	 * @brief Results of the per document stages kept between runs, keyed by the hash of the file bytes.
+	 * File is a log of records: new records are appended, the last record of the key wins, and the log is rewritten
+	 * without overwritten records when they take more space than the live ones. File is memory mapped and only
+	 * offsets of the records are kept in memory. Records are valid only for the config with the same fingerprint.
+	 */
+	class DocumentCache {
+
+	public:
+
+		struct Entry
+		{
+			LanguageId language;
+			std::int32_t category;
+			std::string title;
+			std::string source;
+			std::vector<EntityId> entities;
+			std::vector<std::int32_t> days;
+			bool has_embedding;
+			std::vector<Corpus::EmbeddingValue> embedding;
+		};
+
+		/**
+		 * @brief open cache file, records of the other fingerprint are dropped
+		 * @return
+		 */
+		DocumentCache(const std::string& path, std::uint64_t fingerprint);
+
+		~DocumentCache();
+
+		DocumentCache(const DocumentCache&) = delete;
+		DocumentCache& operator=(const DocumentCache&) = delete;
+
+		/**
+		 * @brief can be called from different threads
+		 * @return
+		 */
+		bool contains(std::uint64_t key) const;
+
+		/**
+		 * @brief can be called from different threads
+		 * @return false if there is no such key
+		 */
+		bool find(std::uint64_t key, Entry& entry) const;
+
+		/**
+		 * @brief fill columns of the document: language, category, title, site, name entities, dates and embedding if it was computed
+		 * @return
+		 */
+		static void restore(Corpus& corpus, DocId doc, const Entry& entry);
+
+		/**
+		 * @brief remember the document to write it on flush
+		 * @return
+		 */
+		void put(std::uint64_t key, Corpus& corpus, DocId doc);
+
+		/**
+		 * @brief append remembered documents to the file, compact the file if needed and open it again
+		 * @return false if file cannot be written
+		 */
+		bool flush();
+
+		/**
+		 * @brief
+		 * @return number of the documents in the cache
+		 */
+		std::size_t size() const;
+
+	private:
+
+		struct Record
+		{
+			std::size_t offset;
+			std::size_t size;
+		};
+
+		std::string path_;
+		std::uint64_t fingerprint_;
+
+		MappedFile file_;
+		const char* data_ = nullptr;
+		std::size_t data_size_ = 0;
+
+		// offset and size of the whole record of the each key
+		std::unordered_map<std::uint64_t, Record> records_;
+		// file ends after the last complete record with the same fingerprint, 0 if file should be created again
+		std::size_t valid_size_ = 0;
+		std::size_t live_bytes_ = 0;
+
+		std::string pending_;
+		std::vector<std::uint64_t> pending_keys_;
+
+		void open();
+
+		void close();
+	};
+
+}  // namespace news_clustering
+
+#include "document_cache.cpp"
+
+#endif  // Header Guard
@@ -0,0 +1,127 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_ENTITY_INDEX_CPP
+#define _NEWS_CLUSTERING_ENTITY_INDEX_CPP
+
+#include <algorithm>
+#include "entity_index.hpp"
+
+
+namespace news_clustering {
+
+	std::size_t EntityIndex::add(const std::vector<Entity>& entities)
+	{
+		std::size_t article = article_entities_.size();
+
+		// sets are kept sorted for overlap computing
+		std::vector<Entity> unique_entities(entities);
+		std::sort(unique_entities.begin(), unique_entities.end());
+		unique_entities.erase(std::unique(unique_entities.begin(), unique_entities.end()), unique_entities.end());
+
+		for (auto entity : unique_entities)
+		{
+			postings_[entity].push_back(article);
+		}
+		article_entities_.push_back(std::move(unique_entities));
+
+		return article;
+	}
+
+
+	const std::vector<std::size_t>& EntityIndex::postings(Entity entity) const
+	{
+		auto found = postings_.find(entity);
+		if (found == postings_.end())
+		{
+			return empty_postings_;
+		}
+		return found->second;
+	}
+
+
+	std::vector<std::pair<std::size_t, std::size_t>> EntityIndex::candidate_pairs(std::size_t max_posting_size) const
+	{
+		std::vector<std::pair<std::size_t, std::size_t>> pairs;
+		std::vector<std::size_t> partners;
+
+		// pairs are found per article, so only the partners of one article are kept with duplicates
+		for (std::size_t article = 0; article < article_entities_.size(); article++)
+		{
+			partners.clear();
+			for (auto entity : article_entities_[article])
+			{
+				const auto& articles = postings(entity);
+				// too common entity doesn't tell anything about the thread
+				if (articles.size() > max_posting_size)
+				{
+					continue;
+				}
+				// postings are sorted, the pairs with the previous articles are already found
+				partners.insert(partners.end(), std::upper_bound(articles.begin(), articles.end(), article), articles.end());
+			}
+
+			std::sort(partners.begin(), partners.end());
+			partners.erase(std::unique(partners.begin(), partners.end()), partners.end());
+			for (auto partner : partners)
+			{
+				pairs.push_back({ article, partner });
+			}
+		}
+
+		return pairs;
+	}
+
+
+	float EntityIndex::overlap(std::size_t article_1, std::size_t article_2) const
+	{
+		const auto& entities_1 = article_entities_[article_1];
+		const auto& entities_2 = article_entities_[article_2];
+
+		if (entities_1.empty() || entities_2.empty())
+		{
+			return 0;
+		}
+
+		std::size_t num_common = 0;
+		auto it_1 = entities_1.begin();
+		auto it_2 = entities_2.begin();
+		while (it_1 != entities_1.end() && it_2 != entities_2.end())
+		{
+			if (*it_1 < *it_2)
+			{
+				++it_1;
+			}
+			else if (*it_2 < *it_1)
+			{
+				++it_2;
+			}
+			else
+			{
+				num_common++;
+				++it_1;
+				++it_2;
+			}
+		}
+
+		return (float) num_common / (entities_1.size() + entities_2.size() - num_common);
+	}
+
+
+	bool EntityIndex::has_entities(std::size_t article) const
+	{
+		return !article_entities_[article].empty();
+	}
+
+
+	std::size_t EntityIndex::size() const
+	{
+		return article_entities_.size();
+	}
+
+}  // namespace news_clustering
+#endif
@@ -0,0 +1,77 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_ENTITY_INDEX_HPP
+#define _NEWS_CLUSTERING_ENTITY_INDEX_HPP
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+namespace news_clustering {
+
+	/**
+	 * @class EntityIndex
+	 *
+	 * @brief Inverted index: entity id -> posting list of articles that mention it
+	 */
+	class EntityIndex {
+
+	public:
+
+		using Entity = std::int32_t;
+
+		EntityIndex() = default;
+
+		/**
+		 * @brief add next article, its index is the number of articles added before
+		 * @return index of the article
+		 */
+		std::size_t add(const std::vector<Entity>& entities);
+
+		/**
+		 * @brief
+		 * @return articles that mention the entity
+		 */
+		const std::vector<std::size_t>& postings(Entity entity) const;
+
+		/**
+		 * @brief pairs of articles that have at least one common entity, entities mentioned in more than max_posting_size articles are skipped
+		 * @return unique pairs (i, j) with i < j, sorted
+		 */
+		std::vector<std::pair<std::size_t, std::size_t>> candidate_pairs(std::size_t max_posting_size) const;
+
+		/**
+		 * @brief Jaccard index of entity sets of two articles
+		 * @return
+		 */
+		float overlap(std::size_t article_1, std::size_t article_2) const;
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		bool has_entities(std::size_t article) const;
+
+		/**
+		 * @brief
+		 * @return number of articles
+		 */
+		std::size_t size() const;
+
+	private:
+
+		std::vector<std::vector<Entity>> article_entities_;
+		std::unordered_map<Entity, std::vector<std::size_t>> postings_;
+		std::vector<std::size_t> empty_postings_;
+	};
+
+}  // namespace news_clustering
+
+#include "entity_index.cpp"
+
+#endif  // Header Guard
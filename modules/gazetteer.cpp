@@ -0,0 +1,233 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_GAZETTEER_CPP
+#define _NEWS_CLUSTERING_GAZETTEER_CPP
+
+#include <algorithm>
+#include <numeric>
+#include <deque>
+#include <set>
+#include "gazetteer.hpp"
+
+
+namespace news_clustering {
+
+	void Gazetteer::build(const std::vector<std::vector<std::string>>& phrases, const std::vector<std::int32_t>& values)
+	{
+		struct Node
+		{
+			std::int32_t state;
+			std::size_t begin;
+			std::size_t end;
+			std::size_t depth;
+		};
+
+		std::vector<std::vector<TokenId>> sequences(phrases.size());
+		std::vector<std::size_t> order(phrases.size());
+		std::vector<TokenId> labels;
+		std::vector<std::pair<std::size_t, std::size_t>> children_ranges;
+		// sorted free slots, so bases are tried only where the first child fits
+		std::set<std::int32_t> free_slots;
+		auto grow = [this, &free_slots](std::size_t size)
+		{
+			auto old_size = check_.size();
+			resize(size);
+			for (auto slot = old_size; slot < size; slot++)
+			{
+				free_slots.insert(slot);
+			}
+		};
+
+		token_ids_.clear();
+		num_phrases_ = phrases.size();
+
+		// token ids start from 1, so transition from the state never points to itself
+		for (std::size_t i = 0; i < phrases.size(); i++)
+		{
+			for (const auto& token : phrases[i])
+			{
+				auto inserted = token_ids_.emplace(token, token_ids_.size() + 1);
+				sequences[i].push_back(inserted.first->second);
+			}
+		}
+
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&sequences](std::size_t a, std::size_t b) { return sequences[a] < sequences[b]; });
+
+		base_.clear();
+		check_.clear();
+		values_.clear();
+		grow(token_ids_.size() + 2);
+		// root is always used
+		check_[0] = 0;
+		free_slots.erase(0);
+
+		std::deque<Node> queue = { { 0, 0, order.size(), 0 } };
+		while (!queue.empty())
+		{
+			auto node = queue.front();
+			queue.pop_front();
+
+			labels.clear();
+			children_ranges.clear();
+			for (auto i = node.begin; i < node.end; i++)
+			{
+				const auto& sequence = sequences[order[i]];
+				if (sequence.size() == node.depth)
+				{
+					// sorted, so the shortest sequence goes first; duplicates keep first value
+					if (values_[node.state] < 0)
+					{
+						values_[node.state] = values[order[i]];
+					}
+				}
+				else if (labels.empty() || labels.back() != sequence[node.depth])
+				{
+					labels.push_back(sequence[node.depth]);
+					children_ranges.push_back({ i, i + 1 });
+				}
+				else
+				{
+					children_ranges.back().second = i + 1;
+				}
+			}
+
+			if (labels.empty())
+			{
+				continue;
+			}
+
+			// find first base where all children slots are free
+			std::int32_t base;
+			auto slot = free_slots.lower_bound(1 + labels[0]);
+			while (true)
+			{
+				if (slot == free_slots.end())
+				{
+					auto size = check_.size();
+					grow(size * 2);
+					slot = free_slots.lower_bound(std::max<std::int32_t>(size, 1 + labels[0]));
+					continue;
+				}
+				base = *slot - labels[0];
+				if (base + labels.back() >= (std::int32_t) check_.size())
+				{
+					grow((base + labels.back() + 1) * 2);
+				}
+				bool is_free = true;
+				for (auto label : labels)
+				{
+					if (check_[base + label] >= 0)
+					{
+						is_free = false;
+						break;
+					}
+				}
+				if (is_free)
+				{
+					break;
+				}
+				slot++;
+			}
+
+			base_[node.state] = base;
+			for (std::size_t k = 0; k < labels.size(); k++)
+			{
+				check_[base + labels[k]] = node.state;
+				free_slots.erase(base + labels[k]);
+				queue.push_back({ base + labels[k], children_ranges[k].first, children_ranges[k].second, node.depth + 1 });
+			}
+		}
+
+		// trim unused tail
+		auto last_used = check_.size();
+		while (last_used > 1 && check_[last_used - 1] < 0)
+		{
+			last_used--;
+		}
+		base_.resize(last_used);
+		check_.resize(last_used);
+		values_.resize(last_used);
+		base_.shrink_to_fit();
+		check_.shrink_to_fit();
+		values_.shrink_to_fit();
+	}
+
+
+	Gazetteer::TokenId Gazetteer::token_id(const std::string& token) const
+	{
+		auto found = token_ids_.find(token);
+		if (found == token_ids_.end())
+		{
+			return -1;
+		}
+		return found->second;
+	}
+
+
+	void Gazetteer::find(const std::vector<TokenId>& tokens, std::vector<std::int32_t>& found) const
+	{
+		std::int32_t state;
+		std::int32_t next_state;
+		std::size_t best_length;
+		std::int32_t best_value;
+
+		if (check_.empty())
+		{
+			return;
+		}
+
+		std::size_t i = 0;
+		while (i < tokens.size())
+		{
+			state = 0;
+			best_length = 0;
+			best_value = -1;
+			for (auto j = i; j < tokens.size() && tokens[j] > 0; j++)
+			{
+				next_state = base_[state] + tokens[j];
+				if (base_[state] == 0 || next_state >= (std::int32_t) check_.size() || check_[next_state] != state)
+				{
+					break;
+				}
+				state = next_state;
+				if (values_[state] >= 0)
+				{
+					best_length = j - i + 1;
+					best_value = values_[state];
+				}
+			}
+
+			if (best_length > 0)
+			{
+				found.push_back(best_value);
+				i += best_length;
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+
+	std::size_t Gazetteer::size() const
+	{
+		return num_phrases_;
+	}
+
+
+	void Gazetteer::resize(std::size_t size)
+	{
+		base_.resize(size, 0);
+		check_.resize(size, -1);
+		values_.resize(size, -1);
+	}
+
+}  // namespace news_clustering
+#endif
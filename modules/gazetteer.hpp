@@ -0,0 +1,71 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_GAZETTEER_HPP
+#define _NEWS_CLUSTERING_GAZETTEER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace news_clustering {
+
+	/**
+	 * @class Gazetteer
+	 *
+	 * @brief Compiled list of phrases: double-array trie over token ids, so multi-token phrases are found in one scan
+	 */
+	class Gazetteer {
+
+	public:
+
+		using TokenId = std::int32_t;
+
+		Gazetteer() = default;
+
+		/**
+		 * @brief compile phrases, each phrase is sequence of tokens and has its own value
+		 * @return
+		 */
+		void build(const std::vector<std::vector<std::string>>& phrases, const std::vector<std::int32_t>& values);
+
+		/**
+		 * @brief id of the token or -1 if token is not a part of any phrase
+		 * @return
+		 */
+		TokenId token_id(const std::string& token) const;
+
+		/**
+		 * @brief find longest non overlapping phrases in the sequence of token ids and append its values to found
+		 * @return
+		 */
+		void find(const std::vector<TokenId>& tokens, std::vector<std::int32_t>& found) const;
+
+		/**
+		 * @brief number of compiled phrases
+		 * @return
+		 */
+		std::size_t size() const;
+
+	private:
+
+		std::size_t num_phrases_ = 0;
+		std::unordered_map<std::string, TokenId> token_ids_;
+
+		std::vector<std::int32_t> base_;
+		std::vector<std::int32_t> check_;
+		std::vector<std::int32_t> values_;
+
+		void resize(std::size_t size);
+	};
+
+}  // namespace news_clustering
+
+#include "gazetteer.cpp"
+
+#endif  // Header Guard
@@ -0,0 +1,284 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_JSON_WRITER_CPP
+#define _NEWS_CLUSTERING_JSON_WRITER_CPP
+
+#include <iostream>
+#if defined(_WIN64)
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+#include "json_writer.hpp"
+
+
+namespace news_clustering {
+
+	JsonWriter::JsonWriter(int fd, bool pretty, std::size_t buffer_size) : fd_(fd), pretty_(pretty), buffer_size_(buffer_size)
+	{
+		buffer_.reserve(buffer_size_);
+	}
+
+
+	JsonWriter::~JsonWriter()
+	{
+		flush();
+	}
+
+
+	void JsonWriter::begin_object()
+	{
+		begin_value();
+		write('{');
+		levels_.push_back({ true, 0 });
+	}
+
+
+	void JsonWriter::end_object()
+	{
+		end_level('}');
+	}
+
+
+	void JsonWriter::begin_array()
+	{
+		begin_value();
+		write('[');
+		levels_.push_back({ false, 0 });
+	}
+
+
+	void JsonWriter::end_array()
+	{
+		end_level(']');
+	}
+
+
+	void JsonWriter::key(std::string_view name)
+	{
+		auto& level = levels_.back();
+		if (level.num_items > 0)
+		{
+			write(',');
+		}
+		level.num_items++;
+		write_indent();
+
+		write('"');
+		write_escaped(name);
+		write(pretty_ ? "\": " : "\":");
+		after_key_ = true;
+	}
+
+
+	void JsonWriter::value(std::string_view text)
+	{
+		begin_value();
+		write('"');
+		write_escaped(text);
+		write('"');
+		if (levels_.empty())
+		{
+			write('\n');
+		}
+	}
+
+
+	void JsonWriter::value(const char* text)
+	{
+		value(std::string_view(text));
+	}
+
+
+	void JsonWriter::value(std::int64_t number)
+	{
+		begin_value();
+		write(std::to_string(number));
+		if (levels_.empty())
+		{
+			write('\n');
+		}
+	}
+
+
+	void JsonWriter::flush()
+	{
+		std::size_t written = 0;
+		while (written < buffer_.size())
+		{
+			#if defined(_WIN64)
+				auto result = _write(fd_, buffer_.data() + written, buffer_.size() - written);
+			#else
+				auto result = ::write(fd_, buffer_.data() + written, buffer_.size() - written);
+			#endif
+			if (result <= 0)
+			{
+				std::cerr << "Cannot write output to the file descriptor: " << fd_ << std::endl;
+				break;
+			}
+			written += result;
+		}
+		buffer_.clear();
+	}
+
+
+	void JsonWriter::begin_value()
+	{
+		// value after key is already separated
+		if (after_key_)
+		{
+			after_key_ = false;
+			return;
+		}
+		if (!levels_.empty())
+		{
+			auto& level = levels_.back();
+			if (level.num_items > 0)
+			{
+				write(',');
+			}
+			level.num_items++;
+			write_indent();
+		}
+	}
+
+
+	void JsonWriter::end_level(char bracket)
+	{
+		bool is_empty = levels_.back().num_items == 0;
+		levels_.pop_back();
+
+		// empty containers are written as [] and {}
+		if (!is_empty)
+		{
+			write_indent();
+		}
+		write(bracket);
+
+		if (levels_.empty())
+		{
+			write('\n');
+			flush();
+		}
+	}
+
+
+	void JsonWriter::write(std::string_view bytes)
+	{
+		if (buffer_.size() + bytes.size() > buffer_size_)
+		{
+			flush();
+		}
+		buffer_.append(bytes.data(), bytes.size());
+	}
+
+
+	void JsonWriter::write(char c)
+	{
+		if (buffer_.size() + 1 > buffer_size_)
+		{
+			flush();
+		}
+		buffer_.push_back(c);
+	}
+
+
+	void JsonWriter::write_indent()
+	{
+		if (!pretty_)
+		{
+			return;
+		}
+		write('\n');
+		for (std::size_t i = 0; i < levels_.size(); i++)
+		{
+			write("    ");
+		}
+	}
+
+
+	void JsonWriter::write_escaped(std::string_view text)
+	{
+		static const char* hex_digits = "0123456789abcdef";
+		static const std::string_view replacement = "\xEF\xBF\xBD";
+
+		std::size_t i = 0;
+		while (i < text.size())
+		{
+			auto c = (unsigned char) text[i];
+
+			if (c < 0x80)
+			{
+				switch (c)
+				{
+					case '"': write("\\\""); break;
+					case '\\': write("\\\\"); break;
+					case '\b': write("\\b"); break;
+					case '\f': write("\\f"); break;
+					case '\n': write("\\n"); break;
+					case '\r': write("\\r"); break;
+					case '\t': write("\\t"); break;
+					default:
+						if (c < 0x20)
+						{
+							write("\\u00");
+							write(hex_digits[c >> 4]);
+							write(hex_digits[c & 0x0F]);
+						}
+						else
+						{
+							write((char) c);
+						}
+				}
+				i++;
+				continue;
+			}
+
+			// length of the utf-8 sequence and allowed range of its second byte
+			std::size_t length = 0;
+			unsigned char second_min = 0x80;
+			unsigned char second_max = 0xBF;
+			if (c >= 0xC2 && c <= 0xDF)
+			{
+				length = 2;
+			}
+			else if (c >= 0xE0 && c <= 0xEF)
+			{
+				length = 3;
+				second_min = c == 0xE0 ? 0xA0 : 0x80;
+				second_max = c == 0xED ? 0x9F : 0xBF;
+			}
+			else if (c >= 0xF0 && c <= 0xF4)
+			{
+				length = 4;
+				second_min = c == 0xF0 ? 0x90 : 0x80;
+				second_max = c == 0xF4 ? 0x8F : 0xBF;
+			}
+
+			bool is_valid = length > 0 && i + length <= text.size();
+			for (std::size_t k = 1; is_valid && k < length; k++)
+			{
+				auto next = (unsigned char) text[i + k];
+				is_valid = k == 1 ? next >= second_min && next <= second_max : next >= 0x80 && next <= 0xBF;
+			}
+
+			if (is_valid)
+			{
+				write(text.substr(i, length));
+				i += length;
+			}
+			else
+			{
+				write(replacement);
+				i++;
+			}
+		}
+	}
+
+}  // namespace news_clustering
+#endif
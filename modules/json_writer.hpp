@@ -0,0 +1,116 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_JSON_WRITER_HPP
+#define _NEWS_CLUSTERING_JSON_WRITER_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace news_clustering {
+
+	/**
+	 * @class JsonWriter
+	 *
+	 * @brief Streaming json output: values are written to the buffer as they come and the buffer is flushed to the file descriptor,
+	 * so no document tree is built. Pretty output is the same as nlohmann::json dump(4) gives if keys are written in alphabetical order.
+	 */
+	class JsonWriter {
+
+	public:
+
+		explicit JsonWriter(int fd = 1, bool pretty = true, std::size_t buffer_size = 1 << 16);
+
+		~JsonWriter();
+
+		JsonWriter(const JsonWriter&) = delete;
+		JsonWriter& operator=(const JsonWriter&) = delete;
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void begin_object();
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void end_object();
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void begin_array();
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void end_array();
+
+		/**
+		 * @brief key of the next value, only inside object
+		 * @return
+		 */
+		void key(std::string_view name);
+
+		/**
+		 * @brief string value, invalid utf-8 bytes are replaced with U+FFFD
+		 * @return
+		 */
+		void value(std::string_view text);
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void value(const char* text);
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void value(std::int64_t number);
+
+		/**
+		 * @brief write buffered bytes to the file descriptor
+		 * @return
+		 */
+		void flush();
+
+	private:
+
+		struct Level
+		{
+			bool is_object;
+			std::size_t num_items;
+		};
+
+		int fd_;
+		bool pretty_;
+		std::size_t buffer_size_;
+		std::string buffer_;
+		std::vector<Level> levels_;
+		bool after_key_ = false;
+
+		void begin_value();
+		void end_level(char bracket);
+		void write(std::string_view bytes);
+		void write(char c);
+		void write_indent();
+		void write_escaped(std::string_view text);
+	};
+
+}  // namespace news_clustering
+
+#include "json_writer.cpp"
+
+#endif  // Header Guard
@@ -28,29 +28,29 @@ namespace news_clustering {
 	}
 
 	
-	std::unordered_map<Language, std::vector<std::string>> LanguageDetector::detect_language(
-		std::unordered_map<std::string, std::vector<std::string>>& contents, 
+	std::unordered_map<Language, DocIds> LanguageDetector::detect_language(
+		Corpus& corpus, 
+		const DocIds& docs, 
 		size_t num_language_samples, 
 		double language_score_min_level
 	)
 	{
-		std::unordered_map<Language, std::vector<std::string>> result;
-		std::vector<std::string> content;
+		std::unordered_map<Language, DocIds> result;
 
 		Language language;
 		
-		for (auto c = contents.begin(); c != contents.end(); c++)
+		for (auto doc : docs)
 		{
-			content = c->second;
-			language = detect_language_by_single_content(content, num_language_samples, language_score_min_level);
-			result[language].push_back(c->first);
+			language = detect_language_by_single_content(corpus.tokens(doc), num_language_samples, language_score_min_level);
+			corpus.languages[doc] = language;
+			result[language].push_back(doc);
 		}
 
 		return result;
 	}
 
 
-	Language LanguageDetector::detect_language_by_single_content(std::vector<std::string>& content, size_t num_language_samples, double language_score_min_level)
+	Language LanguageDetector::detect_language_by_single_content(const TokensView& content, size_t num_language_samples, double language_score_min_level)
 	{		
 		// Random sampleing 
 		std::vector<size_t> randomized_samples(content.size());
@@ -82,13 +82,14 @@ namespace news_clustering {
 	}
 
 
-	double LanguageDetector::count_vocab_frequency(std::vector<std::string> content, std::vector<size_t> sampling_indexes, std::unordered_map<std::string, std::string>& vocab)
+	double LanguageDetector::count_vocab_frequency(const TokensView& content, const std::vector<size_t>& sampling_indexes, std::unordered_map<std::string, std::string>& vocab)
 	{
 		int score = 0;
+		std::string sample;
 
 		for (auto i = 0; i < sampling_indexes.size(); i++)
 		{
-			std::string sample = content[sampling_indexes[i]];
+			sample = content[sampling_indexes[i]];
 			
 			if (vocab.find(sample) != vocab.end()) 
 			{
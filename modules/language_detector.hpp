@@ -10,6 +10,7 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 
 #include "languages.hpp"
 #include "content_parser.hpp"
+#include "corpus.hpp"
 
 namespace news_clustering {
 
@@ -30,8 +31,9 @@ namespace news_clustering {
 		 * @brief 
 		 * @return 
 		 */
-		std::unordered_map<Language, std::vector<std::string>> detect_language(
-			std::unordered_map<std::string, std::vector<std::string>>& contents, 
+		std::unordered_map<Language, DocIds> detect_language(
+			Corpus& corpus, 
+			const DocIds& docs, 
 			size_t num_language_samples, 
 			double language_score_min_level
 		);
@@ -40,13 +42,13 @@ namespace news_clustering {
 		 * @brief 
 		 * @return 
 		 */
-		Language detect_language_by_single_content(std::vector<std::string>& content, size_t num_language_samples, double language_score_min_level);
+		Language detect_language_by_single_content(const TokensView& content, size_t num_language_samples, double language_score_min_level);
 		
 		/**
 		 * @brief 
 		 * @return 
 		 */
-		double count_vocab_frequency(std::vector<std::string> content, std::vector<size_t> sampling_indexes, std::unordered_map<std::string, std::string>& vocab);
+		double count_vocab_frequency(const TokensView& content, const std::vector<size_t>& sampling_indexes, std::unordered_map<std::string, std::string>& vocab);
 
 	private:
 
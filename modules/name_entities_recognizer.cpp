@@ -8,6 +8,12 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #ifndef _NEWS_CLUSTERING_NER_CPP
 #define _NEWS_CLUSTERING_NER_CPP
 
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+#include <thread>
+#include <mutex>
+#include <boost/locale/utf.hpp>
 #include "name_entities_recognizer.hpp"
 
 
@@ -20,91 +26,201 @@ namespace news_clustering {
 			std::unordered_map<Language, std::locale>& locales
 	) : languages_(languages), locales_(locales), text_embedders_(embedders)
 	{
+		std::vector<std::string> vocab_words;
+		std::vector<std::vector<std::string>> phrases;
+		std::vector<EntityId> values;
+		std::vector<std::string> phrase;
+
+		for (const auto& language : languages_)
+		{
+			auto& vocab = text_embedders_[language].vocab_clusters;
+
+			// sorted, so entity ids are the same from run to run
+			vocab_words.clear();
+			for (auto w = vocab.begin(); w != vocab.end(); w++)
+			{
+				vocab_words.push_back(w->first);
+			}
+			std::sort(vocab_words.begin(), vocab_words.end());
+
+			phrases.clear();
+			values.clear();
+			for (const auto& word : vocab_words)
+			{
+				if (vocab_word_to_phrase(word, language, vocab, phrase))
+				{
+					phrases.push_back(phrase);
+					values.push_back(entity_names_.size());
+					entity_names_.push_back(word);
+				}
+			}
+
+			gazetteers_[language].build(phrases, values);
+		}
 	};
 	
 
-	std::unordered_map<std::string, std::vector<std::string>> NER::find_name_entities(
-		std::unordered_map<std::string, news_clustering::Language> file_names, 
-		std::unordered_map<std::string, std::vector<std::string>> contents
+	void NER::find_name_entities(
+		Corpus& corpus, 
+		const DocIds& docs, 
+		ThreadPool& pool
 	)
 	{
+		// one task per document, as the other stages of the pool
+		Semaphore sem;
+		for (auto i : docs)
+		{
+			pool.execute(
+				[i, &sem, &corpus, this]()
+				{
+					auto language = corpus.languages[i];
+					auto gazetteer = gazetteers_.find(language);
+					if (gazetteer == gazetteers_.end())
+					{
+						sem.notify();
+						return;
+					}
 
-		// TODO: check problem with "" symbol. Looks like it is interpretated as special symbol and return caret by one symbol back
-		std::vector<std::string> content;
-		std::vector<std::string> ngram;
-		std::vector<std::vector<std::string>> ngrams;
-		std::vector<std::string> name_entities;
-		std::unordered_map<std::string, std::vector<std::string>> result;
-		std::string entity;
-		std::string lower;
+					// every token is normalized and looked up once, then phrases are matched over ids
+					std::vector<Gazetteer::TokenId> token_ids;
+					for (const auto& word : corpus.tokens(i))
+					{
+						token_ids.push_back(gazetteer->second.token_id(normalize_token(word, language)));
+					}
 
-		std::locale locale;
-		TextEmbedder embedder;
+					std::vector<EntityId> found_entities;
+					gazetteer->second.find(token_ids, found_entities);
+					corpus.set_entities(i, found_entities);
 
-		bool ngramm_started = false;
-		
-		for (auto c = file_names.begin(); c != file_names.end(); c++)
+					sem.notify();
+				}
+			);
+		}
+		for (std::size_t k = 0; k < docs.size(); k++)
 		{
-			content = contents[c->first];
-			locale = locales_[c->second];
-			embedder = text_embedders_[c->second];
-			for (auto i = 0; i < content.size(); i++)
-			{
-				lower = boost::locale::to_lower(content[i], locale);
-				if (lower != content[i])
+			sem.wait();
+		}
+	};
+
+
+	const std::string& NER::entity_name(EntityId id) const
+	{
+		return entity_names_[id];
+	}
+
+
+	std::size_t NER::num_entities() const
+	{
+		return entity_names_.size();
+	}
+
+
+	bool NER::vocab_word_to_phrase(
+		const std::string& word, 
+		const Language& language, 
+		const TextEmbedder::VocabClusters& vocab, 
+		std::vector<std::string>& phrase
+	)
+	{
+		static const std::string propn_suffix = "_PROPN";
+		std::size_t part_start = 0;
+		std::size_t part_end;
+
+		phrase.clear();
+
+		switch (language.id())
+		{
+			case RUSSIAN_LANGUAGE:
+				// lemmatized vocab: only proper nouns, multi-token names are joined with "::"
+				if (word.size() <= propn_suffix.size() || word.compare(word.size() - propn_suffix.size(), propn_suffix.size(), propn_suffix) != 0)
+				{
+					return false;
+				}
+				while ((part_end = word.find("::", part_start)) != std::string::npos)
 				{
-					if (!ngramm_started)
+					phrase.push_back(word.substr(part_start, part_end - part_start));
+					part_start = part_end + 2;
+				}
+				phrase.push_back(word.substr(part_start, word.size() - propn_suffix.size() - part_start));
+				break;
+
+			case ENGLISH_LANGUAGE:
+			default:
+				// cased vocab: multi-token names are joined with "_", each part should be capitalized
+				while ((part_end = word.find('_', part_start)) != std::string::npos)
+				{
+					phrase.push_back(word.substr(part_start, part_end - part_start));
+					part_start = part_end + 1;
+				}
+				phrase.push_back(word.substr(part_start));
+				
+				for (const auto& part : phrase)
+				{
+					if (part.empty() || part[0] < 'A' || part[0] > 'Z')
 					{
-						ngramm_started = true;
+						return false;
 					}
-					ngram.push_back(lower);
 				}
-				else
+				// single capitalized word is a name only if it never appears in lower case (skips "The", "President", ...)
+				if (phrase.size() == 1)
 				{
-					if (ngram.size() > 1)
+					auto lower = word;
+					std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+					if (word.size() < 2 || vocab.find(lower) != vocab.end())
 					{
-						ngrams.push_back(ngram);
+						return false;
 					}
-					ngramm_started = false;
-					ngram.clear();
 				}
-			}
+				break;
+		}
 
-			
-			for (const auto& n : ngrams)
+		for (const auto& part : phrase)
+		{
+			if (part.empty())
 			{
-				for (auto i = 0; i < n.size() - 1; i++)
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	std::string NER::normalize_token(std::string_view word, const Language& language)
+	{
+		using utf = boost::locale::utf::utf_traits<char>;
+		std::string lower;
+		std::string lemma;
+		std::size_t suffix_start;
+		std::string_view::const_iterator word_begin;
+		std::string::const_iterator lower_begin;
+
+		switch (language.id())
+		{
+			case RUSSIAN_LANGUAGE:
+				// vocab is lower cased and tagger marks a lot of common words as proper nouns, so names are taken only if capitalized in the text
+				lower = boost::locale::to_lower(word.data(), word.data() + word.size(), locales_.find(language)->second);
+				// first letters are compared as code points, lower case letter can take the other number of bytes
+				word_begin = word.begin();
+				lower_begin = lower.cbegin();
+				if (lower.empty() || utf::decode(word_begin, word.end()) == utf::decode(lower_begin, lower.cend()))
 				{
-					switch (c->second.id())
-					{
-						case RUSSIAN_LANGUAGE:
-							entity = n[i] + "::";
-							break;
-
-						case ENGLISH_LANGUAGE:
-						default:
-							entity = n[i] + "_";
-							break;
-					}
+					return "";
 				}
-				entity += n[n.size() - 1];
-
-				// check if found ngram exist in the vocab
-				if (embedder.is_exist_in_vocab(entity, locale))
+				lemma = text_embedders_.find(language)->second.lemmatizer_(lower);
+				// lemmatizer adds part of speech tag
+				suffix_start = lemma.rfind('_');
+				if (suffix_start != std::string::npos)
 				{
-					name_entities.push_back(entity);
+					lemma.resize(suffix_start);
 				}
-			}
-			
-			result[c->first] = name_entities;
-			name_entities.clear();
-			ngrams.clear();
-			ngram.clear();
-			ngramm_started = false;
-		}
+				return lemma;
 
-		return result;
-	};
+			case ENGLISH_LANGUAGE:
+			default:
+				return std::string(word);
+		}
+	}
 
 	//
 
@@ -124,13 +240,14 @@ namespace news_clustering {
 	};
 
 	
-	std::vector<std::vector<int>> DatesExtractor::find_date(
-		std::vector<std::string>& content,
+	std::vector<std::int32_t> DatesExtractor::find_date(
+		const TokensView& content,
 		const Language& language
 	)
 	{
-		std::vector<std::vector<int>> dates;		
+		std::vector<std::int32_t> dates;		
 		std::vector<int> date;
+		std::string word;
 
 		auto day_names = day_names_[language];
 		auto month_names = month_names_[language];
@@ -138,30 +255,32 @@ namespace news_clustering {
 
 		for (auto i = 0; i < content.size(); i++)
 		{
-			if (month_names.find(boost::locale::to_lower(content[i], locale)) != month_names.end())
+			word = content[i];
+			if (month_names.find(boost::locale::to_lower(word, locale)) != month_names.end())
 			{
 				date.clear();
 
 				if (i > 0 && i < content.size() - 1)
 				{
-					date = check_if_date(content[i - 1], content[i], content[i + 1], language);
+					date = check_if_date(std::string(content[i - 1]), word, std::string(content[i + 1]), language);
 					//std::cout << content[i - 1] << "." << content[i] << "." << content[i + 1] << std::endl;
 				}
 				else if (i == 0)
 				{
-					date = check_if_date("", content[i], content[i + 1], language);
+					date = check_if_date("", word, std::string(content[i + 1]), language);
 					//std::cout << "." << content[i] << "." << content[i + 1] << std::endl;
 				}
 				else if (i == content.size() - 1)
 				{
-					date = check_if_date(content[i - 1], content[i], "", language);
+					date = check_if_date(std::string(content[i - 1]), word, "", language);
 					//std::cout << content[i - 1] << "." << content[i] << "." << std::endl;
 				}
 
 				if (date.size() == 3)
 				{
 					//std::cout << date[0] << "." << date[1] << "." << date[2] << std::endl;
-					dates.push_back(date);
+					// if year == 0 then it means current year
+					dates.push_back(to_epoch_days(date[0], date[1], date[2] > 0 ? date[2] : now_year_));
 					i += 2;
 				}
 			}
@@ -171,25 +290,12 @@ namespace news_clustering {
 	}
 
 	
-	std::unordered_map<std::string, std::vector<std::vector<int>>> DatesExtractor::find_dates(
-		std::unordered_map<std::string, news_clustering::Language>& file_names, 
-		std::unordered_map<std::string, std::vector<std::string>>& contents
-	)
+	void DatesExtractor::find_dates(Corpus& corpus, const DocIds& docs)
 	{
-		std::unordered_map<std::string, std::vector<std::vector<int>>> result;
-		
-		std::vector<std::string> content;
-		Language language;
-		
-		for (auto f = file_names.begin(); f != file_names.end(); f++)
+		for (auto doc : docs)
 		{
-			content = contents[f->first];
-			language = f->second;
-
-			result[f->first] = find_date(content, language);
+			corpus.dates.append(doc, find_date(corpus.tokens(doc), corpus.languages[doc]));
 		}
-
-		return result;
 	};
 
 
@@ -396,38 +502,168 @@ namespace news_clustering {
 	};
 	
 
-	std::unordered_map<std::string, std::string> TitleExtractor::find_titles(
-		std::unordered_map<std::string, news_clustering::Language> file_names
+	void TitleExtractor::find_titles(
+		Corpus& corpus, 
+		const DocIds& docs, 
+		ThreadPool& pool
 	)
 	{
-		std::unordered_map<std::string, std::string> result;
-		
-		std::vector<std::string> content;
-		std::locale locale;
-		std::size_t found_start;
-		std::size_t found_end;
-		std::size_t found_size;
-
-		std::string search_string = "<meta property=\"og:title\" content=\"";	
-
-		int ngramms_found = 0;
-		
-		for (auto c = file_names.begin(); c != file_names.end(); c++)
+		// one task per document, raw contents are only read here
+		Semaphore sem;
+		for (auto i : docs)
+		{
+			pool.execute(
+				[i, &sem, &corpus, this]()
+				{
+					auto title = find_title(corpus.raw(i));
+					if (!title.empty())
+					{
+						corpus.set_title(i, title);
+					}
+					auto site_name = find_meta(corpus.raw(i), "og:site_name");
+					if (!site_name.empty())
+					{
+						corpus.set_source(i, site_name);
+					}
+
+					sem.notify();
+				}
+			);
+		}
+		for (std::size_t k = 0; k < docs.size(); k++)
+		{
+			sem.wait();
+		}
+	}
+
+
+	std::string TitleExtractor::find_title(const std::string& raw_content)
+	{
+		return find_meta(raw_content, "og:title");
+	}
+
+
+	std::string TitleExtractor::find_meta(const std::string& raw_content, const std::string& property)
+	{
+		const std::string search_string = "<meta property=\"" + property + "\" content=\"";
+
+		const char* found_start;
+		const char* found_end;
+		const char* content_end = raw_content.data() + raw_content.size();
+
+		#if defined(__linux__)
+			found_start = (const char*) memmem(raw_content.data(), raw_content.size(), search_string.data(), search_string.size());
+		#else
+			found_start = std::search(raw_content.data(), content_end, search_string.begin(), search_string.end());
+			if (found_start == content_end)
+			{
+				found_start = nullptr;
+			}
+		#endif
+
+		if (found_start == nullptr)
+		{
+			return "";
+		}
+		found_start += search_string.size();
+
+		found_end = (const char*) memchr(found_start, '"', content_end - found_start);
+		if (found_end == nullptr)
+		{
+			return "";
+		}
+
+		return decode_html_entities(std::string(found_start, found_end));
+	}
+
+
+	std::string TitleExtractor::decode_html_entities(const std::string& text)
+	{
+		static const std::unordered_map<std::string, std::uint32_t> named_entities = {
+			{"quot", '"'}, {"amp", '&'}, {"apos", '\''}, {"lt", '<'}, {"gt", '>'}, {"nbsp", ' '}, 
+			{"laquo", 0xAB}, {"raquo", 0xBB}, {"ndash", 0x2013}, {"mdash", 0x2014}, 
+			{"lsquo", 0x2018}, {"rsquo", 0x2019}, {"ldquo", 0x201C}, {"rdquo", 0x201D}, {"bdquo", 0x201E}, 
+			{"hellip", 0x2026}, {"copy", 0xA9}, {"reg", 0xAE}, {"trade", 0x2122}, {"euro", 0x20AC}, {"deg", 0xB0}
+		};
+
+		std::string result;
+		result.reserve(text.size());
+
+		std::size_t entity_end;
+		std::uint32_t code_point;
+		std::string entity;
+
+		for (std::size_t i = 0; i < text.size(); i++)
 		{
-			locale = locales_[c->second];
-			content = content_parser.parse_by_lines(c->first, locale);
-
-			for (auto i = 0; i < content.size(); i++)
-			{				
-				found_start = content[i].find(search_string);
-				found_end = content[i].find("\"/>", content[i].size() - 4);
-				found_size = found_end - (found_start + search_string.size());
-				if (found_start != std::string::npos)
+			entity_end = std::string::npos;
+			if (text[i] == '&')
+			{
+				// longest entity we know is shorter than 10 symbols
+				entity_end = text.find(';', i + 1);
+				if (entity_end != std::string::npos && entity_end - i > 10)
 				{
-					result[c->first] = content[i].substr(found_start + search_string.size(), found_size);
-					break;
+					entity_end = std::string::npos;
 				}
 			}
+			if (entity_end == std::string::npos)
+			{
+				result.push_back(text[i]);
+				continue;
+			}
+
+			entity = text.substr(i + 1, entity_end - i - 1);
+			code_point = 0;
+			if (entity.size() > 1 && entity[0] == '#')
+			{
+				if (entity[1] == 'x' || entity[1] == 'X')
+				{
+					code_point = std::strtoul(entity.c_str() + 2, nullptr, 16);
+				}
+				else
+				{
+					code_point = std::strtoul(entity.c_str() + 1, nullptr, 10);
+				}
+			}
+			else
+			{
+				auto found = named_entities.find(entity);
+				if (found != named_entities.end())
+				{
+					code_point = found->second;
+				}
+			}
+
+			if (code_point == 0 || code_point > 0x10FFFF)
+			{
+				// unknown entity, leave as is
+				result.push_back(text[i]);
+				continue;
+			}
+
+			// utf-8 encoding
+			if (code_point < 0x80)
+			{
+				result.push_back(code_point);
+			}
+			else if (code_point < 0x800)
+			{
+				result.push_back(0xC0 | (code_point >> 6));
+				result.push_back(0x80 | (code_point & 0x3F));
+			}
+			else if (code_point < 0x10000)
+			{
+				result.push_back(0xE0 | (code_point >> 12));
+				result.push_back(0x80 | ((code_point >> 6) & 0x3F));
+				result.push_back(0x80 | (code_point & 0x3F));
+			}
+			else
+			{
+				result.push_back(0xF0 | (code_point >> 18));
+				result.push_back(0x80 | ((code_point >> 12) & 0x3F));
+				result.push_back(0x80 | ((code_point >> 6) & 0x3F));
+				result.push_back(0x80 | (code_point & 0x3F));
+			}
+			i = entity_end;
 		}
 
 		return result;
@@ -9,16 +9,21 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #ifndef _NEWS_CLUSTERING_NER_HPP
 #define _NEWS_CLUSTERING_NER_HPP
 
+#include <thread>
+#include "metric/modules/utils/ThreadPool.h"
+#include "metric/modules/utils/Semaphore.h"
 #include "languages.hpp"
 #include "modules/text_embedding.hpp"
+#include "modules/dates_store.hpp"
+#include "modules/gazetteer.hpp"
+#include "modules/corpus.hpp"
 
 namespace news_clustering {
 
-
 	/**
 	 * @class NER
 	 * 
-	 * @brief NER
+	 * @brief NER: name entities from the word2vec vocabs are compiled to gazetteer and found in one scan over article
 	 */
 	class NER {
 
@@ -33,18 +38,40 @@ namespace news_clustering {
 		);
 
 		/**
-		 * @brief 
+		 * @brief ids of the found entities are stored to the corpus for the each article, in order of appearance
 		 * @return 
 		 */
-		std::unordered_map<std::string, std::vector<std::string>> find_name_entities(
-			std::unordered_map<std::string, news_clustering::Language> file_names, 
-			std::unordered_map<std::string, std::vector<std::string>> content
+		void find_name_entities(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			ThreadPool& pool
 		);
 
+		/**
+		 * @brief 
+		 * @return vocab word of the entity, f.e. New_York
+		 */
+		const std::string& entity_name(EntityId id) const;
+
+		/**
+		 * @brief 
+		 * @return 
+		 */
+		std::size_t num_entities() const;
+
 		
 		std::vector<Language> languages_;
 		std::unordered_map<Language, std::locale>& locales_;
 		std::unordered_map<Language, TextEmbedder>& text_embedders_;
+
+	private:
+
+		std::unordered_map<Language, Gazetteer> gazetteers_;
+		std::vector<std::string> entity_names_;
+
+		bool vocab_word_to_phrase(const std::string& word, const Language& language, const TextEmbedder::VocabClusters& vocab, std::vector<std::string>& phrase);
+		
+		std::string normalize_token(std::string_view word, const Language& language);
 	};
 
 
@@ -70,20 +97,17 @@ namespace news_clustering {
 		);
 
 		/**
-		 * @brief 
+		 * @brief found dates are stored to the corpus
 		 * @return 
 		 */
-		std::unordered_map<std::string, std::vector<std::vector<int>>> find_dates(
-			std::unordered_map<std::string, news_clustering::Language>& file_names, 
-			std::unordered_map<std::string, std::vector<std::string>>& contents
-		);
+		void find_dates(Corpus& corpus, const DocIds& docs);
 		
 		/**
 		 * @brief 
 		 * @return 
 		 */
-		std::vector<std::vector<int>> find_date(
-			std::vector<std::string>& content,
+		std::vector<std::int32_t> find_date(
+			const TokensView& content,
 			const Language& language
 		);
 			
@@ -125,13 +149,33 @@ namespace news_clustering {
 		TitleExtractor(std::unordered_map<Language, std::locale>& locales);
 
 		/**
-		 * @brief 
+		 * @brief found titles and site names (as sources) are stored to the corpus, documents are searched by the tasks of the pool
 		 * @return 
 		 */
-		std::unordered_map<std::string, std::string> find_titles(
-			std::unordered_map<std::string, news_clustering::Language> file_names
+		void find_titles(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			ThreadPool& pool
 		);
 
+		/**
+		 * @brief search og:title meta tag in the raw html
+		 * @return 
+		 */
+		std::string find_title(const std::string& raw_content);
+
+		/**
+		 * @brief search meta tag with the open graph property, f.e. og:site_name, in the raw html
+		 * @return decoded content of the tag, empty if not found
+		 */
+		std::string find_meta(const std::string& raw_content, const std::string& property);
+
+		/**
+		 * @brief replace named and numeric html entities with utf-8 symbols
+		 * @return 
+		 */
+		std::string decode_html_entities(const std::string& text);
+
 	private:
 
 		ContentParser content_parser = news_clustering::ContentParser();
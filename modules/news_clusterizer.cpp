@@ -10,6 +10,8 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 
 #include <numeric>      
 #include <algorithm>    
+#include <tuple>
+#include <thread>
 #include "news_clusterizer.hpp"
 #include "../metric/modules/mapping.hpp"
 
@@ -21,8 +23,11 @@ namespace news_clustering {
 		std::vector<Language>& languages, 
 		std::unordered_map<Language, TextEmbedder>& text_embedders, 
 		//std::unordered_map<Language, Word2Vec>& word2vec_embedders, 
-		std::unordered_map<news_clustering::Language, std::locale>& locales
-	) : languages_(languages), locales_(locales), text_embedders_(text_embedders)
+		std::unordered_map<news_clustering::Language, std::locale>& locales, 
+		float weighted_eps, 
+		unsigned num_threads
+	) : languages_(languages), locales_(locales), text_embedders_(text_embedders), weighted_eps_(weighted_eps), 
+		num_threads_(std::max(num_threads, 1u))
 	{
 	}
 
@@ -41,97 +46,328 @@ namespace news_clustering {
 	  return idx;
 	}
 	
-	std::unordered_map<std::string, std::vector<std::string>> NewsClusterizer::clusterize(
-			std::unordered_map<std::string, news_clustering::Language>& file_names, 
-			std::unordered_map<std::string, std::vector<std::string>>& contents, 
-			std::unordered_map<std::string, std::string>& titles, 
+	Threads NewsClusterizer::clusterize(
+			Corpus& corpus, 
+			const DocIds& docs, 
 			float eps, std::size_t minpts
 		)
 	{
-		std::unordered_map<std::string, std::vector<std::string>> clustered_by_filename;
-		std::unordered_map<std::string, std::vector<std::string>> result;
-		
-		std::vector<std::string> content;
-		std::unordered_map<Language, std::vector<std::string>> indexed_file_names;
+		return clusterize(corpus, docs, eps, minpts, false, 0, 0, 0);
+	}
+	
+	Threads NewsClusterizer::clusterize(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			float eps, std::size_t minpts, 
+			float entity_weight, 
+			std::size_t max_posting_size, 
+			std::size_t min_thread_size
+		)
+	{
+		return clusterize(corpus, docs, eps, minpts, true, entity_weight, max_posting_size, min_thread_size);
+	}
+	
+	Threads NewsClusterizer::clusterize(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			float eps, std::size_t minpts, 
+			bool use_entities, 
+			float entity_weight, 
+			std::size_t max_posting_size, 
+			std::size_t min_thread_size
+		)
+	{
+		Threads result;
+
+		// articles of the each thread, threads are numbered in order of the first appearance
+		std::vector<DocIds> clustered;
+		std::unordered_map<DocId, std::size_t> thread_by_seed;
+
+		std::vector<Language> language_order;
+		std::unordered_map<Language, DocIds> docs_by_language;
+		std::string title;
+		std::vector<std::string> title_words;
 		std::vector<int> text_embedding;
-		std::unordered_map<Language, std::vector<std::vector<int>>> text_embeddings;
-		std::unordered_map<std::string, std::vector<int>> text_embeddings_by_filename;
-		std::unordered_map<std::string, std::vector<int>> text_embeddings_for_titles;
-		int seed;
-
-		std::vector<float>::iterator max_it;
-		
-		for (auto i = file_names.begin(); i != file_names.end(); i++) 
-		{			
-			content = contents[i->first];   
-			text_embedding = text_embedders_[i->second](content, locales_[i->second]);
-			
-			indexed_file_names[i->second].push_back(i->first);
-			text_embeddings[i->second].push_back(text_embedding);
-			text_embeddings_by_filename[i->first] = text_embedding;
+		DocId seed;
+
+		for (auto doc : docs) 
+		{
+			auto& language_docs = docs_by_language[corpus.languages[doc]];
+			if (language_docs.empty())
+			{
+				language_order.push_back(corpus.languages[doc]);
+			}
+			language_docs.push_back(doc);
 		}
 
-		
-		for (auto i = text_embeddings.begin(); i != text_embeddings.end(); i++) 
+		for (const auto& language : language_order) 
 		{
-			metric::Matrix<std::vector<int>, metric::Euclidian<float>> distance_matrix(i->second);
+			const auto& language_docs = docs_by_language[language];
 
-			auto[assignments, seeds, counts] = metric::dbscan(distance_matrix, eps, minpts);
+			// embeddings computed while categories detection are taken from the corpus
+			std::vector<std::vector<int>> text_embeddings;
+			text_embeddings.reserve(language_docs.size());
+			for (auto doc : language_docs)
+			{
+				text_embeddings.push_back(text_embedders_[language].embed(corpus, doc, locales_[language]));
+			}
 
+			std::vector<int> assignments;
+			std::vector<int> seeds;
+			std::vector<int> counts;
 
-			for (size_t k = 0; k < indexed_file_names[i->first].size(); k++)
+			if (text_embedders_[language].has_idf())
 			{
-				if (assignments[k] > 0)
+				std::vector<std::vector<float>> weighted_embeddings;
+				weighted_embeddings.reserve(text_embeddings.size());
+				for (const auto& embedding : text_embeddings)
 				{
-					seed = seeds[assignments[k] - 1];
-					clustered_by_filename[indexed_file_names[i->first][seed]].push_back(indexed_file_names[i->first][k]);
+					weighted_embeddings.push_back(text_embedders_[language].weighted(embedding));
 				}
-				else
+				std::tie(assignments, seeds, counts) = dbscan(corpus, language_docs, weighted_embeddings, weighted_eps_, minpts, use_entities, entity_weight, max_posting_size, min_thread_size);
+			}
+			else
+			{
+				std::tie(assignments, seeds, counts) = dbscan(corpus, language_docs, text_embeddings, eps, minpts, use_entities, entity_weight, max_posting_size, min_thread_size);
+			}
+
+			for (std::size_t k = 0; k < language_docs.size(); k++)
+			{
+				seed = assignments[k] > 0 ? language_docs[seeds[assignments[k] - 1]] : language_docs[k];
+
+				auto found = thread_by_seed.find(seed);
+				if (found == thread_by_seed.end())
 				{
-					clustered_by_filename[indexed_file_names[i->first][k]].push_back(indexed_file_names[i->first][k]);
+					found = thread_by_seed.insert({ seed, clustered.size() }).first;
+					result.seeds.push_back(seed);
+					clustered.emplace_back();
 				}
+				clustered[found->second].push_back(language_docs[k]);
 			}
 		}
 
-		// sorting by relevamce
-		//std::vector<std::vector<std::string>> title_from_cluster;
+		// sorting by relevance
 		std::vector<float> text_distances;
 		auto cosineDistance = metric::Cosine<float>();
-		for (auto k = clustered_by_filename.begin(); k != clustered_by_filename.end(); k++)
-		{			
-			// splitted title
-			content = content_parser.split_string(titles[k->first]);   
-			// title embedding
-			text_embedding = text_embedders_[file_names[k->first]](content, locales_[file_names[k->first]]);
-				
-			//title_from_cluster.clear();
-			if (k->second.size() > 1)
+		for (std::size_t k = 0; k < clustered.size(); k++)
+		{
+			seed = result.seeds[k];
+
+			if (clustered[k].size() > 1)
 			{
+				// splitted title, split_string changes the line so the copy is passed
+				title = std::string(corpus.title(seed));
+				title_words = content_parser.split_string(title);
+				// title embedding
+				auto language = corpus.languages[seed];
+				auto& text_embedder = text_embedders_[language];
+				text_embedding = text_embedder(title_words, locales_[language]);
+
 				text_distances.clear();
-				for (auto j = 0; j < k->second.size(); j++)
+				if (text_embedder.has_idf())
 				{
-					//title_from_cluster.push_back(content_parser.split_string(titles[k->second[j]]));
-					text_distances.push_back(cosineDistance(text_embedding, text_embeddings_by_filename[k->second[j]]));
+					// weighted embeddings are normalized, so cosine is the dot product
+					auto title_embedding = text_embedder.weighted(text_embedding);
+					for (auto doc : clustered[k])
+					{
+						auto doc_embedding = text_embedder.weighted(text_embedder.embed(corpus, doc, locales_[language]));
+						text_distances.push_back(std::inner_product(title_embedding.begin(), title_embedding.end(), doc_embedding.begin(), 0.0f));
+					}
+				}
+				else
+				{
+					for (auto doc : clustered[k])
+					{
+						text_distances.push_back(cosineDistance(text_embedding, text_embedder.embed(corpus, doc, locales_[language])));
+					}
 				}
 
-				//text_distances = word2vec_embedders_[file_names[k->first]].texts_distance(content, title_from_cluster, locales_[file_names[k->first]]);
-
-				auto sorted_indexes = sort_indexes(text_distances);
-				for (auto j : sorted_indexes)
+				for (auto j : sort_indexes(text_distances))
 				{
-					//std::cout << "    " << text_distances[j] << ": " << titles[k->second[j]] << " " << k->second[j] << std::endl;
-					result[k->first].push_back(k->second[j]);
+					result.articles.push_back(clustered[k][j]);
 				}
 			}
 			else
 			{
-				result[k->first].push_back(k->second[0]);
+				result.articles.push_back(clustered[k][0]);
+			}
+			result.offsets.push_back(result.articles.size());
+
+			for (auto doc : clustered[k])
+			{
+				corpus.threads[doc] = k;
 			}
 		}
-		
 
 		return result;
 	}
 
+	template <typename T>
+	std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> NewsClusterizer::dbscan(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			const std::vector<std::vector<T>>& embeddings, 
+			float eps, std::size_t minpts, 
+			bool use_entities, 
+			float entity_weight, 
+			std::size_t max_posting_size, 
+			std::size_t min_thread_size
+		)
+	{
+		static auto& distances_computed = Profiler::global().counter("distances_computed");
+		static auto& region_queries = Profiler::global().counter("dbscan_region_queries");
+
+		if (!use_entities)
+		{
+			// all pairs are computed and region of the each point is queried once
+			auto n = embeddings.size();
+			Profiler::global().add(region_queries, n);
+
+			if (min_thread_size > 0)
+			{
+				// core distances take the whole rows, Prim computes every pair once more
+				Profiler::global().add(distances_computed, n * (n - 1) + n * (n - 1) / 2);
+				return metric::HDBSCAN<float>(embeddings, metric::Euclidian<float>(), minpts, num_threads_).extract_stable(min_thread_size);
+			}
+
+			// pairs are computed by several threads and no matrix is stored
+			Profiler::global().add(distances_computed, n * (n - 1) / 2);
+			return metric::parallel_dbscan(embeddings, metric::Euclidian<float>(), eps, minpts, num_threads_);
+		}
+
+		EntityIndex entity_index;
+		for (auto doc : docs)
+		{
+			auto entities = corpus.entities(doc);
+			entity_index.add(std::vector<EntityId>(entities.begin(), entities.end()));
+		}
+
+		return entity_dbscan(embeddings, entity_index, eps, minpts, entity_weight, max_posting_size, min_thread_size);
+	}
+
+	template <typename T>
+	std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> NewsClusterizer::entity_dbscan(
+			const std::vector<std::vector<T>>& embeddings, 
+			const EntityIndex& entity_index, 
+			float eps, std::size_t minpts, 
+			float entity_weight, 
+			std::size_t max_posting_size, 
+			std::size_t min_thread_size
+		)
+	{
+		static auto& distances_computed = Profiler::global().counter("distances_computed");
+		static auto& region_queries = Profiler::global().counter("dbscan_region_queries");
+
+		auto n = embeddings.size();
+		auto candidate_pairs = entity_index.candidate_pairs(max_posting_size);
+
+		// articles without any candidate (no entities, only the entities over max_posting_size or only their own)
+		// cannot be found through the index, so they are compared with all the articles. Recall trade-off: the
+		// articles with candidates are compared only with them, two such articles that share only the too common
+		// entities are never compared
+		std::vector<char> has_candidates(n, false);
+		for (const auto& pair : candidate_pairs)
+		{
+			has_candidates[pair.first] = true;
+			has_candidates[pair.second] = true;
+		}
+		std::vector<std::size_t> without_candidates;
+		for (std::size_t k = 0; k < n; k++)
+		{
+			if (!has_candidates[k])
+			{
+				without_candidates.push_back(k);
+			}
+		}
+
+		// pairs and rows go to the workers of metric::parallel_for by small chunks, so the short rows at the end of
+		// the triangle don't leave the workers idle; the density hierarchy needs all the pairs, dbscan the close ones
+		bool hierarchy = min_thread_size > 0;
+		auto euclidianDistance = metric::Euclidian<float>();
+		auto distance = [&](std::size_t a, std::size_t b)
+		{
+			return euclidianDistance(embeddings[a], embeddings[b]) * (1 - entity_weight * entity_index.overlap(a, b));
+		};
+
+		std::vector<float> pair_distances(candidate_pairs.size());
+		metric::dbscan_details::parallel_for(candidate_pairs.size(), num_threads_, [&](std::size_t i)
+		{
+			pair_distances[i] = distance(candidate_pairs[i].first, candidate_pairs[i].second);
+		});
+
+		// for dbscan pair of two articles without candidates is computed in the row of the first one; the hierarchy
+		// computes the whole row and keeps its nearest, so core distances of these articles are exact
+		std::size_t max_neighbours = std::max(minpts, HIERARCHY_NEIGHBOURS);
+		std::vector<std::vector<metric::HDBSCAN<float>::Edge>> row_pairs(without_candidates.size());
+		metric::dbscan_details::parallel_for(without_candidates.size(), num_threads_, [&](std::size_t r)
+		{
+			auto a = without_candidates[r];
+			std::vector<metric::HDBSCAN<float>::Edge> row;
+			for (std::size_t b = 0; b < n; b++)
+			{
+				if (b == a || (!hierarchy && !has_candidates[b] && b < a))
+				{
+					continue;
+				}
+				float d = distance(a, b);
+				if (hierarchy || d < eps)
+				{
+					row.push_back({ (int)std::min(a, b), (int)std::max(a, b), d });
+				}
+			}
+			if (hierarchy && row.size() > max_neighbours)
+			{
+				auto by_distance = [](const metric::HDBSCAN<float>::Edge& x, const metric::HDBSCAN<float>::Edge& y) { return x.distance < y.distance; };
+				std::nth_element(row.begin(), row.begin() + max_neighbours - 1, row.end(), by_distance);
+				row.resize(max_neighbours);
+			}
+			row_pairs[r].assign(row.begin(), row.end());
+		});
+
+		std::vector<metric::HDBSCAN<float>::Edge> close_pairs;
+		for (std::size_t i = 0; i < candidate_pairs.size(); i++)
+		{
+			if (hierarchy || pair_distances[i] < eps)
+			{
+				close_pairs.push_back({ (int)candidate_pairs[i].first, (int)candidate_pairs[i].second, pair_distances[i] });
+			}
+		}
+		for (const auto& row : row_pairs)
+		{
+			close_pairs.insert(close_pairs.end(), row.begin(), row.end());
+		}
+
+		// neighbourhood of the each article is queried once
+		auto m = without_candidates.size();
+		Profiler::global().add(distances_computed, candidate_pairs.size() + (hierarchy ? m * (n - 1) : m * (n - m) + m * (m - 1) / 2));
+		Profiler::global().add(region_queries, n);
+
+		if (hierarchy)
+		{
+			// two articles without candidates can keep each other as the nearest, the pair is given once
+			auto by_articles = [](const metric::HDBSCAN<float>::Edge& x, const metric::HDBSCAN<float>::Edge& y) { return std::tie(x.a, x.b) < std::tie(y.a, y.b); };
+			auto same_articles = [](const metric::HDBSCAN<float>::Edge& x, const metric::HDBSCAN<float>::Edge& y) { return x.a == y.a && x.b == y.b; };
+			std::sort(close_pairs.begin(), close_pairs.end(), by_articles);
+			close_pairs.erase(std::unique(close_pairs.begin(), close_pairs.end(), same_articles), close_pairs.end());
+
+			// threads are the most stable clusters of the density hierarchy, eps isn't used
+			return metric::HDBSCAN<float>(n, close_pairs, minpts).extract_stable(min_thread_size);
+		}
+
+		// every point is neighbour to itself, as in the distance matrix
+		std::vector<std::vector<int>> neighbours(n);
+		for (std::size_t k = 0; k < n; k++)
+		{
+			neighbours[k].push_back(k);
+		}
+		for (const auto& pair : close_pairs)
+		{
+			neighbours[pair.a].push_back(pair.b);
+			neighbours[pair.b].push_back(pair.a);
+		}
+
+		return metric::parallel_dbscan(neighbours, minpts, num_threads_);
+	}
+
 }  // namespace news_clustering
 #endif
@@ -8,9 +8,14 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #ifndef _NEWS_CLUSTERING_NEWS_CLUSTERIZER_HPP
 #define _NEWS_CLUSTERING_NEWS_CLUSTERIZER_HPP
 
+#include <thread>
 #include "languages.hpp"
 #include "content_parser.hpp"
 #include "modules/text_embedding.hpp"
+#include "modules/name_entities_recognizer.hpp"
+#include "modules/entity_index.hpp"
+#include "modules/corpus.hpp"
+#include "modules/profiler.hpp"
 
 namespace news_clustering {
 
@@ -22,25 +27,52 @@ namespace news_clustering {
 	class NewsClusterizer {
 		
 	public:
+
+		// normalized embeddings are at most 2 apart, so eps of the histograms doesn't fit them
+		static constexpr float DEFAULT_WEIGHTED_EPS = 0.8;
+
+		// articles compared with all the others keep only so many nearest of them (at least minpts) for the density
+		// hierarchy, so its pairs take O(n) memory instead of O(n^2)
+		static constexpr std::size_t HIERARCHY_NEIGHBOURS = 16;
+
+		// entities mentioned in more articles give no candidate pairs, each of them gives up to 20k pairs
+		static constexpr std::size_t DEFAULT_MAX_POSTING_SIZE = 200;
 		
 		NewsClusterizer(
 			std::vector<Language>& languages, 
 			std::unordered_map<Language, TextEmbedder>& text_embedders, 
 			//std::unordered_map<Language, Word2Vec>& word2vec_embedders, 
-			std::unordered_map<news_clustering::Language, std::locale>& locales
+			std::unordered_map<news_clustering::Language, std::locale>& locales, 
+			float weighted_eps = DEFAULT_WEIGHTED_EPS, 
+			unsigned num_threads = std::thread::hardware_concurrency()
 		);
 
 		/**
-		 * @brief 
-		 * @return 
+		 * @brief thread of the each article is stored to the corpus too
+		 * @return threads, articles of the thread are sorted by relevance to the seed title
 		 */
-		std::unordered_map<std::string, std::vector<std::string>> clusterize(
-			std::unordered_map<std::string, news_clustering::Language>& file_names, 
-			std::unordered_map<std::string, std::vector<std::string>>& contents, 
-			std::unordered_map<std::string, std::string>& titles, 
+		Threads clusterize(
+			Corpus& corpus, 
+			const DocIds& docs, 
 			float eps, std::size_t minpts
 		);
 
+		/**
+		 * @brief same as above, but candidate pairs are taken from the entity inverted index instead of all pairs 
+		 * and distance between articles with common entities is reduced: d * (1 - entity_weight * jaccard(entities)). 
+		 * If min_thread_size is set, threads are the most stable clusters of the HDBSCAN density hierarchy 
+		 * instead of DBSCAN with the fixed eps
+		 * @return 
+		 */
+		Threads clusterize(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			float eps, std::size_t minpts, 
+			float entity_weight, 
+			std::size_t max_posting_size = DEFAULT_MAX_POSTING_SIZE, 
+			std::size_t min_thread_size = 0
+		);
+
 	private:
 
 		ContentParser content_parser = news_clustering::ContentParser();
@@ -48,10 +80,50 @@ namespace news_clustering {
 		std::unordered_map<news_clustering::Language, std::locale>& locales_;
 		std::unordered_map<news_clustering::Language, TextEmbedder>& text_embedders_;
 		//std::unordered_map<news_clustering::Language, Word2Vec>& word2vec_embedders_;
+		// eps for the languages with the IDF table, their histograms are weighted and normalized
+		float weighted_eps_;
+		// workers of the distances and of the dbscan
+		unsigned num_threads_;
 
 		
 		template <typename T>
 		std::vector<size_t> sort_indexes(const std::vector<T> &v);
+
+		Threads clusterize(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			float eps, std::size_t minpts, 
+			bool use_entities, 
+			float entity_weight, 
+			std::size_t max_posting_size, 
+			std::size_t min_thread_size
+		);
+
+		/**
+		 * @brief dbscan of the articles of one language, over all pairs or over the entity index candidates
+		 * @return assignments, seeds and counts as metric::dbscan
+		 */
+		template <typename T>
+		std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> dbscan(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			const std::vector<std::vector<T>>& embeddings, 
+			float eps, std::size_t minpts, 
+			bool use_entities, 
+			float entity_weight, 
+			std::size_t max_posting_size, 
+			std::size_t min_thread_size
+		);
+
+		template <typename T>
+		std::tuple<std::vector<int>, std::vector<int>, std::vector<int>> entity_dbscan(
+			const std::vector<std::vector<T>>& embeddings, 
+			const EntityIndex& entity_index, 
+			float eps, std::size_t minpts, 
+			float entity_weight, 
+			std::size_t max_posting_size, 
+			std::size_t min_thread_size
+		);
 	};
 
 }  // namespace news_clustering
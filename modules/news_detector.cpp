@@ -20,32 +20,25 @@ namespace news_clustering {
 			std::vector<Language>& languages, 
 			std::unordered_map<news_clustering::Language, std::locale>& locales, 
 			std::vector<int>& today
-	) : languages_(languages), locales_(locales), today_(today)
+	) : languages_(languages), locales_(locales), today_(today), today_days_(to_epoch_days(today[0], today[1], today[2]))
 	{
 	}
 
 	
-	std::unordered_map<bool, std::vector<std::string>> NewsDetector::detect_news(
-		std::unordered_map<std::string, news_clustering::Language>& file_names, 
-		std::unordered_map<std::string, std::vector<std::string>>& contents, 
-		std::unordered_map<std::string, std::vector<std::vector<int>>>& dates, 
-		std::unordered_map<std::string, std::vector<std::string>>& name_entities, 
-		int freshness_days
+	std::unordered_map<bool, DocIds> NewsDetector::detect_news(
+		Corpus& corpus, 
+		const DocIds& docs, 
+		int freshness_days, 
+		std::size_t min_name_entities
 	)
 	{
-		std::unordered_map<bool, std::vector<std::string>> result;
+		std::unordered_map<bool, DocIds> result;
 
-		std::vector<std::string> content;
-		std::vector<std::vector<int>> file_dates;
-		std::vector<std::vector<double>> file_dates_for_entropy;
-		
 		float date_distance;
+		std::size_t num_name_entities;
 		
-		for (auto i = file_names.begin(); i != file_names.end(); i++) 
+		for (auto doc : docs) 
 		{ 		
-			content = contents[i->first]; 
-			file_dates = dates[i->first]; 
-			
 			//for (auto date : file_dates)
 			//{
 			//	file_dates_for_entropy.push_back({(double) date[0] + date[1] * 30.0 + date[2] * 365.0});
@@ -55,23 +48,13 @@ namespace news_clustering {
 			//std::cout << "entropy: " << e << std::endl;
 			
 
-			date_distance = 0;
-			for (auto date : file_dates)
-			{
-				// if year == 0 then it means current year
-				if (date[2] > 0)
-				{
-					date_distance += abs(today_[0] - date[0]) + abs(today_[1] - date[1]) * 30 + abs(today_[2] - date[2]) * 365;
-				}
-				else
-				{
-					date_distance += abs(today_[0] - date[0]) + abs(today_[1] - date[1]) * 30;
-				}
-			}
-			
-			date_distance /= file_dates.size();
+			// mean distance is computed once for all articles, -1 means that there are no dates
+			date_distance = corpus.dates.freshness(doc, today_days_);
+
+			// news should answer not only "When?" but "What? Where?" too
+			num_name_entities = corpus.entities(doc).size();
 
-			result[file_dates.size() > 0 && date_distance < freshness_days].push_back(i->first);
+			result[date_distance >= 0 && date_distance < freshness_days && num_name_entities >= min_name_entities].push_back(doc);
 		}
 
 		return result;
@@ -10,6 +10,9 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 
 #include "languages.hpp"
 #include "content_parser.hpp"
+#include "dates_store.hpp"
+#include "corpus.hpp"
+#include "name_entities_recognizer.hpp"
 
 namespace news_clustering {
 
@@ -29,15 +32,14 @@ namespace news_clustering {
 		);
 
 		/**
-		 * @brief 
+		 * @brief uses dates and name entities already found for the corpus
 		 * @return 
 		 */
-		std::unordered_map<bool, std::vector<std::string>> detect_news(
-			std::unordered_map<std::string, news_clustering::Language>& file_names, 
-			std::unordered_map<std::string, std::vector<std::string>>& contents, 
-			std::unordered_map<std::string, std::vector<std::vector<int>>>& dates, 
-			std::unordered_map<std::string, std::vector<std::string>>& name_entities, 
-			int freshness_days
+		std::unordered_map<bool, DocIds> detect_news(
+			Corpus& corpus, 
+			const DocIds& docs, 
+			int freshness_days, 
+			std::size_t min_name_entities = 0
 		);
 
 	private:
@@ -47,6 +49,7 @@ namespace news_clustering {
 		std::unordered_map<news_clustering::Language, std::locale>& locales_;
 
 		std::vector<int>& today_;
+		std::int32_t today_days_;
 	};
 
 }  // namespace news_clustering
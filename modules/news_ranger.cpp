@@ -8,6 +8,8 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #ifndef _NEWS_CLUSTERING_NEWS_RANGER_CPP
 #define _NEWS_CLUSTERING_NEWS_RANGER_CPP
 
+#include <algorithm>
+#include <numeric>
 #include "news_ranger.hpp"
 
 
@@ -18,100 +20,89 @@ namespace news_clustering {
 		std::vector<Language>& languages, 
 		std::unordered_map<Language, TextEmbedder>& embedders, 
 		std::unordered_map<news_clustering::Language, std::locale>& locales, 
-		std::vector<int>& today
-	) : languages_(languages), locales_(locales), text_embedders_(embedders), today_(today)
+		std::vector<int>& today, 
+		const RankingModel& model
+	) : languages_(languages), locales_(locales), text_embedders_(embedders), today_(today), today_days_(to_epoch_days(today[0], today[1], today[2])), model_(model)
 	{
 	}
 
 
-	template <typename T>
-	std::vector<size_t> NewsRanger::sort_indexes(const std::vector<T> &v) {
-
-	  // initialize original index locations
-	  std::vector<size_t> idx(v.size());
-	  std::iota(idx.begin(), idx.end(), 0);
+	RankedThreads NewsRanger::arrange_top_k(Corpus& corpus, const Threads& threads, std::size_t k, bool per_category)
+	{
+		RankedThreads result;
+		result.categories = thread_categories(corpus, threads);
 
-	  // sort indexes based on comparing values in v
-	  sort(idx.begin(), idx.end(),
-		   [&v](size_t i1, size_t i2) {return v[i1] > v[i2];});
+		auto scores = model_.score(corpus, threads, result.categories, today_days_);
+		// ties are broken by thread index, so the result doesn't depend on the selection order
+		auto is_better = [&scores](std::size_t a, std::size_t b)
+		{
+			return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+		};
 
-	  return idx;
-	}
+		// overall top: only k first threads are sorted
+		result.order.resize(threads.size());
+		std::iota(result.order.begin(), result.order.end(), 0);
+		if (k < result.order.size())
+		{
+			std::nth_element(result.order.begin(), result.order.begin() + k, result.order.end(), is_better);
+			result.order.resize(k);
+		}
+		std::sort(result.order.begin(), result.order.end(), is_better);
 
-	
-	 std::vector<std::unordered_map<std::string, std::vector<std::string>>> NewsRanger::arrange(
-		std::unordered_map<std::string, std::vector<std::string>>& clustered_articles, 
-		std::unordered_map<std::string, std::vector<std::vector<int>>>& dates, 
-		std::unordered_map<std::string, std::vector<std::string>>& name_entities
-	)
-	{
-		std::vector<NewsThread> result;
-		
-		std::vector<std::string> content;
-		std::vector<std::string> indexed_file_names;
-		std::vector<float> threads_all_points;
-		std::vector<float> threads_freq_points;
-		std::vector<float> threads_fresh_points;
-		NewsThread single_thread;
-		
-		std::vector<std::vector<int>> days;
-		float date_distance;
-
-		std::vector<float>::iterator max_it;
-		float max_value;
-
-		
-		for (auto i = clustered_articles.begin(); i != clustered_articles.end(); i++) 
+		if (!per_category)
 		{
-			indexed_file_names.push_back(i->first);   
-			threads_freq_points.push_back(i->second.size());
+			return result;
+		}
 
-			date_distance = 0;
-			days = dates[i->first];
-			for (auto day : days)
+		// bounded heap for the each category, worst of the kept threads is on the top of the heap
+		int max_category = OTHER_CATEGORY;
+		for (auto category : result.categories)
+		{
+			max_category = std::max(max_category, category);
+		}
+		std::vector<std::vector<std::size_t>> heaps(max_category + 2);
+		for (std::size_t t = 0; t < threads.size(); t++)
+		{
+			auto& heap = heaps[result.categories[t] + 1];
+			if (heap.size() < k)
 			{
-				// if year == 0 then it means current year
-				if (day[2] > 0)
-				{
-					date_distance += abs(today_[0] - day[0]) + abs(today_[1] - day[1]) * 30 + abs(today_[2] - day[2]) * 365;
-				}
-				else
-				{
-					date_distance += abs(today_[0] - day[0]) + abs(today_[1] - day[1]) * 30;
-				}
+				heap.push_back(t);
+				std::push_heap(heap.begin(), heap.end(), is_better);
+			}
+			else if (k > 0 && is_better(t, heap.front()))
+			{
+				std::pop_heap(heap.begin(), heap.end(), is_better);
+				heap.back() = t;
+				std::push_heap(heap.begin(), heap.end(), is_better);
 			}
-			
-			//std::cout << i->first << " " << date_distance << " " << (date_distance /= days.size()) << std::endl;
-			date_distance /= days.size();
-			threads_fresh_points.push_back(date_distance);
 		}
 
-		threads_all_points = std::vector<float>(threads_freq_points.size(), 0);
-
-		max_it = std::max_element(threads_freq_points.begin(), threads_freq_points.end());
-		max_value = threads_freq_points[std::distance(threads_freq_points.begin(), max_it)];
-		for (auto i = 0; i < threads_freq_points.size(); i++)
+		// known categories go first, other is the last
+		for (int category = 0; category <= max_category + 1; category++)
 		{
-			threads_freq_points[i] = threads_freq_points[i] / max_value;
-			threads_all_points[i] += threads_freq_points[i];
+			auto& heap = heaps[category <= max_category ? category + 1 : 0];
+			if (heap.empty())
+			{
+				continue;
+			}
+			std::sort_heap(heap.begin(), heap.end(), is_better);
+			result.grouped.insert(result.grouped.end(), heap.begin(), heap.end());
+			result.group_categories.push_back(category <= max_category ? category : OTHER_CATEGORY);
+			result.group_offsets.push_back(result.grouped.size());
 		}
 
-		max_it = std::max_element(threads_fresh_points.begin(), threads_fresh_points.end());
-		max_value = threads_fresh_points[std::distance(threads_fresh_points.begin(), max_it)];
-		for (auto i = 0; i < threads_fresh_points.size(); i++)
-		{
-			// more date diff means less points
-			threads_fresh_points[i] = 1 - threads_fresh_points[i] / max_value;
-			threads_all_points[i] += threads_fresh_points[i];
-		}
+		return result;
+	}
 
-		auto sorted_indexes = sort_indexes(threads_all_points);
-		for (auto j : sorted_indexes)
+
+	std::vector<int> NewsRanger::thread_categories(Corpus& corpus, const Threads& threads)
+	{
+		std::vector<int> result(threads.size());
+		for (std::size_t k = 0; k < threads.size(); k++)
 		{
-			single_thread.clear();
-			single_thread[indexed_file_names[j]] = clustered_articles[indexed_file_names[j]];
-			result.push_back(single_thread);
-			//std::cout << indexed_file_names[j] << " " << threads_all_points[j] << " " << threads_freq_points[j] << " " << threads_fresh_points[j] << std::endl;
+			auto category = corpus.categories[threads.seeds[k]];
+			// articles that weren't categorized go to the other
+			result[k] = category >= 0 ? category : OTHER_CATEGORY;
 		}
 
 		return result;
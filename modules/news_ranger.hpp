@@ -10,10 +10,44 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 
 #include "languages.hpp"
 #include "content_parser.hpp"
+#include "dates_store.hpp"
+#include "name_entities_recognizer.hpp"
 #include "modules/text_embedding.hpp"
+#include "modules/corpus.hpp"
+#include "modules/ranking_model.hpp"
 
 namespace news_clustering {
 
+	/**
+	 * @class RankedThreads
+	 * 
+	 * @brief Ranking result over thread indexes: threads are never copied, groups by category are index ranges 
+	 * into one array, order inside a group is the rank order
+	 */
+	struct RankedThreads
+	{
+		// thread indexes, the most important goes first
+		std::vector<std::size_t> order;
+		// category of the each thread, by thread index
+		std::vector<int> categories;
+
+		std::vector<int> group_categories;
+		std::vector<std::size_t> group_offsets = { 0 };
+		std::vector<std::size_t> grouped;
+
+		/**
+		 * @brief 
+		 * @return number of not empty categories
+		 */
+		std::size_t num_groups() const { return group_categories.size(); };
+
+		/**
+		 * @brief 
+		 * @return ranked threads of the k-th category
+		 */
+		Span<std::size_t> group(std::size_t k) const { return Span<std::size_t>(grouped.data() + group_offsets[k], group_offsets[k + 1] - group_offsets[k]); };
+	};
+
 	/**
 	 * @class NewsRanger
 	 * 
@@ -23,24 +57,20 @@ namespace news_clustering {
 		
 	public:
 
-		using NewsThread = std::unordered_map<std::string, std::vector<std::string>>;
-		
 		NewsRanger(
 			std::vector<Language>& languages, 
 			std::unordered_map<Language, TextEmbedder>& embedders, 
 			std::unordered_map<news_clustering::Language, std::locale>& locales, 
-			std::vector<int>& today
+			std::vector<int>& today, 
+			const RankingModel& model = RankingModel()
 		);
 
 		/**
-		 * @brief 
+		 * @brief only k best threads overall and k best threads of the each category (if per_category) are selected and sorted, 
+		 * the rest of the threads is never ordered. Category of the thread is the category of its seed
 		 * @return 
 		 */
-		std::vector<std::unordered_map<std::string, std::vector<std::string>>> arrange(
-			std::unordered_map<std::string, std::vector<std::string>>& clustered_articles, 
-			std::unordered_map<std::string, std::vector<std::vector<int>>>& dates, 
-			std::unordered_map<std::string, std::vector<std::string>>& name_entities
-		);
+		RankedThreads arrange_top_k(Corpus& corpus, const Threads& threads, std::size_t k, bool per_category = true);
 
 	private:
 
@@ -50,9 +80,11 @@ namespace news_clustering {
 		std::unordered_map<news_clustering::Language, TextEmbedder>& text_embedders_;
 		
 		std::vector<int>& today_;
+		std::int32_t today_days_;
+
+		RankingModel model_;
 		
-		template <typename T>
-		std::vector<size_t> sort_indexes(const std::vector<T> &v);
+		std::vector<int> thread_categories(Corpus& corpus, const Threads& threads);
 	};
 
 }  // namespace news_clustering
@@ -0,0 +1,268 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_PROFILER_CPP
+#define _NEWS_CLUSTERING_PROFILER_CPP
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <thread>
+#if defined(_WIN64)
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+#include "profiler.hpp"
+#include "json_writer.hpp"
+
+
+namespace news_clustering {
+
+	Profiler::Scope::Scope(const char* name, Profiler& profiler) : name_(name), profiler_(profiler), running_(profiler.enabled())
+	{
+		if (running_)
+		{
+			start_ = std::chrono::steady_clock::now();
+		}
+	}
+
+
+	Profiler::Scope::~Scope()
+	{
+		stop();
+	}
+
+
+	void Profiler::Scope::stop()
+	{
+		if (running_)
+		{
+			profiler_.record(name_, start_, std::chrono::steady_clock::now());
+			running_ = false;
+		}
+	}
+
+	//
+
+	Profiler::Profiler() : enabled_(false), start_(std::chrono::steady_clock::now())
+	{
+	}
+
+
+	Profiler& Profiler::global()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+
+	void Profiler::enable(bool enabled)
+	{
+		enabled_.store(enabled, std::memory_order_relaxed);
+	}
+
+
+	bool Profiler::enabled() const
+	{
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+
+	Profiler::Counter& Profiler::counter(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto found = std::find(counter_names_.begin(), counter_names_.end(), name);
+		if (found != counter_names_.end())
+		{
+			return counters_[found - counter_names_.begin()];
+		}
+
+		counter_names_.push_back(name);
+		counters_.emplace_back(0);
+
+		return counters_.back();
+	}
+
+
+	void Profiler::add(Counter& counter, std::uint64_t value)
+	{
+		if (enabled())
+		{
+			counter.fetch_add(value, std::memory_order_relaxed);
+		}
+	}
+
+
+	void Profiler::write_report(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		// stages are aggregated by name, in order of the first start
+		std::vector<const char*> stage_names;
+		std::map<std::string, std::pair<std::int64_t, std::int64_t>> stages;
+		auto sorted_events = events_;
+		std::sort(sorted_events.begin(), sorted_events.end(), [](const Event& a, const Event& b) { return a.start_us < b.start_us; });
+		for (const auto& event : sorted_events)
+		{
+			auto& stage = stages[event.name];
+			if (stage.second == 0)
+			{
+				stage_names.push_back(event.name);
+			}
+			stage.first += event.duration_us;
+			stage.second++;
+		}
+
+		auto fd = open_output(path);
+		if (fd < 0)
+		{
+			return;
+		}
+		{
+			JsonWriter writer(fd);
+			writer.begin_object();
+
+			writer.key("counters");
+			writer.begin_object();
+			for (std::size_t i = 0; i < counters_.size(); i++)
+			{
+				writer.key(counter_names_[i]);
+				writer.value((std::int64_t) counters_[i].load());
+			}
+			writer.end_object();
+
+			writer.key("stages");
+			writer.begin_array();
+			for (auto name : stage_names)
+			{
+				writer.begin_object();
+				writer.key("calls");
+				writer.value(stages[name].second);
+				writer.key("name");
+				writer.value(name);
+				writer.key("total_us");
+				writer.value(stages[name].first);
+				writer.end_object();
+			}
+			writer.end_array();
+
+			writer.key("total_us");
+			writer.value((std::int64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count());
+
+			writer.end_object();
+		}
+		close_output(fd);
+	}
+
+
+	void Profiler::write_chrome_trace(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto fd = open_output(path);
+		if (fd < 0)
+		{
+			return;
+		}
+		{
+			JsonWriter writer(fd, false);
+			writer.begin_object();
+			writer.key("traceEvents");
+			writer.begin_array();
+			for (const auto& event : events_)
+			{
+				writer.begin_object();
+				writer.key("dur");
+				writer.value(event.duration_us);
+				writer.key("name");
+				writer.value(event.name);
+				writer.key("ph");
+				writer.value("X");
+				writer.key("pid");
+				writer.value((std::int64_t) 1);
+				writer.key("tid");
+				writer.value((std::int64_t) event.thread);
+				writer.key("ts");
+				writer.value(event.start_us);
+				writer.end_object();
+			}
+			writer.end_array();
+			writer.end_object();
+		}
+		close_output(fd);
+	}
+
+
+	void Profiler::reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		events_.clear();
+		events_.shrink_to_fit();
+		for (auto& counter : counters_)
+		{
+			counter.store(0);
+		}
+	}
+
+
+	void Profiler::record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		static std::atomic<std::uint32_t> num_threads(0);
+		thread_local std::uint32_t thread = num_threads++;
+
+		Event event = {
+			name,
+			std::chrono::duration_cast<std::chrono::microseconds>(start - start_).count(),
+			std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+			thread
+		};
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		events_.push_back(event);
+	}
+
+
+	int Profiler::open_output(const std::string& path)
+	{
+		if (path.empty())
+		{
+			return 2;
+		}
+
+		#if defined(_WIN64)
+			int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+		#else
+			int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		#endif
+		if (fd < 0)
+		{
+			std::cerr << "Cannot open file: " << path << std::endl;
+		}
+
+		return fd;
+	}
+
+
+	void Profiler::close_output(int fd)
+	{
+		if (fd != 2)
+		{
+			#if defined(_WIN64)
+				_close(fd);
+			#else
+				::close(fd);
+			#endif
+		}
+	}
+
+}  // namespace news_clustering
+#endif
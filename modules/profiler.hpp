@@ -0,0 +1,143 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_PROFILER_HPP
+#define _NEWS_CLUSTERING_PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace news_clustering {
+
+	/**
+	 * @class Profiler
+	 *
+	 * @brief Stage timers and counters of the run. When profiler is disabled scopes don't read the clock and counters
+	 * are not touched, so the only cost is the check of the flag.
+	 */
+	class Profiler {
+
+	public:
+
+		using Counter = std::atomic<std::uint64_t>;
+
+		/**
+		 * @class Scope
+		 *
+		 * @brief Measures time from construction to stop() or destruction
+		 */
+		class Scope {
+
+		public:
+
+			explicit Scope(const char* name, Profiler& profiler = Profiler::global());
+
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+			/**
+			 * @brief finish measuring before the end of the scope
+			 * @return
+			 */
+			void stop();
+
+		private:
+
+			const char* name_;
+			Profiler& profiler_;
+			bool running_;
+			std::chrono::steady_clock::time_point start_;
+		};
+
+		Profiler();
+
+		/**
+		 * @brief profiler of the whole process
+		 * @return
+		 */
+		static Profiler& global();
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		void enable(bool enabled = true);
+
+		/**
+		 * @brief
+		 * @return
+		 */
+		bool enabled() const;
+
+		/**
+		 * @brief counter with the name, reference stays valid for the profiler lifetime, so it can be kept in static variable
+		 * @return
+		 */
+		Counter& counter(const std::string& name);
+
+		/**
+		 * @brief add value to the counter if profiler is enabled
+		 * @return
+		 */
+		void add(Counter& counter, std::uint64_t value);
+
+		/**
+		 * @brief report with total time and number of calls for the each stage and all the counters, json to the file or stderr if path is empty
+		 * @return
+		 */
+		void write_report(const std::string& path = "");
+
+		/**
+		 * @brief all measured scopes as chrome://tracing events
+		 * @return
+		 */
+		void write_chrome_trace(const std::string& path);
+
+		/**
+		 * @brief drop the measured scopes and zero the counters, so a long running process reports every run
+		 * on its own and events don't pile up; counter references stay valid
+		 * @return
+		 */
+		void reset();
+
+	private:
+
+		struct Event
+		{
+			const char* name;
+			std::int64_t start_us;
+			std::int64_t duration_us;
+			std::uint32_t thread;
+		};
+
+		std::atomic<bool> enabled_;
+		std::chrono::steady_clock::time_point start_;
+
+		std::mutex mutex_;
+		std::vector<Event> events_;
+		std::deque<std::string> counter_names_;
+		std::deque<Counter> counters_;
+
+		void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+		int open_output(const std::string& path);
+
+		void close_output(int fd);
+	};
+
+}  // namespace news_clustering
+
+#include "profiler.cpp"
+
+#endif  // Header Guard
@@ -0,0 +1,108 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_RANKING_MODEL_CPP
+#define _NEWS_CLUSTERING_RANKING_MODEL_CPP
+
+#include <algorithm>
+#include <cmath>
+#include "ranking_model.hpp"
+
+
+namespace news_clustering {
+
+	RankingModel::RankingModel(const Features& weights, float half_life_days, const std::vector<float>& category_priors, float other_prior) :
+		weights_(weights), half_life_days_(half_life_days), category_priors_(category_priors), other_prior_(other_prior)
+	{
+	}
+
+
+	RankingModel::Features RankingModel::features(Corpus& corpus, const Threads& threads, std::size_t k, int category, std::int32_t today_days)
+	{
+		Features result;
+		auto thread = threads.thread(k);
+
+		result[SIZE_FEATURE] = std::log1p((float) thread.size());
+
+		sources_.clear();
+		entities_.clear();
+		for (auto article : thread)
+		{
+			if (corpus.sources[article] != NO_SOURCE)
+			{
+				sources_.push_back(corpus.sources[article]);
+			}
+
+			// entity is counted once per article
+			auto entities = corpus.entities(article);
+			auto article_begin = entities_.size();
+			entities_.insert(entities_.end(), entities.begin(), entities.end());
+			std::sort(entities_.begin() + article_begin, entities_.end());
+			entities_.erase(std::unique(entities_.begin() + article_begin, entities_.end()), entities_.end());
+		}
+		std::sort(sources_.begin(), sources_.end());
+		result[SOURCES_FEATURE] = std::log1p((float) (std::unique(sources_.begin(), sources_.end()) - sources_.begin()));
+
+		// squared part of the articles that mention the entity, so the entities shared by the most of the thread dominate
+		// and the entities of the single articles give nothing however many of them are found
+		std::sort(entities_.begin(), entities_.end());
+		float concentration = 0;
+		for (std::size_t i = 0, j = 0; i < entities_.size(); i = j)
+		{
+			while (j < entities_.size() && entities_[j] == entities_[i])
+			{
+				j++;
+			}
+			if (j - i >= 2)
+			{
+				float part = (float) (j - i) / thread.size();
+				concentration += part * part;
+			}
+		}
+		result[ENTITIES_FEATURE] = std::log1p(concentration);
+
+		auto date_distance = corpus.dates.freshness(threads.seeds[k], today_days);
+		result[FRESHNESS_FEATURE] = date_distance < 0 ? 0 : std::exp(-std::log(2.0f) * date_distance / half_life_days_);
+
+		result[CATEGORY_FEATURE] = category >= 0 && category < (int) category_priors_.size() ? category_priors_[category] : other_prior_;
+
+		return result;
+	}
+
+
+	std::vector<float> RankingModel::score(Corpus& corpus, const Threads& threads, const std::vector<int>& categories, std::int32_t today_days)
+	{
+		std::vector<float> result(threads.size(), 0);
+
+		for (std::size_t k = 0; k < threads.size(); k++)
+		{
+			auto thread_features = features(corpus, threads, k, categories[k], today_days);
+			for (std::size_t f = 0; f < NUM_FEATURES; f++)
+			{
+				result[k] += weights_[f] * thread_features[f];
+			}
+		}
+
+		return result;
+	}
+
+
+	const char* RankingModel::feature_name(Feature feature)
+	{
+		switch (feature)
+		{
+			case SIZE_FEATURE: return "size";
+			case SOURCES_FEATURE: return "sources";
+			case FRESHNESS_FEATURE: return "freshness";
+			case ENTITIES_FEATURE: return "entities";
+			case CATEGORY_FEATURE: return "category";
+			default: return "";
+		}
+	}
+
+}  // namespace news_clustering
+#endif
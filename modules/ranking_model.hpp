@@ -0,0 +1,85 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_RANKING_MODEL_HPP
+#define _NEWS_CLUSTERING_RANKING_MODEL_HPP
+
+#include <array>
+#include <vector>
+#include "corpus.hpp"
+
+namespace news_clustering {
+
+	/**
+	 * @class RankingModel
+	 *
+	 * @brief Linear model over the thread features. All features are bounded without normalizing by maximums,
+	 * so the features and the score of the each thread are computed in one pass over the threads.
+	 */
+	class RankingModel {
+
+	public:
+
+		enum Feature {
+			// log(1 + number of articles)
+			SIZE_FEATURE,
+			// log(1 + number of different sites)
+			SOURCES_FEATURE,
+			// exp(-ln2 * days / half life) for the mean date distance of the seed, 0 if there are no dates
+			FRESHNESS_FEATURE,
+			// log(1 + sum of the squared parts of the articles that mention the each entity of at least two articles of the thread)
+			ENTITIES_FEATURE,
+			// prior of the thread category
+			CATEGORY_FEATURE,
+			NUM_FEATURES
+		};
+
+		using Features = std::array<float, NUM_FEATURES>;
+
+		RankingModel() = default;
+
+		/**
+		 * @brief category_priors are indexed by category, other_prior is used for not categorized threads
+		 * @return
+		 */
+		RankingModel(const Features& weights, float half_life_days, const std::vector<float>& category_priors, float other_prior);
+
+		/**
+		 * @brief
+		 * @return features of the k-th thread
+		 */
+		Features features(Corpus& corpus, const Threads& threads, std::size_t k, int category, std::int32_t today_days);
+
+		/**
+		 * @brief
+		 * @return score of the each thread, more is better
+		 */
+		std::vector<float> score(Corpus& corpus, const Threads& threads, const std::vector<int>& categories, std::int32_t today_days);
+
+		/**
+		 * @brief
+		 * @return name of the feature as in the config
+		 */
+		static const char* feature_name(Feature feature);
+
+	private:
+
+		Features weights_ = { 1, 1, 1, 1, 1 };
+		float half_life_days_ = 30;
+		std::vector<float> category_priors_;
+		float other_prior_ = 0;
+
+		// buffers reused from thread to thread
+		std::vector<std::int32_t> sources_;
+		std::vector<EntityId> entities_;
+	};
+
+}  // namespace news_clustering
+
+#include "ranking_model.cpp"
+
+#endif  // Header Guard
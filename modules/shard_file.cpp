@@ -0,0 +1,163 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_SHARD_FILE_CPP
+#define _NEWS_CLUSTERING_SHARD_FILE_CPP
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include "shard_file.hpp"
+#include "binary_io.hpp"
+
+
+namespace news_clustering {
+
+	namespace {
+
+		const char SHARD_MAGIC[8] = { 'T', 'G', 'N', 'S', 'H', 'A', 'R', 'D' };
+		const std::uint32_t SHARD_VERSION = 1;
+
+	}  // namespace
+
+
+	bool ShardFile::write(
+		const std::string& path,
+		Corpus& corpus,
+		const DocIds& docs,
+		const std::vector<std::uint32_t>& indexes,
+		std::uint32_t shard,
+		std::uint32_t num_shards
+	)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Cannot open file: " << path << std::endl;
+			return false;
+		}
+
+		std::string bytes;
+		BinaryWriter writer(bytes);
+
+		bytes.append(SHARD_MAGIC, sizeof(SHARD_MAGIC));
+		writer.write(SHARD_VERSION);
+		writer.write(shard);
+		writer.write(num_shards);
+		writer.write((std::uint32_t) docs.size());
+		file.write(bytes.data(), bytes.size());
+
+		std::vector<std::int32_t> days;
+		for (std::size_t i = 0; i < docs.size(); i++)
+		{
+			auto doc = docs[i];
+			auto entities = corpus.entities(doc);
+			auto embedding = corpus.embedding_values(doc);
+			days = corpus.dates.days(doc);
+
+			// documents are written one by one, so the buffer stays small
+			bytes.clear();
+			writer.write(indexes[i]);
+			writer.write_string(corpus.path(doc));
+			writer.write((std::int32_t) corpus.languages[doc].id());
+			writer.write((std::int32_t) corpus.categories[doc]);
+			writer.write_string(corpus.sources[doc] != NO_SOURCE ? std::string_view(corpus.source_name(corpus.sources[doc])) : std::string_view());
+			writer.write_string(corpus.title(doc));
+			writer.write_array(entities.begin(), entities.size());
+			writer.write_array(days.data(), days.size());
+			writer.write_array(embedding.begin(), embedding.size());
+			file.write(bytes.data(), bytes.size());
+		}
+
+		file.close();
+		if (!file)
+		{
+			std::cerr << "Cannot write file: " << path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+
+	bool ShardFile::read(const std::string& path, Header& header, std::vector<Document>& documents)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Cannot open file: " << path << std::endl;
+			return false;
+		}
+		std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		BinaryReader reader(bytes.data(), bytes.size());
+		char magic[sizeof(SHARD_MAGIC)];
+		std::uint32_t version;
+		if (
+			!reader.read(magic) || std::memcmp(magic, SHARD_MAGIC, sizeof(SHARD_MAGIC)) != 0 ||
+			!reader.read(version) || version != SHARD_VERSION ||
+			!reader.read(header.shard) || !reader.read(header.num_shards) || !reader.read(header.num_documents)
+		)
+		{
+			std::cerr << "Not a shard file: " << path << std::endl;
+			return false;
+		}
+
+		Document document;
+		std::int32_t language;
+		for (std::uint32_t i = 0; i < header.num_documents; i++)
+		{
+			if (
+				!reader.read(document.index) ||
+				!reader.read_string(document.path) ||
+				!reader.read(language) ||
+				!reader.read(document.category) ||
+				!reader.read_string(document.source) ||
+				!reader.read_string(document.title) ||
+				!reader.read_array(document.entities) ||
+				!reader.read_array(document.days) ||
+				!reader.read_array(document.embedding)
+			)
+			{
+				std::cerr << "Shard file is truncated: " << path << std::endl;
+				return false;
+			}
+			document.language = (LanguageId) language;
+			documents.push_back(document);
+		}
+
+		return true;
+	}
+
+
+	DocId ShardFile::add(Corpus& corpus, const Document& document)
+	{
+		auto doc = corpus.add(document.path);
+
+		corpus.languages[doc] = Language(document.language);
+		corpus.categories[doc] = document.category;
+		if (!document.source.empty())
+		{
+			corpus.set_source(doc, document.source);
+		}
+		corpus.set_title(doc, document.title);
+		corpus.set_entities(doc, document.entities);
+		corpus.dates.append(doc, document.days);
+		corpus.set_embedding_values(doc, document.embedding);
+
+		return doc;
+	}
+
+
+	std::string ShardFile::file_name(std::uint32_t shard, std::uint32_t num_shards)
+	{
+		return "shard-" + std::to_string(shard) + "-of-" + std::to_string(num_shards) + ".bin";
+	}
+
+}  // namespace news_clustering
+#endif
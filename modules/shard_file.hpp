@@ -0,0 +1,86 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_SHARD_FILE_HPP
+#define _NEWS_CLUSTERING_SHARD_FILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "corpus.hpp"
+
+namespace news_clustering {
+
+	/**
+	 * @class ShardFile
+	 *
+	 * @brief Binary artifact of the one shard: for the each news article everything that threads and top need
+	 * (title, site, language, category, name entities, dates and sparse embedding), so merge doesn't read html again.
+	 * Numbers are written as is, so shards should be merged on the machines with the same byte order.
+	 */
+	class ShardFile {
+
+	public:
+
+		struct Header
+		{
+			std::uint32_t shard;
+			std::uint32_t num_shards;
+			std::uint32_t num_documents;
+		};
+
+		struct Document
+		{
+			// position of the file in the whole data, documents of all shards are merged in this order
+			std::uint32_t index;
+			std::string path;
+			LanguageId language;
+			std::int32_t category;
+			std::string source;
+			std::string title;
+			std::vector<EntityId> entities;
+			std::vector<std::int32_t> days;
+			std::vector<Corpus::EmbeddingValue> embedding;
+		};
+
+		/**
+		 * @brief write documents of the corpus, indexes are positions of the documents in the whole data
+		 * @return false if file cannot be written
+		 */
+		static bool write(
+			const std::string& path,
+			Corpus& corpus,
+			const DocIds& docs,
+			const std::vector<std::uint32_t>& indexes,
+			std::uint32_t shard,
+			std::uint32_t num_shards
+		);
+
+		/**
+		 * @brief documents are appended to the vector
+		 * @return false if file cannot be read or it is not a shard file
+		 */
+		static bool read(const std::string& path, Header& header, std::vector<Document>& documents);
+
+		/**
+		 * @brief add document to the corpus and fill all its columns
+		 * @return id of the document in the corpus
+		 */
+		static DocId add(Corpus& corpus, const Document& document);
+
+		/**
+		 * @brief
+		 * @return name of the file of the shard in the directory
+		 */
+		static std::string file_name(std::uint32_t shard, std::uint32_t num_shards);
+	};
+
+}  // namespace news_clustering
+
+#include "shard_file.cpp"
+
+#endif  // Header Guard
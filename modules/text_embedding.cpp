@@ -8,6 +8,7 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #ifndef _NEWS_CLUSTERING_TEXT_EMBEDDING_CPP
 #define _NEWS_CLUSTERING_TEXT_EMBEDDING_CPP
 
+#include <cmath>
 #include <fstream>
 #include "text_embedding.hpp"
 #include "../metric/modules/distance.hpp"
@@ -41,21 +42,42 @@ namespace news_clustering {
 
 				getline(file_reader, string_for_read);
 			}
+
+			// optional IDF table is the last line: "idf" and the value of the each cluster
+			if (file_reader >> string_for_read && string_for_read == "idf")
+			{
+				idf.resize(num_clusters);
+				for (auto& value : idf)
+				{
+					file_reader >> value;
+				}
+				if (!file_reader)
+				{
+					std::cerr << "Wrong IDF table, histograms won't be weighted: " << path << std::endl;
+					idf.clear();
+				}
+			}
 		}
 		file_reader.close();
 	}
 
-	std::vector<int> TextEmbedder::operator()(const std::vector<std::string>& words, const std::locale& locale, bool increment)
+	template <typename Words>
+	std::vector<int> TextEmbedder::operator()(const Words& words, const std::locale& locale, bool increment)
 	{
+		static auto& vocab_lookups = Profiler::global().counter("vocab_lookups");
+		static auto& vocab_hits = Profiler::global().counter("vocab_hits");
+
 		std::vector<int> result(num_clusters, 0);
 		std::string word_lower;
+		std::size_t num_hits = 0;
 
-		for (auto word : words)
+		for (const auto& word : words)
 		{
-			word_lower = boost::locale::to_lower(word, locale);
+			word_lower = boost::locale::to_lower(word.data(), word.data() + word.size(), locale);
 			word_lower = lemmatizer_(word_lower);
 			if (vocab_clusters.find(word_lower) != vocab_clusters.end())
 			{
+				num_hits++;
 				if (increment)
 				{
 					result[vocab_clusters[word_lower]]++;
@@ -67,6 +89,23 @@ namespace news_clustering {
 			}
 		}
 
+		Profiler::global().add(vocab_lookups, words.size());
+		Profiler::global().add(vocab_hits, num_hits);
+
+		return result;
+	}
+
+	
+	std::vector<int> TextEmbedder::embed(Corpus& corpus, DocId doc, const std::locale& locale)
+	{
+		if (corpus.has_embedding(doc))
+		{
+			return corpus.embedding(doc, num_clusters);
+		}
+
+		auto result = (*this)(corpus.tokens(doc), locale);
+		corpus.set_embedding(doc, result);
+
 		return result;
 	}
 
@@ -78,41 +117,38 @@ namespace news_clustering {
 		return vocab_clusters.find(word_lower) != vocab_clusters.end();
 	}
 
-	//
 
-	Word2Vec::Word2Vec(const std::string& path, const Lemmatizer& lemmatizer, const Language& language) : language_(language), lemmatizer_(lemmatizer)
-	{		
-		std::string string_for_read;
-		float value;
-		long long original_vocab_size, embedding_dimensions;
-		std::vector<float> embedding;	
-	
-		std::ifstream file_reader;
+	bool TextEmbedder::has_idf() const
+	{
+		return !idf.empty();
+	}
+
 	
-		file_reader.open(path, std::ios::binary | std::ios::out);	
-		
-		if (!file_reader.is_open())
+	std::vector<float> TextEmbedder::weighted(const std::vector<int>& histogram) const
+	{
+		std::vector<float> result(histogram.size());
+		float norm = 0;
+		for (std::size_t i = 0; i < histogram.size(); i++)
 		{
-			std::cerr << "Cannot open file: " << path << std::endl;
+			result[i] = histogram[i] * idf[i];
+			norm += result[i] * result[i];
 		}
-		else
+		norm = std::sqrt(norm);
+		if (norm > 0)
 		{
-			file_reader >> original_vocab_size >> embedding_dimensions;
-			getline(file_reader, string_for_read);
-			for (auto i = 0; i < original_vocab_size; i++)
+			for (auto& value : result)
 			{
-				getline(file_reader, string_for_read, ' ');
-				embedding.clear();
-
-				for (auto j = 0; j < embedding_dimensions; j++)
-				{
-					file_reader.read(reinterpret_cast<char*>(&value), sizeof(float));
-					embedding.push_back(value);
-				}
-				vocab_embeddings[string_for_read] = embedding;
+				value /= norm;
 			}
 		}
-		file_reader.close();
+
+		return result;
+	}
+
+	//
+
+	Word2Vec::Word2Vec(const std::string& path, const Lemmatizer& lemmatizer, const Language& language) : language_(language), lemmatizer_(lemmatizer), vectors_(std::make_shared<WordVectors>(path))
+	{		
 	}
 
 	std::vector<float> Word2Vec::texts_distance(const std::vector<std::string>& long_text, const std::vector<std::vector<std::string>>& short_texts, const std::locale& locale, float num_closest_distances)
@@ -120,50 +156,26 @@ namespace news_clustering {
 		std::vector<float> result;
 		std::vector<float> distances;
 		float mean_distance;
-		float num_closest_distances_cut;
-		
-		std::string single_word_lower;
-		std::string text_word_lower;
-		
-		std::vector<float> single_word_embedding;
-		std::vector<float> text_word_embedding;
+		std::size_t num_closest_distances_cut;
 
-		auto cosineDistance = metric::Cosine<float>();
+		// words of the long text are normalized and found once, not for the each word of the short texts
+		auto long_ids = find_words(long_text, locale);
 		
-		for (auto short_text : short_texts)
+		for (const auto& short_text : short_texts)
 		{
 			distances.clear();
-			for (auto single_word : short_text)
+			for (auto single_id : find_words(short_text, locale))
 			{
-				single_word_lower = boost::locale::to_lower(single_word, locale);
-				single_word_lower = lemmatizer_(single_word_lower);
-				if (vocab_embeddings.find(single_word_lower) != vocab_embeddings.end())
+				auto query = vectors_->query(single_id);
+				for (auto text_id : long_ids)
 				{
-					single_word_embedding = vocab_embeddings[single_word_lower];
-					for (auto text_word : long_text)
-					{
-						text_word_lower = boost::locale::to_lower(text_word, locale);
-						text_word_lower = lemmatizer_(text_word_lower);
-						if (vocab_embeddings.find(text_word_lower) != vocab_embeddings.end())
-						{
-							text_word_embedding = vocab_embeddings[text_word_lower];
-							distances.push_back(cosineDistance(single_word_embedding, text_word_embedding));
-						}
-					}
-
+					distances.push_back(1 - vectors_->cosine_distance(query, text_id));
 				}
 			}
 
-			std::sort(distances.begin(), distances.end(), std::greater<float>());
+			num_closest_distances_cut = std::min<std::size_t>(distances.size(), num_closest_distances);
+			std::partial_sort(distances.begin(), distances.begin() + num_closest_distances_cut, distances.end(), std::greater<float>());
 			mean_distance = 0;
-			if (distances.size() < num_closest_distances)
-			{
-				num_closest_distances_cut = distances.size();
-			}
-			else
-			{
-				num_closest_distances_cut = num_closest_distances;
-			}
 			for (size_t i = 0; i < num_closest_distances_cut; i++)
 			{
 				mean_distance += distances[i];
@@ -175,6 +187,33 @@ namespace news_clustering {
 		return result;
 	}
 
+	std::vector<float> Word2Vec::embed(const std::vector<std::string>& words, const std::locale& locale, const std::vector<float>& idf)
+	{
+		std::vector<std::string> normalized_words;
+		normalized_words.reserve(words.size());
+		for (const auto& word : words)
+		{
+			normalized_words.push_back(lemmatizer_(boost::locale::to_lower(word, locale)));
+		}
+
+		return vectors_->embed(normalized_words, idf);
+	}
+
+	std::vector<WordVectors::WordId> Word2Vec::find_words(const std::vector<std::string>& words, const std::locale& locale)
+	{
+		std::vector<WordVectors::WordId> ids;
+		for (const auto& word : words)
+		{
+			auto id = vectors_->find(lemmatizer_(boost::locale::to_lower(word, locale)));
+			if (id != WordVectors::NO_WORD)
+			{
+				ids.push_back(id);
+			}
+		}
+
+		return ids;
+	}
+
 	//
 
 	Lemmatizer::Lemmatizer(const std::string& path, const Language& language, const std::string& default_suffix) : language_(language), default_suffix_(default_suffix)
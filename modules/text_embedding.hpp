@@ -8,6 +8,11 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #ifndef _NEWS_CLUSTERING_TEXT_EMBEDDING_HPP
 #define _NEWS_CLUSTERING_TEXT_EMBEDDING_HPP
 
+#include <memory>
+#include "corpus.hpp"
+#include "profiler.hpp"
+#include "word_vectors.hpp"
+
 namespace news_clustering {
 
 	/**
@@ -56,17 +61,39 @@ namespace news_clustering {
 		 * @brief 
 		 * @return 
 		 */
-		std::vector<int> operator()(const std::vector<std::string>& words, const std::locale& locale, bool increment = true);
+		template <typename Words>
+		std::vector<int> operator()(const Words& words, const std::locale& locale, bool increment = true);
+
+		/**
+		 * @brief embedding of the corpus document, computed once and then taken from the corpus
+		 * @return 
+		 */
+		std::vector<int> embed(Corpus& corpus, DocId doc, const std::locale& locale);
 
 		/**
 		 * @brief 
 		 * @return 
 		 */
 		bool is_exist_in_vocab(const std::string& word, const std::locale& locale);
+
+		/**
+		 * @brief
+		 * @return true if the vocab file has the IDF table of the clusters (see tools/build_idf)
+		 */
+		bool has_idf() const;
+
+		/**
+		 * @brief histogram weighted by the IDF of the clusters and L2 normalized, so cosine of two such embeddings
+		 * is their dot product and Euclidean distance between them doesn't depend on the length of the texts
+		 * @return zero vector if the histogram has no hits
+		 */
+		std::vector<float> weighted(const std::vector<int>& histogram) const;
 		
 
 		
 		long long num_clusters;	
+		// inverse document frequency of the each cluster, empty if the vocab has no IDF table
+		std::vector<float> idf;
 
 		Language language_;
 		Lemmatizer lemmatizer_;
@@ -77,30 +104,39 @@ namespace news_clustering {
 	/**
 	 * @class Word2Vec
 	 * 
-	 * @brief Word2Vec
+	 * @brief Semantic word vectors from the product quantized store (see tools/quantize_word2vec), mapped and not loaded
 	 */
 	class Word2Vec {
 		
 	public:
 		
-		using VocabEmbeddings = std::unordered_map<std::string, std::vector<float>>;
-		
 		Word2Vec() = default;
 
 		explicit Word2Vec(const std::string& path, const Lemmatizer& lemmatizer, const Language& language);
 
 		/**
-		 * @brief 
+		 * @brief mean cosine of the closest word pairs of the long text and the each short text
 		 * @return 
 		 */
 		std::vector<float> texts_distance(const std::vector<std::string>& long_text, const std::vector<std::vector<std::string>>& short_texts, const std::locale& locale, float num_closest_distances = 5);
-		
-		
+
+		/**
+		 * @brief normalized mean of the word vectors, or TF-IDF weighted sum with IDF by word id
+		 * @return 
+		 */
+		std::vector<float> embed(const std::vector<std::string>& words, const std::locale& locale, const std::vector<float>& idf = std::vector<float>());
 
 		Language language_;
 		Lemmatizer lemmatizer_;
 		
-		VocabEmbeddings vocab_embeddings;
+		std::shared_ptr<WordVectors> vectors_;
+
+	private:
+
+		/**
+		 * @brief lower cased and lemmatized words that are in the vocab
+		 */
+		std::vector<WordVectors::WordId> find_words(const std::vector<std::string>& words, const std::locale& locale);
 	};
 
 }  // namespace news_clustering
@@ -0,0 +1,173 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_WORD2VEC_FILE_CPP
+#define _NEWS_CLUSTERING_WORD2VEC_FILE_CPP
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "word2vec_file.hpp"
+
+
+namespace news_clustering {
+
+	namespace {
+
+		const std::size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+	}  // namespace
+
+
+	void Word2VecReader::Row::copy_to(float* out) const
+	{
+		std::memcpy(out, values, dimensions * sizeof(float));
+	}
+
+
+	std::string_view Word2VecReader::Row::bytes() const
+	{
+		return std::string_view(values, dimensions * sizeof(float));
+	}
+
+	//
+
+	Word2VecReader::Word2VecReader(const std::string& path) : path_(path)
+	{
+		if (file_.open(path_, true))
+		{
+			data_ = file_.data();
+			data_size_ = file_.size();
+		}
+
+		if (data_ == nullptr)
+		{
+			std::cerr << "Cannot open file: " << path_ << std::endl;
+			return;
+		}
+
+		// header is the text line "<size> <dimensions>"
+		auto header_end = static_cast<const char*>(std::memchr(data_, '\n', data_size_));
+		if (header_end == nullptr)
+		{
+			std::cerr << "Wrong word2vec header: " << path_ << std::endl;
+			file_.close();
+			data_ = nullptr;
+			return;
+		}
+		std::string header(data_, header_end);
+		char* end;
+		size_ = std::strtoull(header.c_str(), &end, 10);
+		dimensions_ = std::strtoull(end, nullptr, 10);
+		header_size_ = header_end - data_ + 1;
+		position_ = header_size_;
+	}
+
+
+	bool Word2VecReader::is_open() const
+	{
+		return data_ != nullptr;
+	}
+
+
+	std::size_t Word2VecReader::size() const
+	{
+		return size_;
+	}
+
+
+	std::size_t Word2VecReader::dimensions() const
+	{
+		return dimensions_;
+	}
+
+
+	bool Word2VecReader::next(Row& row)
+	{
+		if (data_ == nullptr || rows_read_ >= size_)
+		{
+			return false;
+		}
+
+		// original files end the each row with a line break, files of the old tools don't
+		while (position_ < data_size_ && (data_[position_] == '\n' || data_[position_] == ' ' || data_[position_] == '\r'))
+		{
+			position_++;
+		}
+		auto word_end = static_cast<const char*>(std::memchr(data_ + position_, ' ', data_size_ - position_));
+		std::size_t values_size = dimensions_ * sizeof(float);
+		if (word_end == nullptr || (std::size_t) (data_ + data_size_ - word_end - 1) < values_size)
+		{
+			std::cerr << "Word2vec file is cut after " << rows_read_ << " words: " << path_ << std::endl;
+			rows_read_ = size_;
+			return false;
+		}
+
+		row.word = std::string_view(data_ + position_, word_end - data_ - position_);
+		row.values = word_end + 1;
+		row.dimensions = dimensions_;
+		position_ = word_end + 1 - data_ + values_size;
+		rows_read_++;
+
+		return true;
+	}
+
+
+	void Word2VecReader::rewind()
+	{
+		position_ = header_size_;
+		rows_read_ = 0;
+	}
+
+	//
+
+	Word2VecWriter::Word2VecWriter(const std::string& path, std::size_t size, std::size_t dimensions) : buffer_(WRITE_BUFFER_SIZE), dimensions_(dimensions)
+	{
+		file_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+		file_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file_.is_open())
+		{
+			std::cerr << "Cannot open file: " << path << std::endl;
+			return;
+		}
+		file_ << size << " " << dimensions << "\n";
+	}
+
+
+	bool Word2VecWriter::is_open() const
+	{
+		return file_.is_open();
+	}
+
+
+	void Word2VecWriter::write(std::string_view word, const float* values)
+	{
+		file_.write(word.data(), word.size());
+		file_.put(' ');
+		file_.write(reinterpret_cast<const char*>(values), dimensions_ * sizeof(float));
+		file_.put('\n');
+	}
+
+
+	void Word2VecWriter::write(const Word2VecReader::Row& row)
+	{
+		auto bytes = row.bytes();
+		file_.write(row.word.data(), row.word.size());
+		file_.put(' ');
+		file_.write(bytes.data(), bytes.size());
+		file_.put('\n');
+	}
+
+
+	bool Word2VecWriter::close()
+	{
+		file_.close();
+		return !file_.fail();
+	}
+
+}  // namespace news_clustering
+#endif
@@ -0,0 +1,127 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_WORD2VEC_FILE_HPP
+#define _NEWS_CLUSTERING_WORD2VEC_FILE_HPP
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "binary_io.hpp"
+
+namespace news_clustering {
+
+	/**
+	 * @class Word2VecReader
+	 *
+	 * @brief Reads binary word2vec file ("<size> <dimensions>\n" and then "<word> <floats>" rows) row by row.
+	 * File is mapped to memory, so rows are views into the mapping and memory is bounded by the page cache.
+	 */
+	class Word2VecReader {
+
+	public:
+
+		/**
+		 * @brief Word and its vector, valid while the reader is alive. Values are not aligned, so they are read by copy_to.
+		 */
+		struct Row {
+			std::string_view word;
+			const char* values = nullptr;
+			std::size_t dimensions = 0;
+
+			void copy_to(float* out) const;
+
+			/**
+			 * @brief
+			 * @return raw bytes of the values
+			 */
+			std::string_view bytes() const;
+		};
+
+		explicit Word2VecReader(const std::string& path);
+
+		Word2VecReader(const Word2VecReader&) = delete;
+		Word2VecReader& operator=(const Word2VecReader&) = delete;
+
+		/**
+		 * @brief
+		 * @return false if the file can't be opened or has no header
+		 */
+		bool is_open() const;
+
+		/**
+		 * @brief
+		 * @return number of words from the header
+		 */
+		std::size_t size() const;
+
+		std::size_t dimensions() const;
+
+		/**
+		 * @brief reads the next row
+		 * @return false after the last row or if the rest of the file is damaged
+		 */
+		bool next(Row& row);
+
+		/**
+		 * @brief starts reading from the first row again
+		 */
+		void rewind();
+
+	private:
+
+		std::string path_;
+		MappedFile file_;
+		const char* data_ = nullptr;
+		std::size_t data_size_ = 0;
+
+		std::size_t size_ = 0;
+		std::size_t dimensions_ = 0;
+		std::size_t header_size_ = 0;
+		std::size_t position_ = 0;
+		std::size_t rows_read_ = 0;
+	};
+
+	/**
+	 * @class Word2VecWriter
+	 *
+	 * @brief Writes binary word2vec file row by row through the buffer, nothing is kept in memory
+	 */
+	class Word2VecWriter {
+
+	public:
+
+		Word2VecWriter(const std::string& path, std::size_t size, std::size_t dimensions);
+
+		bool is_open() const;
+
+		void write(std::string_view word, const float* values);
+
+		/**
+		 * @brief copies row of the other file as it is
+		 */
+		void write(const Word2VecReader::Row& row);
+
+		/**
+		 * @brief
+		 * @return false if some writing failed
+		 */
+		bool close();
+
+	private:
+
+		std::vector<char> buffer_;
+		std::ofstream file_;
+		std::size_t dimensions_;
+	};
+
+}  // namespace news_clustering
+
+#include "word2vec_file.cpp"
+
+#endif  // Header Guard
@@ -0,0 +1,309 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_WORD_VECTORS_CPP
+#define _NEWS_CLUSTERING_WORD_VECTORS_CPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include "word_vectors.hpp"
+
+
+namespace news_clustering {
+
+	namespace {
+
+		const char WORD_VECTORS_MAGIC[8] = { 'T', 'G', 'N', 'W', 'V', 'E', 'C', 'S' };
+		const std::uint32_t WORD_VECTORS_VERSION = 1;
+
+		// magic, version, dimensions, subspaces, words, size of the words chars
+		const std::size_t WORD_VECTORS_HEADER_SIZE = sizeof(WORD_VECTORS_MAGIC) + 5 * sizeof(std::uint32_t);
+
+	}  // namespace
+
+
+	WordVectors::WordVectors(const std::string& path)
+	{
+		if (!file_.open(path))
+		{
+			std::cerr << "Cannot open file: " << path << std::endl;
+			return;
+		}
+
+		BinaryReader reader(file_.data(), file_.size());
+		char magic[sizeof(WORD_VECTORS_MAGIC)];
+		std::uint32_t version, dimensions, subspaces, size, chars_size;
+		if (
+			!reader.read(magic) || std::memcmp(magic, WORD_VECTORS_MAGIC, sizeof(WORD_VECTORS_MAGIC)) != 0 ||
+			!reader.read(version) || version != WORD_VECTORS_VERSION ||
+			!reader.read(dimensions) || !reader.read(subspaces) || !reader.read(size) || !reader.read(chars_size) ||
+			subspaces == 0 || dimensions % subspaces != 0
+		)
+		{
+			std::cerr << "Wrong word vectors file: " << path << std::endl;
+			file_.close();
+			return;
+		}
+
+		// sections follow the header, all of them are 4 byte aligned except the last two
+		std::size_t codebooks_size = (std::size_t) dimensions * CENTROIDS * sizeof(float);
+		std::size_t norms_size = (std::size_t) size * sizeof(float);
+		std::size_t offsets_size = ((std::size_t) size + 1) * sizeof(std::uint32_t);
+		std::size_t codes_size = (std::size_t) size * subspaces;
+		if (file_.size() != WORD_VECTORS_HEADER_SIZE + codebooks_size + norms_size + offsets_size + codes_size + chars_size)
+		{
+			std::cerr << "Word vectors file is damaged: " << path << std::endl;
+			file_.close();
+			return;
+		}
+
+		const char* data = file_.data() + WORD_VECTORS_HEADER_SIZE;
+		codebooks_ = reinterpret_cast<const float*>(data);
+		norms_ = reinterpret_cast<const float*>(data += codebooks_size);
+		offsets_ = reinterpret_cast<const std::uint32_t*>(data += norms_size);
+		codes_ = reinterpret_cast<const std::uint8_t*>(data += offsets_size);
+		chars_ = data + codes_size;
+
+		size_ = size;
+		dimensions_ = dimensions;
+		subspaces_ = subspaces;
+		subspace_dimensions_ = dimensions / subspaces;
+	}
+
+
+	bool WordVectors::is_open() const
+	{
+		return file_.is_open();
+	}
+
+
+	std::size_t WordVectors::size() const
+	{
+		return size_;
+	}
+
+
+	std::size_t WordVectors::dimensions() const
+	{
+		return dimensions_;
+	}
+
+
+	std::size_t WordVectors::subspaces() const
+	{
+		return subspaces_;
+	}
+
+
+	WordVectors::WordId WordVectors::find(std::string_view word) const
+	{
+		// words are sorted in the file
+		std::size_t first = 0;
+		std::size_t last = size_;
+		while (first < last)
+		{
+			std::size_t middle = first + (last - first) / 2;
+			if (this->word((WordId) middle) < word)
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+
+		return first < size_ && this->word((WordId) first) == word ? (WordId) first : NO_WORD;
+	}
+
+
+	std::string_view WordVectors::word(WordId id) const
+	{
+		return std::string_view(chars_ + offsets_[id], offsets_[id + 1] - offsets_[id]);
+	}
+
+
+	void WordVectors::add_to(WordId id, float weight, float* out) const
+	{
+		const std::uint8_t* codes = codes_ + (std::size_t) id * subspaces_;
+		for (std::size_t m = 0; m < subspaces_; m++)
+		{
+			const float* centroid = codebooks_ + (m * CENTROIDS + codes[m]) * subspace_dimensions_;
+			float* part = out + m * subspace_dimensions_;
+			for (std::size_t j = 0; j < subspace_dimensions_; j++)
+			{
+				part[j] += weight * centroid[j];
+			}
+		}
+	}
+
+
+	std::vector<float> WordVectors::embed(const std::vector<std::string>& words, const std::vector<float>& weights) const
+	{
+		std::vector<float> embedding(dimensions_, 0);
+		for (const auto& word : words)
+		{
+			auto id = find(word);
+			if (id != NO_WORD)
+			{
+				add_to(id, weights.empty() ? 1.0f : weights[id], embedding.data());
+			}
+		}
+
+		// mean and sum have the same direction, so the mean is not divided by the count before normalization
+		float norm = std::sqrt(std::inner_product(embedding.begin(), embedding.end(), embedding.begin(), 0.0f));
+		if (norm > 0)
+		{
+			for (auto& value : embedding)
+			{
+				value /= norm;
+			}
+		}
+
+		return embedding;
+	}
+
+
+	WordVectors::Query WordVectors::query(const float* vector) const
+	{
+		Query query;
+		query.dots.resize(subspaces_ * CENTROIDS);
+		for (std::size_t m = 0; m < subspaces_; m++)
+		{
+			const float* part = vector + m * subspace_dimensions_;
+			for (std::size_t c = 0; c < CENTROIDS; c++)
+			{
+				const float* centroid = codebooks_ + (m * CENTROIDS + c) * subspace_dimensions_;
+				float dot = 0;
+				for (std::size_t j = 0; j < subspace_dimensions_; j++)
+				{
+					dot += part[j] * centroid[j];
+				}
+				query.dots[m * CENTROIDS + c] = dot;
+			}
+		}
+		query.norm = std::sqrt(std::inner_product(vector, vector + dimensions_, vector, 0.0f));
+
+		return query;
+	}
+
+
+	WordVectors::Query WordVectors::query(WordId id) const
+	{
+		std::vector<float> vector(dimensions_, 0);
+		add_to(id, 1.0f, vector.data());
+		return query(vector.data());
+	}
+
+
+	float WordVectors::dot(const Query& query, WordId id) const
+	{
+		const std::uint8_t* codes = codes_ + (std::size_t) id * subspaces_;
+		const float* dots = query.dots.data();
+		float dot = 0;
+		for (std::size_t m = 0; m < subspaces_; m++, dots += CENTROIDS)
+		{
+			dot += dots[codes[m]];
+		}
+
+		return dot;
+	}
+
+
+	float WordVectors::cosine_distance(const Query& query, WordId id) const
+	{
+		float norms = query.norm * norms_[id];
+		return norms > 0 ? 1 - dot(query, id) / norms : 1;
+	}
+
+
+	void WordVectors::cosine_distances(const Query& query, const std::vector<WordId>& ids, std::vector<float>& distances) const
+	{
+		distances.resize(ids.size());
+		for (std::size_t i = 0; i < ids.size(); i++)
+		{
+			distances[i] = cosine_distance(query, ids[i]);
+		}
+	}
+
+
+	bool WordVectors::write(
+		const std::string& path,
+		const std::vector<std::string>& words,
+		std::size_t dimensions,
+		std::size_t subspaces,
+		const std::vector<float>& codebooks,
+		const std::vector<std::uint8_t>& codes
+	)
+	{
+		std::size_t subspace_dimensions = dimensions / subspaces;
+		std::vector<std::size_t> order(words.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&words](std::size_t a, std::size_t b) { return words[a] < words[b]; });
+
+		// norms of the decoded vectors, so the cosine is exact for the stored vectors
+		std::vector<float> norms;
+		std::vector<std::uint32_t> offsets(1, 0);
+		std::vector<std::uint8_t> sorted_codes;
+		std::string chars;
+		norms.reserve(words.size());
+		sorted_codes.reserve(codes.size());
+		for (auto i : order)
+		{
+			float norm = 0;
+			for (std::size_t m = 0; m < subspaces; m++)
+			{
+				auto code = codes[i * subspaces + m];
+				const float* centroid = &codebooks[(m * CENTROIDS + code) * subspace_dimensions];
+				for (std::size_t j = 0; j < subspace_dimensions; j++)
+				{
+					norm += centroid[j] * centroid[j];
+				}
+				sorted_codes.push_back(code);
+			}
+			norms.push_back(std::sqrt(norm));
+			chars += words[i];
+			offsets.push_back((std::uint32_t) chars.size());
+		}
+
+		std::string header;
+		BinaryWriter writer(header);
+		header.append(WORD_VECTORS_MAGIC, sizeof(WORD_VECTORS_MAGIC));
+		writer.write(WORD_VECTORS_VERSION);
+		writer.write((std::uint32_t) dimensions);
+		writer.write((std::uint32_t) subspaces);
+		writer.write((std::uint32_t) words.size());
+		writer.write((std::uint32_t) chars.size());
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Cannot open file: " << path << std::endl;
+			return false;
+		}
+		file.write(header.data(), header.size());
+		file.write(reinterpret_cast<const char*>(codebooks.data()), codebooks.size() * sizeof(float));
+		file.write(reinterpret_cast<const char*>(norms.data()), norms.size() * sizeof(float));
+		file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(std::uint32_t));
+		file.write(reinterpret_cast<const char*>(sorted_codes.data()), sorted_codes.size());
+		file.write(chars.data(), chars.size());
+		file.close();
+		if (!file)
+		{
+			std::cerr << "Cannot write file: " << path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+}  // namespace news_clustering
+#endif
@@ -0,0 +1,130 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#ifndef _NEWS_CLUSTERING_WORD_VECTORS_HPP
+#define _NEWS_CLUSTERING_WORD_VECTORS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "binary_io.hpp"
+
+namespace news_clustering {
+
+	/**
+	 * @class WordVectors
+	 *
+	 * @brief Product quantized word vectors. Vector is split into subspaces and the each part is stored as the one byte
+	 * index of the closest of 256 centroids of its subspace, so 300 floats take 75 bytes with 4 dimensions per subspace.
+	 * File is mapped to memory and used as it is: sorted words for the lookup, codes, codebooks and norms.
+	 * Distances to a query vector are computed by the asymmetric distance computation (ADC): dot products of the query
+	 * with all the centroids are computed once, then the each word costs one table lookup per subspace.
+	 */
+	class WordVectors {
+
+	public:
+
+		using WordId = std::int32_t;
+
+		static constexpr WordId NO_WORD = -1;
+		static constexpr std::size_t CENTROIDS = 256;
+
+		/**
+		 * @brief Dot products of the query parts with the centroids of the each subspace
+		 */
+		struct Query {
+			std::vector<float> dots;
+			float norm = 0;
+		};
+
+		WordVectors() = default;
+
+		explicit WordVectors(const std::string& path);
+
+		bool is_open() const;
+
+		std::size_t size() const;
+
+		std::size_t dimensions() const;
+
+		std::size_t subspaces() const;
+
+		/**
+		 * @brief
+		 * @return id of the word or NO_WORD
+		 */
+		WordId find(std::string_view word) const;
+
+		std::string_view word(WordId id) const;
+
+		/**
+		 * @brief adds weighted decoded vector of the word to the out
+		 */
+		void add_to(WordId id, float weight, float* out) const;
+
+		/**
+		 * @brief Article embedding in one pass over the words: mean of the word vectors, or sum of the vectors
+		 * weighted by weights[id] (IDF gives the TF-IDF weighted sum, as repeated words are added again).
+		 * Words out of the vocab are skipped.
+		 * @return L2 normalized vector, zero vector if no word is found
+		 */
+		std::vector<float> embed(const std::vector<std::string>& words, const std::vector<float>& weights = std::vector<float>()) const;
+
+		Query query(const float* vector) const;
+
+		Query query(WordId id) const;
+
+		/**
+		 * @brief ADC dot product of the query and the decoded vector of the word
+		 */
+		float dot(const Query& query, WordId id) const;
+
+		/**
+		 * @brief
+		 * @return 1 - cosine of the query and the decoded vector of the word
+		 */
+		float cosine_distance(const Query& query, WordId id) const;
+
+		void cosine_distances(const Query& query, const std::vector<WordId>& ids, std::vector<float>& distances) const;
+
+		/**
+		 * @brief writes the store, words are sorted in the file
+		 * @param codebooks subspaces x CENTROIDS x (dimensions / subspaces)
+		 * @param codes words x subspaces
+		 * @return false if writing failed
+		 */
+		static bool write(
+			const std::string& path,
+			const std::vector<std::string>& words,
+			std::size_t dimensions,
+			std::size_t subspaces,
+			const std::vector<float>& codebooks,
+			const std::vector<std::uint8_t>& codes
+		);
+
+	private:
+
+		MappedFile file_;
+
+		std::size_t size_ = 0;
+		std::size_t dimensions_ = 0;
+		std::size_t subspaces_ = 0;
+		std::size_t subspace_dimensions_ = 0;
+
+		const float* codebooks_ = nullptr;
+		const float* norms_ = nullptr;
+		const std::uint32_t* offsets_ = nullptr;
+		const std::uint8_t* codes_ = nullptr;
+		const char* chars_ = nullptr;
+	};
+
+}  // namespace news_clustering
+
+#include "word_vectors.cpp"
+
+#endif  // Header Guard
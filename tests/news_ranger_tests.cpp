@@ -0,0 +1,82 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+#include "metric/modules/utils/ThreadPool.cpp"
+#include "modules/news_ranger.hpp"
+
+#define BOOST_TEST_MODULE Main
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+	// threads of the given articles, the first one is the seed
+	news_clustering::Threads make_threads(const std::vector<news_clustering::DocIds>& threads_articles)
+	{
+		news_clustering::Threads threads;
+		for (const auto& articles : threads_articles)
+		{
+			threads.seeds.push_back(articles[0]);
+			threads.articles.insert(threads.articles.end(), articles.begin(), articles.end());
+			threads.offsets.push_back(threads.articles.size());
+		}
+		return threads;
+	}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(ThreadCategoryIsSeedCategory)
+{
+	std::vector<news_clustering::Language> languages;
+	std::unordered_map<news_clustering::Language, news_clustering::TextEmbedder> embedders;
+	std::unordered_map<news_clustering::Language, std::locale> locales;
+	std::vector<int> today = { 1, 1, 2020 };
+	news_clustering::NewsRanger ranger(languages, embedders, locales, today);
+
+	news_clustering::Corpus corpus;
+	for (auto category : { 1, 1, 2, 2, news_clustering::UNDEFINED_CATEGORY, 1 })
+	{
+		corpus.categories[corpus.add("")] = category;
+	}
+
+	// tail articles are the least relevant, their categories differ from the seeds
+	auto threads = make_threads({ { 0, 1, 2 }, { 3, 4, 5 }, { 4, 0 } });
+	auto ranked = ranger.arrange_top_k(corpus, threads, 10);
+
+	BOOST_CHECK(ranked.categories == std::vector<int>({ 1, 2, news_clustering::OTHER_CATEGORY }));
+	BOOST_REQUIRE_EQUAL(ranked.num_groups(), 3);
+	BOOST_CHECK(ranked.group_categories == std::vector<int>({ 1, 2, news_clustering::OTHER_CATEGORY }));
+	for (std::size_t g = 0; g < ranked.num_groups(); g++)
+	{
+		BOOST_REQUIRE_EQUAL(ranked.group(g).size(), 1);
+		BOOST_CHECK_EQUAL(ranked.group(g)[0], g);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(EntitiesFeatureIsConcentration)
+{
+	news_clustering::Corpus corpus;
+	news_clustering::DocIds same_entities;
+	news_clustering::DocIds unrelated_entities;
+	for (news_clustering::EntityId a = 0; a < 10; a++)
+	{
+		same_entities.push_back(corpus.add(""));
+		corpus.set_entities(same_entities.back(), { 1, 2, 3, 4, 5, 1 });
+		unrelated_entities.push_back(corpus.add(""));
+		corpus.set_entities(unrelated_entities.back(), { 10 + 5 * a, 11 + 5 * a, 12 + 5 * a, 13 + 5 * a, 14 + 5 * a });
+	}
+	auto threads = make_threads({ same_entities, unrelated_entities });
+
+	news_clustering::RankingModel model;
+	auto same_features = model.features(corpus, threads, 0, news_clustering::OTHER_CATEGORY, 0);
+	auto unrelated_features = model.features(corpus, threads, 1, news_clustering::OTHER_CATEGORY, 0);
+
+	// articles that name the same entities make the thread, entities of the single articles don't
+	BOOST_CHECK_CLOSE(same_features[news_clustering::RankingModel::ENTITIES_FEATURE], std::log1p(5.0f), 1e-4);
+	BOOST_CHECK_EQUAL(unrelated_features[news_clustering::RankingModel::ENTITIES_FEATURE], 0);
+}
@@ -9,6 +9,10 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #include <vector>
 #include <iostream>
 #include <ctime>
+#include <filesystem>
+#include <memory>
+#include <limits>
+#include <sstream>
 
 #include "modules/language_detector.hpp"
 #include "modules/name_entities_recognizer.hpp"
@@ -16,6 +20,11 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #include "modules/categories_detector.hpp"
 #include "modules/news_clusterizer.hpp"
 #include "modules/news_ranger.hpp"
+#include "modules/json_writer.hpp"
+#include "modules/profiler.hpp"
+#include "modules/shard_file.hpp"
+#include "modules/document_cache.hpp"
+#include "modules/directory_watcher.hpp"
 #include "metric/modules/utils/ThreadPool.cpp"
 #include "metric/modules/utils/Semaphore.h"
 
@@ -30,20 +39,29 @@ const std::string NEWS_MODE_COMMAND = "news";
 const std::string CATEGORIES_MODE_COMMAND = "categories";
 const std::string THREAD_MODE_COMMAND = "threads";
 const std::string TOP_MODE_COMMAND = "top";
-
-enum Mode { UNKNOWN_MODE, LANGUAGES_MODE, NEWS_MODE, CATEGORIES_MODE, THREAD_MODE, TOP_MODE };
+const std::string SHARD_MODE_COMMAND = "shard-process";
+const std::string MERGE_MODE_COMMAND = "merge";
+const std::string WATCH_MODE_COMMAND = "watch";
+
+const std::string COMPACT_OPTION = "--compact";
+const std::string PROFILE_OPTION = "--profile";
+const std::string TRACE_OPTION = "--trace";
+const std::string MAX_MEMORY_OPTION = "--max-memory";
+const std::string SHARD_OPTION = "--shard";
+const std::string SHARDS_DIR_OPTION = "--shards-dir";
+const std::string THREADS_OPTION = "--threads";
+const std::string CACHE_OPTION = "--cache";
+const std::string INTERVAL_OPTION = "--interval";
+const std::string MIN_THREAD_SIZE_OPTION = "--min-thread-size";
+
+enum Mode { UNKNOWN_MODE, LANGUAGES_MODE, NEWS_MODE, CATEGORIES_MODE, THREAD_MODE, TOP_MODE, SHARD_MODE, MERGE_MODE };
 
 ////////////////////////////
 
 int main(int argc, char *argv[]) 
 {	
-	//std::cerr << "tgnews have started" << std::endl;  
-	//std::cerr << std::endl;  
-	
-	auto total_start_time = std::chrono::steady_clock::now();
-	auto t0 = std::chrono::steady_clock::now();
-	auto t1 = std::chrono::steady_clock::now();
-	auto t2 = std::chrono::steady_clock::now();	
+	// stages are timed from the start
+	auto& profiler = news_clustering::Profiler::global();
 
 	
     // Create system default locale
@@ -67,43 +85,151 @@ int main(int argc, char *argv[])
 	Mode mode = UNKNOWN_MODE;
 	std::string data_path = "data";
 
+	// options can go anywhere, the rest are mode, data path and config in this order
+	bool compact_output = false;
+	bool profile = false;
+	bool profile_report = false;
+	std::string profile_path;
+	std::string trace_path;
+	std::size_t max_memory = 0;
+	std::string shard_arg;
+	std::string shards_path = "shards";
+	bool threads_output = false;
+	std::string cache_path;
+	bool watch = false;
+	int watch_interval = 60;
+	std::size_t min_thread_size = 0;
+	std::vector<std::string> args = { argv[0] };
+	for (auto i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == COMPACT_OPTION)
+		{
+			compact_output = true;
+		}
+		else if (arg == PROFILE_OPTION || arg.compare(0, PROFILE_OPTION.size() + 1, PROFILE_OPTION + "=") == 0)
+		{
+			// report goes to stderr if path isn't set
+			profile = true;
+			profile_report = true;
+			profile_path = arg.size() > PROFILE_OPTION.size() ? arg.substr(PROFILE_OPTION.size() + 1) : "";
+		}
+		else if (arg.compare(0, TRACE_OPTION.size() + 1, TRACE_OPTION + "=") == 0)
+		{
+			profile = true;
+			trace_path = arg.substr(TRACE_OPTION.size() + 1);
+		}
+		else if (arg.compare(0, MAX_MEMORY_OPTION.size() + 1, MAX_MEMORY_OPTION + "=") == 0)
+		{
+			// megabytes for the documents being processed, vocabs and results aren't counted
+			auto megabytes_arg = arg.substr(MAX_MEMORY_OPTION.size() + 1);
+			unsigned long long megabytes = 0;
+			bool is_valid = !megabytes_arg.empty() && megabytes_arg.find_first_not_of("0123456789") == std::string::npos;
+			try
+			{
+				megabytes = is_valid ? std::stoull(megabytes_arg) : 0;
+			}
+			catch (const std::exception&)
+			{
+				is_valid = false;
+			}
+			if (!is_valid || megabytes > (std::numeric_limits<std::size_t>::max() >> 20))
+			{
+				std::cerr << "Wrong --max-memory: '" << megabytes_arg << "', it should be set as --max-memory=<MB>" << std::endl;
+				return EXIT_FAILURE;
+			}
+			max_memory = megabytes << 20;
+		}
+		else if (arg == SHARD_OPTION && i + 1 < argc)
+		{
+			shard_arg = argv[++i];
+		}
+		else if (arg.compare(0, SHARD_OPTION.size() + 1, SHARD_OPTION + "=") == 0)
+		{
+			shard_arg = arg.substr(SHARD_OPTION.size() + 1);
+		}
+		else if (arg.compare(0, SHARDS_DIR_OPTION.size() + 1, SHARDS_DIR_OPTION + "=") == 0)
+		{
+			shards_path = arg.substr(SHARDS_DIR_OPTION.size() + 1);
+		}
+		else if (arg.compare(0, CACHE_OPTION.size() + 1, CACHE_OPTION + "=") == 0)
+		{
+			cache_path = arg.substr(CACHE_OPTION.size() + 1);
+		}
+		else if (arg.compare(0, INTERVAL_OPTION.size() + 1, INTERVAL_OPTION + "=") == 0)
+		{
+			// seconds between snapshots of the watch mode
+			watch_interval = std::max(1, std::atoi(arg.substr(INTERVAL_OPTION.size() + 1).c_str()));
+		}
+		else if (arg.compare(0, MIN_THREAD_SIZE_OPTION.size() + 1, MIN_THREAD_SIZE_OPTION + "=") == 0)
+		{
+			// threads are the stable clusters of the density hierarchy instead of the fixed eps
+			min_thread_size = std::max(0, std::atoi(arg.substr(MIN_THREAD_SIZE_OPTION.size() + 1).c_str()));
+		}
+		else if (arg == THREADS_OPTION)
+		{
+			// merge and watch print threads instead of top
+			threads_output = true;
+		}
+		else
+		{
+			args.push_back(argv[i]);
+		}
+	}
+	argc = args.size();
+	profiler.enable(profile);
+
 	if (argc > 1)
 	{
-		if (argv[1] == LANGUAGES_MODE_COMMAND)
+		if (args[1] == LANGUAGES_MODE_COMMAND)
 		{
 			mode = LANGUAGES_MODE;
 		}
-		else if (argv[1] == NEWS_MODE_COMMAND)
+		else if (args[1] == NEWS_MODE_COMMAND)
 		{
 			mode = NEWS_MODE;
 		}
-		else if (argv[1] == CATEGORIES_MODE_COMMAND)
+		else if (args[1] == CATEGORIES_MODE_COMMAND)
 		{
 			mode = CATEGORIES_MODE;
 		}
-		else if (argv[1] == THREAD_MODE_COMMAND)
+		else if (args[1] == THREAD_MODE_COMMAND)
 		{
 			mode = THREAD_MODE;
 		}
-		else if (argv[1] == TOP_MODE_COMMAND)
+		else if (args[1] == TOP_MODE_COMMAND)
 		{
 			mode = TOP_MODE;
 		}
+		else if (args[1] == SHARD_MODE_COMMAND)
+		{
+			mode = SHARD_MODE;
+		}
+		else if (args[1] == MERGE_MODE_COMMAND)
+		{
+			mode = MERGE_MODE;
+		}
+		else if (args[1] == WATCH_MODE_COMMAND)
+		{
+			// watch goes through the same pipeline as threads or top
+			watch = true;
+			mode = threads_output ? THREAD_MODE : TOP_MODE;
+		}
 		else
 		{
-			std::cerr << "Unknown command: " << argv[1] << std::endl; 
+			std::cerr << "Unknown command: " << args[1] << std::endl; 
 			return EXIT_FAILURE; 
 		}
 	}
 	else
 	{
-		std::cerr << "Unspecified mode: you should specify working mode. Possible modes are: 'languages', 'news', 'categories', 'threads', 'top'." << std::endl;  
+		std::cerr << "Unspecified mode: you should specify working mode. Possible modes are: 'languages', 'news', 'categories', 'threads', 'top', 'shard-process', 'merge', 'watch'." << std::endl;  
 		return EXIT_FAILURE;
 	}
 
 	if (argc > 2)
 	{
-		data_path = argv[2];
+		data_path = args[2];
 		//std::cerr << "Using data path: " << data_path << std::endl;  
 	}
 	else
@@ -111,6 +237,28 @@ int main(int argc, char *argv[])
 		std::cerr << "You haven't specified data path, default path will be used instead: " << data_path << std::endl;  
 	}
 
+	// shard-process takes only the i-th of every N files
+	std::uint32_t shard = 0;
+	std::uint32_t num_shards = 1;
+	if (mode == SHARD_MODE)
+	{
+		auto slash = shard_arg.find('/');
+		try
+		{
+			shard = std::stoul(shard_arg.substr(0, slash));
+			num_shards = slash != std::string::npos ? std::stoul(shard_arg.substr(slash + 1)) : 0;
+		}
+		catch (const std::exception&)
+		{
+			num_shards = 0;
+		}
+		if (num_shards == 0 || shard >= num_shards)
+		{
+			std::cerr << "Wrong shard: '" << shard_arg << "', it should be set as --shard i/N, where 0 <= i < N" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
 	//std::cerr << std::endl;  
 
 	/// config
@@ -118,7 +266,7 @@ int main(int argc, char *argv[])
 	std::string config_filename = "assets/default.cfg";
 	if (argc > 3)
 	{
-		config_filename = argv[3];
+		config_filename = args[3];
 		std::cerr << "Using config: " << config_filename << std::endl;  
 		std::cerr << std::endl;
 	}
@@ -161,80 +309,18 @@ int main(int argc, char *argv[])
 
 	/// variables	
 	
-	json result;
-	news_clustering::Language language;
-	
-	std::unordered_map<std::string, std::vector<std::string>> all_content;	
-
-	std::unordered_map<std::string, std::vector<std::string>> ner_articles;
-	std::unordered_map<std::string, std::string> title_articles;
-	std::unordered_map<std::string, std::vector<std::vector<int>>> found_dates;
-	
-    std::unordered_map<std::string, news_clustering::Language> selected_language_articles; 
-    std::unordered_map<std::string, std::vector<std::string>> selected_language_content; 
-	
-    std::unordered_map<std::string, news_clustering::Language> selected_news_articles; 
-    std::unordered_map<std::string, std::vector<std::string>> selected_news_content; 
-	
-	std::unordered_map<std::string, std::string> articles_by_category;
-
-	std::unordered_map<std::string, std::vector<std::string>> clustered_articles;
+	// result is streamed to stdout as soon as it is found, keys go in alphabetical order as nlohmann::json writes them
+	news_clustering::JsonWriter writer(1, !compact_output);
 
 
-	/// Load data
-
-	//std::cerr << "Data loading..." << std::endl;  
+	/// Data and vocabs prepare
 
-	t0 = std::chrono::steady_clock::now();
-	t1 = std::chrono::steady_clock::now();
+	news_clustering::Profiler::Scope vocabs_scope("vocabs parsing");
 	
-	std::time_t t = std::time(0);   // get time now
-	std::tm* now = std::localtime(&t);
-	std::vector<int> today = {now->tm_mday, now->tm_mon + 1, now->tm_year + 1900};
-
 	unsigned concurentThreadsSupported = std::thread::hardware_concurrency();
-	//std::cerr << "Num cores: " << concurentThreadsSupported << std::endl;
-	std::mutex mutex_;
 		
 	auto content_parser = news_clustering::ContentParser();
 
-	auto file_names = content_parser.selectHtmlFiles(data_path);
-	//std::cerr << "Num files: " << file_names.size() << std::endl;  
-	
-	Semaphore sem;
-	ThreadPool pool(concurentThreadsSupported);
-	for (auto i = 0; i < file_names.size(); i++)
-	{
-		pool.execute(
-			[i, &sem, &content_parser, &all_content, &file_names, &mutex_]()
-			{			
-				auto content = content_parser.parse(file_names[i], std::locale(), ' ', 1);
-
-				mutex_.lock();
-				all_content[file_names[i]] = content;
-				mutex_.unlock();
-
-				sem.notify();
-			}
-		);
-	}	
-	for (auto i = 0; i < file_names.size(); i++)
-	{
-		sem.wait();
-	}
-	pool.close();
-
-	t2 = std::chrono::steady_clock::now();
-	//std::cerr << "Data have loaded (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-	//std::cerr << std::endl;  
-
-
-	/// Data and vocabs prepare
-
-	//std::cerr << "Vocabs parsing..." << std::endl;  
-
-	t0 = std::chrono::steady_clock::now();
-	
 	//
 	auto english_language = news_clustering::Language(news_clustering::ENGLISH_LANGUAGE);
 	auto russian_language = news_clustering::Language(news_clustering::RUSSIAN_LANGUAGE);
@@ -283,365 +369,733 @@ int main(int argc, char *argv[])
 	categories[english_language] = content_parser.parse_categories(config["en"]["categories"], en_boost_locale);
 	categories[russian_language] = content_parser.parse_categories(config["ru"]["categories"], en_boost_locale);
 
-	t2 = std::chrono::steady_clock::now();
-	//std::cerr << "Vocab have parsed (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-	//std::cerr << std::endl;  
+	vocabs_scope.stop();
+
+
+	/// Detectors that don't depend on the date are created once, watch mode reuses them for every snapshot
 
+	news_clustering::Profiler::Scope detectors_scope("detectors building");
 
-	/// Language detection
+	auto language_detector = news_clustering::LanguageDetector(languages, top_freq_vocab_paths, language_boost_locales);
+	auto ner = news_clustering::NER(languages, text_embedders, language_boost_locales);
+	auto title_extractor = news_clustering::TitleExtractor(language_boost_locales);
 
-	if (mode == LANGUAGES_MODE || mode == NEWS_MODE || mode == CATEGORIES_MODE || mode == THREAD_MODE || mode == TOP_MODE)
+	detectors_scope.stop();
+
+	// watch mode always keeps a cache, so only new and changed files go through the per document stages;
+	// its name is derived from the watched directory, so watchers of the different directories don't share it
+	if (watch && cache_path.empty())
 	{
-		//std::cerr << "Language detection..." << std::endl;
+		std::error_code error;
+		auto watched_path = std::filesystem::weakly_canonical(data_path, error).string();
+		if (error)
+		{
+			watched_path = data_path;
+		}
+		std::ostringstream cache_name;
+		cache_name << "tgnews_watch_" << std::hex << news_clustering::xxh64(watched_path.data(), watched_path.size()) << ".cache";
+		cache_path = (std::filesystem::temp_directory_path(error) / cache_name.str()).string();
+	}
 
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
+	// cache is valid only for the same config
+	std::unique_ptr<news_clustering::DocumentCache> cache;
+	if (!cache_path.empty() && mode != MERGE_MODE)
+	{
+		auto config_dump = config.dump();
+		cache.reset(new news_clustering::DocumentCache(cache_path, news_clustering::xxh64(config_dump.data(), config_dump.size())));
+	}
 
-		auto language_detector = news_clustering::LanguageDetector(languages, top_freq_vocab_paths, language_boost_locales);
-		
-		/// Hyperparams
-		// Language consts
-		size_t num_language_samples = 300;
-		double language_score_min_level = 0.1;
-		
-		auto found_languages = language_detector.detect_language(all_content, num_language_samples, language_score_min_level);			
-		
-		std::size_t found_filename_start;
-		std::string filename;
 
-		// Prepare result
-		result = json();
-		for (auto i = found_languages.begin(); i != found_languages.end(); i++)
-		{		
-			// select only known languages
-			if (i->first.id() != news_clustering::UNKNOWN_LANGUAGE)
-			{	
-				json lang_item = {
-					{"lang_code", i->first.to_string()}, 		
-					{"articles", std::vector<std::string>()}
-				};
-				for (auto k : i->second)
+	/// Pipeline over the files, result of the mode is written to stdout
+
+	auto run_pipeline = [&](const std::vector<std::string>& file_names) -> int
+	{
+		/// Documents are processed in batches: every batch is loaded, goes through all per document stages
+		/// and then its raw bytes and tokens are freed. Without memory budget there is only one batch.
+
+		// dates are compared with the day of the run
+		std::time_t t = std::time(0);   // get time now
+		std::tm* now = std::localtime(&t);
+		std::vector<int> today = {now->tm_mday, now->tm_mon + 1, now->tm_year + 1900};
+
+		// all articles data is kept in the corpus columns, stages pass only document ids
+		news_clustering::Corpus corpus;
+	
+		news_clustering::DocIds selected_language_docs; 
+		news_clustering::DocIds selected_news_docs; 
+
+		news_clustering::Threads threads;
+
+		// position of the each document in the whole data, merge puts documents of all shards in this order
+		std::vector<std::uint32_t> file_indexes;
+		if (mode != MERGE_MODE)
+		{
+			for (std::uint32_t k = 0; k < file_names.size(); k++)
+			{
+				if (k % num_shards == shard)
 				{
-					selected_language_articles[k] = i->first;
-					selected_language_content[k] = all_content[k];
-					
-					found_filename_start = k.find_last_of("/\\");
-					filename = k.substr(found_filename_start + 1);
-					lang_item["articles"].push_back(filename);
+					corpus.add(file_names[k]);
+					file_indexes.push_back(k);
 				}
-				result.push_back(lang_item);
-			}			
+			}
 		}
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "Language detection have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;
-		
-		if (mode == LANGUAGES_MODE)
+		// raw bytes, token chars and token views take about three times of the file size
+		std::vector<news_clustering::DocIds> batches(1);
+		std::size_t batch_bytes = 0;
+		for (news_clustering::DocId i = 0; i < corpus.size(); i++)
 		{
-			std::cout << result.dump(4, ' ', false, json::error_handler_t::replace) << std::endl;
+			std::error_code error;
+			std::size_t doc_bytes = 3 * std::filesystem::file_size(corpus.path(i), error);
+			if (max_memory > 0 && !batches.back().empty() && batch_bytes + doc_bytes > max_memory)
+			{
+				batches.emplace_back();
+				batch_bytes = 0;
+			}
+			batches.back().push_back(i);
+			batch_bytes += doc_bytes;
 		}
-	}
 	
+		auto& files_read = profiler.counter("files_read");
+		auto& bytes_read = profiler.counter("bytes_read");
+		auto& tokens_read = profiler.counter("tokens");
+		auto& tokens_reloaded = profiler.counter("tokens_reloaded");
+		auto& cache_hits = profiler.counter("cache_hits");
+		profiler.add(profiler.counter("batches"), batches.size());
+
+		// stages after the batches don't need tokens, but if some does, the file is read and parsed again
+		corpus.set_tokens_loader(
+			[&content_parser, &corpus, &profiler, &tokens_reloaded](news_clustering::DocId doc)
+			{
+				profiler.add(tokens_reloaded, 1);
+				return content_parser.parse_content(content_parser.read_file(corpus.path(doc)), ' ', 1);
+			}
+		);
 
-	/// Name Entities recognition
+		auto dates_extractor = news_clustering::DatesExtractor(languages, language_boost_locales, day_names_path, month_names_path, today[2]);
+		auto news_detector = news_clustering::NewsDetector(languages, language_boost_locales, today);
 
-	if (mode == NEWS_MODE || mode == CATEGORIES_MODE || mode == THREAD_MODE || mode == TOP_MODE)
-	{
+		/// Hyperparams
+		// Language consts
+		size_t num_language_samples = 300;
+		double language_score_min_level = 0.1;
+		// News detection consts
+		int freshness_days = 180;
+		// entities are found only by the vocabs, so articles without them aren't dropped unless it is set in the "news" section of the config
+		std::size_t min_name_entities = config.value("news", json::object()).value("min_name_entities", (std::size_t) 0);
 
-		//std::cerr << "Name Entities recognition..." << std::endl;
+		std::unordered_map<news_clustering::Language, news_clustering::DocIds> found_languages;
+		std::vector<char> is_news(corpus.size(), false);
 
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
+		// documents with the same bytes as in the previous runs are taken from the cache and skip all per document stages
+		std::vector<std::uint64_t> content_keys(corpus.size());
+		std::vector<char> is_cached(corpus.size(), false);
+		// cached document is written again if its embedding or category was found in this run
+		auto cache_state = [&corpus](news_clustering::DocId doc)
+		{
+			return corpus.has_embedding(doc) * 2 + (corpus.categories[doc] != news_clustering::UNDEFINED_CATEGORY);
+		};
+		std::vector<char> cached_states(corpus.size(), 0);
 
-		//auto ner = news_clustering::NER(languages, text_embedders, language_boost_locales);
-		//auto ner_articles = ner.find_name_entities(selected_language_articles, selected_language_content);
+		Semaphore sem;
+		ThreadPool pool(concurentThreadsSupported);
+
+		for (const auto& batch : batches)
+		{
+			/// Load data
+
+			news_clustering::Profiler::Scope loading_scope("data loading");
+
+			// cache is read by the workers too, so a damaged record falls back to parsing like any other miss
+			std::vector<news_clustering::DocumentCache::Entry> cache_entries(batch.size());
+			for (std::size_t k = 0; k < batch.size(); k++)
+			{
+				auto i = batch[k];
+				pool.execute(
+					[i, k, &sem, &content_parser, &corpus, &profiler, &files_read, &bytes_read, &tokens_read, &cache, &content_keys, &is_cached, &cache_entries]()
+					{			
+						// file bytes are kept for the stages that need raw html, so every file is read only once
+						auto bytes = content_parser.read_file(corpus.path(i));
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "Name Entities recognition have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;
+						profiler.add(files_read, 1);
+						profiler.add(bytes_read, bytes.size());
 
+						if (cache)
+						{
+							content_keys[i] = news_clustering::xxh64(bytes.data(), bytes.size());
+							if (cache->find(content_keys[i], cache_entries[k]))
+							{
+								is_cached[i] = true;
+								sem.notify();
+								return;
+							}
+						}
 
-		/// Titles extracting
+						corpus.set_tokens(i, content_parser.parse_content(bytes, ' ', 1));
+						profiler.add(tokens_read, corpus.tokens(i).size());
 
-		//std::cerr << "Titles extracting..." << std::endl;
+						corpus.set_raw(i, std::move(bytes));
 
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
+						sem.notify();
+					}
+				);
+			}	
+			for (std::size_t k = 0; k < batch.size(); k++)
+			{
+				sem.wait();
+			}
 
-		auto title_extractor = news_clustering::TitleExtractor(language_boost_locales);
-		title_articles = title_extractor.find_titles(selected_language_articles);
+			// documents of the cache are restored here, columns like dates can't be filled from the different threads
+			news_clustering::DocIds batch_new_docs;
+			for (std::size_t k = 0; k < batch.size(); k++)
+			{
+				auto i = batch[k];
+				if (is_cached[i])
+				{
+					news_clustering::DocumentCache::restore(corpus, i, cache_entries[k]);
+					cached_states[i] = cache_state(i);
+					profiler.add(cache_hits, 1);
+				}
+				else
+				{
+					batch_new_docs.push_back(i);
+				}
+			}
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "Titles extracting have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;
+			loading_scope.stop();
 
 
-		/// Dates extracting
+			/// Language detection
 
-		//std::cerr << "Dates extracting..." << std::endl;
+			news_clustering::DocIds batch_language_docs; 
+			news_clustering::DocIds batch_new_language_docs; 
 
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
+			if (mode == LANGUAGES_MODE || mode == NEWS_MODE || mode == CATEGORIES_MODE || mode == THREAD_MODE || mode == TOP_MODE || mode == SHARD_MODE)
+			{
+				news_clustering::Profiler::Scope language_scope("language detection");
 
-		auto dates_extractor = news_clustering::DatesExtractor(languages, language_boost_locales, day_names_path, month_names_path, today[2]);
-		
-		found_dates = dates_extractor.find_dates(selected_language_articles, selected_language_content);
+				language_detector.detect_language(corpus, batch_new_docs, num_language_samples, language_score_min_level);			
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "Dates extracting have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;
-	}
+				// documents are grouped in the same order as language detector does it, together with the cached ones
+				std::unordered_map<news_clustering::Language, news_clustering::DocIds> batch_languages;
+				for (auto i : batch)
+				{
+					batch_languages[corpus.languages[i]].push_back(i);
+					if (corpus.languages[i].id() != news_clustering::UNKNOWN_LANGUAGE && !is_cached[i])
+					{
+						batch_new_language_docs.push_back(i);
+					}
+				}
 
+				// languages keep the order of the first batch
+				if (found_languages.empty())
+				{
+					found_languages = batch_languages;
+				}
+				else
+				{
+					for (auto i = batch_languages.begin(); i != batch_languages.end(); i++)
+					{
+						found_languages[i->first].insert(found_languages[i->first].end(), i->second.begin(), i->second.end());
+					}
+				}
 
-	/// News detection
+				for (auto i = batch_languages.begin(); i != batch_languages.end(); i++)
+				{		
+					// select only known languages
+					if (i->first.id() != news_clustering::UNKNOWN_LANGUAGE)
+					{	
+						batch_language_docs.insert(batch_language_docs.end(), i->second.begin(), i->second.end());
+					}			
+				}
+			}
 	
-	if (mode == NEWS_MODE || mode == CATEGORIES_MODE || mode == THREAD_MODE || mode == TOP_MODE)
-	{	
-		//std::cerr << "News detection..." << std::endl;  
 
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
-	
-		auto news_detector = news_clustering::NewsDetector(languages, language_boost_locales, today);
-		
-		/// Hyperparams
-		// News detection consts
-		int freshness_days = 180;
+			/// Name Entities recognition
+
+			if (mode == NEWS_MODE || mode == CATEGORIES_MODE || mode == THREAD_MODE || mode == TOP_MODE || mode == SHARD_MODE)
+			{
+				news_clustering::Profiler::Scope ner_scope("name entities recognition");
+
+				ner.find_name_entities(corpus, batch_new_language_docs, pool);
+
+				ner_scope.stop();
+
+
+				/// Titles extracting
+
+				news_clustering::Profiler::Scope titles_scope("titles extracting");
+
+				title_extractor.find_titles(corpus, batch_new_language_docs, pool);
+
+				titles_scope.stop();
+
+
+				/// Dates extracting
+
+				news_clustering::Profiler::Scope dates_scope("dates extracting");
+
+				dates_extractor.find_dates(corpus, batch_new_language_docs);
+
+				dates_scope.stop();
+
+
+				/// News detection
 	
-		auto news_articles = news_detector.detect_news(selected_language_articles, selected_language_content, found_dates, ner_articles, freshness_days); 
-		
-		std::size_t found_filename_start;
-		std::string filename;
+				news_clustering::Profiler::Scope news_scope("news detection");
 
-		// Prepare result
-		result = {		
-			{"articles", std::vector<std::string>()}
-		};
-		for (auto i = news_articles.begin(); i != news_articles.end(); i++) 
-		{ 
-			// select only news
-			if (i->first)
+				auto news_articles = news_detector.detect_news(corpus, batch_language_docs, freshness_days, min_name_entities); 
+
+				for (auto doc : news_articles[true])
+				{
+					is_news[doc] = true;
+				}
+
+				news_scope.stop();
+
+
+				/// Embeddings of the news are kept in the corpus for categorization and clustering
+
+				if (max_memory > 0 && (mode == CATEGORIES_MODE || mode == THREAD_MODE || mode == TOP_MODE || mode == SHARD_MODE))
+				{
+					news_clustering::Profiler::Scope embeddings_scope("embeddings");
+
+					for (auto doc : news_articles[true])
+					{
+						text_embedders[corpus.languages[doc]].embed(corpus, doc, language_boost_locales[corpus.languages[doc]]);
+					}
+				}
+			}
+
+			// raw html isn't needed after titles
+			for (auto i : batch)
+			{
+				corpus.release_raw(i);
+			}
+			if (max_memory > 0)
 			{
-				for (auto k : i->second)
+				corpus.release_tokens();
+			}
+		}
+		pool.close();
+
+		// documents of the each language go in order of ids, as if there were only one batch
+		for (auto i = found_languages.begin(); i != found_languages.end(); i++)
+		{		
+			if (i->first.id() != news_clustering::UNKNOWN_LANGUAGE)
+			{	
+				for (auto doc : i->second)
 				{
-					selected_news_articles[k] = selected_language_articles[k];
-					selected_news_content[k] = all_content[k];
+					selected_language_docs.push_back(doc);
+					if (is_news[doc])
+					{
+						selected_news_docs.push_back(doc);
+					}
+				}
+			}			
+		}
 
-					found_filename_start = k.find_last_of("/\\");
-					filename = k.substr(found_filename_start + 1);
-					result["articles"].push_back(filename);
+		// news of the cache can come without embeddings, they are embedded here with the tokens reloaded by the loader
+		// and released within the memory budget, so the stages below don't reload
+		if (max_memory > 0 && (mode == CATEGORIES_MODE || mode == THREAD_MODE || mode == TOP_MODE || mode == SHARD_MODE))
+		{
+			news_clustering::Profiler::Scope embeddings_scope("embeddings");
+
+			for (auto doc : selected_news_docs)
+			{
+				if (!corpus.has_embedding(doc))
+				{
+					text_embedders[corpus.languages[doc]].embed(corpus, doc, language_boost_locales[corpus.languages[doc]]);
+					if (corpus.tokens_bytes() > max_memory)
+					{
+						corpus.release_tokens();
+					}
 				}
-			}	
+			}
+			corpus.release_tokens();
 		}
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "News detection have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;  
+		if (mode == LANGUAGES_MODE)
+		{
+			writer.begin_array();
+			for (auto i = found_languages.begin(); i != found_languages.end(); i++)
+			{		
+				if (i->first.id() != news_clustering::UNKNOWN_LANGUAGE)
+				{	
+					writer.begin_object();
+					writer.key("articles");
+					writer.begin_array();
+					for (auto k : i->second)
+					{
+						writer.value(corpus.file_name(k));
+					}
+					writer.end_array();
+					writer.key("lang_code");
+					writer.value(i->first.to_string());
+					writer.end_object();
+				}			
+			}
+			writer.end_array();
+		}
 
 		if (mode == NEWS_MODE)
 		{
-			std::cout << result.dump(4, ' ', false, json::error_handler_t::replace) << std::endl;
+			writer.begin_object();
+			writer.key("articles");
+			writer.begin_array();
+			for (auto k : selected_news_docs)
+			{
+				writer.value(corpus.file_name(k));
+			}
+			writer.end_array();
+			writer.end_object();
 		}
-	}
 
 
-	/// Categorization
+		/// Categorization
 	
-	if (mode == CATEGORIES_MODE || mode == TOP_MODE)
-	{		
-		//std::cerr << "News categorization..." << std::endl;  
-	
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
+		if (mode == CATEGORIES_MODE || mode == TOP_MODE || mode == SHARD_MODE)
+		{		
+			news_clustering::Profiler::Scope categories_scope("categorization");
 	   	 
-		//auto categories_detector = news_clustering::CategoriesDetector(languages, text_embedders, word2vec_embedders, language_boost_locales, categories);
-		auto categories_detector = news_clustering::CategoriesDetector(languages, text_embedders, language_boost_locales, categories);
+			//auto categories_detector = news_clustering::CategoriesDetector(languages, text_embedders, word2vec_embedders, language_boost_locales, categories);
+			auto categories_detector = news_clustering::CategoriesDetector(languages, text_embedders, language_boost_locales, categories);
 	
-		/// Hyperparams
-		// Categories consts	
-		std::unordered_map<news_clustering::Language, std::vector<float>> category_detect_levels;
-		// society | economy | technology | sports | entertainment | science
-		category_detect_levels[english_language] = {0.02, 0.02, 0.02, 0.02, 0.02, 0.04};
-		category_detect_levels[russian_language] = {0.05, 0.02, 0.15, 0.02, 0.15, 0.15};
+			/// Hyperparams
+			// Categories consts	
+			std::unordered_map<news_clustering::Language, std::vector<float>> category_detect_levels;
+			// society | economy | technology | sports | entertainment | science
+			category_detect_levels[english_language] = {0.02, 0.02, 0.02, 0.02, 0.02, 0.04};
+			category_detect_levels[russian_language] = {0.05, 0.02, 0.15, 0.02, 0.15, 0.15};
+
+			// categories of the cached news are already known
+			news_clustering::DocIds uncategorized_docs;
+			for (auto doc : selected_news_docs)
+			{
+				if (corpus.categories[doc] == news_clustering::UNDEFINED_CATEGORY)
+				{
+					uncategorized_docs.push_back(doc);
+				}
+			}
 
-		auto categories_articles = categories_detector.detect_categories(selected_language_articles, selected_news_content, category_detect_levels); 
-	
-		std::size_t found_filename_start;
-		std::string filename;
+			categories_detector.detect_categories(corpus, uncategorized_docs, category_detect_levels); 
+
+			std::unordered_map<int, news_clustering::DocIds> categories_articles;
+			for (auto doc : selected_news_docs)
+			{
+				categories_articles[corpus.categories[doc]].push_back(doc);
+			}
 
-		result = json();
-		for (auto i = categories_articles.begin(); i != categories_articles.end(); i++) 
-		{ 
-			json category_item;			
-			if (i->first == -1)
+			categories_scope.stop();
+
+			if (mode == CATEGORIES_MODE)
 			{
-				category_item = {
-					{"category", "other"},
-					{"articles", std::vector<std::string>()}
-				};
+				writer.begin_array();
+				for (auto i = categories_articles.begin(); i != categories_articles.end(); i++) 
+				{ 
+					writer.begin_object();
+					writer.key("articles");
+					writer.begin_array();
+					for (auto k : i->second)
+					{	
+						writer.value(corpus.file_name(k));
+					}
+					writer.end_array();
+					writer.key("category");
+					writer.value(i->first == news_clustering::OTHER_CATEGORY ? std::string("other") : categories[english_language][i->first][0]);
+					writer.end_object();
+				}
+				writer.end_array();
 			}
-			else
+		}
+
+
+		/// Shard artifacts: news with everything threads and top need
+
+		if (mode == SHARD_MODE)
+		{
+			news_clustering::Profiler::Scope shard_scope("shard writing");
+
+			std::vector<std::uint32_t> news_indexes;
+			for (auto doc : selected_news_docs)
 			{
-				category_item = {
-					{"category", categories[english_language][i->first][0]},
-					{"articles", std::vector<std::string>()}
-				};
+				news_indexes.push_back(file_indexes[doc]);
 			}
-			for (auto k : i->second)
-			{	
-				if (i->first == -1)
+
+			std::error_code error;
+			std::filesystem::create_directories(shards_path, error);
+			auto shard_path = shards_path + "/" + news_clustering::ShardFile::file_name(shard, num_shards);
+			if (!news_clustering::ShardFile::write(shard_path, corpus, selected_news_docs, news_indexes, shard, num_shards))
+			{
+				return EXIT_FAILURE;
+			}
+		}
+
+
+		/// Merge of the shards: news of all shards are put to the one corpus in order of the files in the whole data
+
+		if (mode == MERGE_MODE)
+		{
+			news_clustering::Profiler::Scope merge_scope("shards merging");
+
+			std::vector<std::string> shard_paths;
+			std::error_code error;
+			for (const auto& entry : std::filesystem::directory_iterator(data_path, error))
+			{
+				if (entry.path().extension() == ".bin")
 				{
-					articles_by_category[k] = "other";
+					shard_paths.push_back(entry.path().string());
 				}
-				else
+			}
+			std::sort(shard_paths.begin(), shard_paths.end());
+
+			std::vector<news_clustering::ShardFile::Document> documents;
+			std::vector<char> shards_found;
+			for (const auto& shard_path : shard_paths)
+			{
+				news_clustering::ShardFile::Header header;
+				if (!news_clustering::ShardFile::read(shard_path, header, documents))
+				{
+					return EXIT_FAILURE;
+				}
+				if (shards_found.empty())
+				{
+					shards_found.resize(header.num_shards, false);
+				}
+				if (header.num_shards != shards_found.size() || shards_found[header.shard])
 				{
-					articles_by_category[k] = categories[english_language][i->first][0];
+					std::cerr << "Shard " << header.shard << "/" << header.num_shards << " doesn't match the other shards: " << shard_path << std::endl;
+					return EXIT_FAILURE;
 				}
-				found_filename_start = k.find_last_of("/\\");
-				filename = k.substr(found_filename_start + 1);
-				category_item["articles"].push_back(filename);
+				shards_found[header.shard] = true;
+			}
+			if (shards_found.empty() || std::find(shards_found.begin(), shards_found.end(), false) != shards_found.end())
+			{
+				std::cerr << "Not all shards are found in: " << data_path << std::endl;
+				return EXIT_FAILURE;
 			}
-			result.push_back(category_item);
-		}
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "News categorization have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;  
+			std::sort(documents.begin(), documents.end(), [](const auto& a, const auto& b) { return a.index < b.index; });
 
-		if (mode == CATEGORIES_MODE)
-		{
-			std::cout << result.dump(4, ' ', false, json::error_handler_t::replace) << std::endl;
+			// news are grouped by language the same way as language detection does it
+			std::unordered_map<news_clustering::Language, news_clustering::DocIds> news_languages;
+			for (const auto& document : documents)
+			{
+				auto doc = news_clustering::ShardFile::add(corpus, document);
+				news_languages[corpus.languages[doc]].push_back(doc);
+			}
+			for (auto i = news_languages.begin(); i != news_languages.end(); i++)
+			{
+				selected_news_docs.insert(selected_news_docs.end(), i->second.begin(), i->second.end());
+			}
 		}
-	}
 
 
-	/// Threads (similar news) clustering
+		/// Threads (similar news) clustering
 	
-	if (mode == THREAD_MODE || mode == TOP_MODE)
-	{	
-		//std::cerr << "Threads clustering..." << std::endl;  
-
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
+		if (mode == THREAD_MODE || mode == TOP_MODE || mode == MERGE_MODE)
+		{	
+			news_clustering::Profiler::Scope threads_scope("threads clustering");
 	   	 
-		//auto news_clusterizer = news_clustering::NewsClusterizer(languages, text_embedders, word2vec_embedders, language_boost_locales);
-		auto news_clusterizer = news_clustering::NewsClusterizer(languages, text_embedders, language_boost_locales);
-	
-		float eps = 12;
-		std::size_t minpts = 2;
-		clustered_articles = news_clusterizer.clusterize(selected_news_articles, selected_news_content, title_articles, eps, minpts); 
+			//auto news_clusterizer = news_clustering::NewsClusterizer(languages, text_embedders, word2vec_embedders, language_boost_locales);
+			auto news_clusterizer = news_clustering::NewsClusterizer(languages, text_embedders, language_boost_locales);
 	
-		std::size_t found_filename_start;
-		std::string filename;
-
-		result = json();
-		for (auto i = clustered_articles.begin(); i != clustered_articles.end(); i++) 
-		{ 
-			json thread_item = {
-				{"title", title_articles[i->first]}, 		
-				{"articles", std::vector<std::string>()}
-			};
-			for (auto k : i->second)
+			float eps = 12;
+			std::size_t minpts = 2;
+			// distance between articles with the same entities is reduced up to this part
+			float entity_weight = 0.5;
+			// entities that are mentioned in more articles don't generate candidates, can be overridden in the "threads" section of the config
+			std::size_t max_posting_size = config.value("threads", json::object()).value("max_posting_size", news_clustering::NewsClusterizer::DEFAULT_MAX_POSTING_SIZE);
+			threads = news_clusterizer.clusterize(corpus, selected_news_docs, eps, minpts, entity_weight, max_posting_size, min_thread_size); 
+			profiler.add(profiler.counter("threads_found"), threads.size());
+
+			threads_scope.stop();
+
+			if (mode == THREAD_MODE || (mode == MERGE_MODE && threads_output))
 			{
-				found_filename_start = k.find_last_of("/\\");
-				filename = k.substr(found_filename_start + 1);
-				thread_item["articles"].push_back(filename);
+				writer.begin_array();
+				for (std::size_t k = 0; k < threads.size(); k++) 
+				{ 
+					writer.begin_object();
+					writer.key("articles");
+					writer.begin_array();
+					for (auto doc : threads.thread(k))
+					{
+						writer.value(corpus.file_name(doc));
+					}
+					writer.end_array();
+					writer.key("title");
+					writer.value(corpus.title(threads.seeds[k]));
+					writer.end_object();
+				}
+				writer.end_array();
 			}
-			result.push_back(thread_item);
 		}
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "Threads clustering have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;  
 
-		if (mode == THREAD_MODE)
-		{
-			std::cout << result.dump(4, ' ', false, json::error_handler_t::replace) << std::endl;
-		}
-	}
+		/// News arrange by relevance
+	
+		if (mode == TOP_MODE || (mode == MERGE_MODE && !threads_output))
+		{		
+			news_clustering::Profiler::Scope top_scope("threads arranging");
+	   	 
+			/// Hyperparams
+			// ranking weights and priors can be overridden in the "ranking" section of the config
+			auto ranking_config = config.value("ranking", json::object());
+			auto weights_config = ranking_config.value("weights", json::object());
+			auto priors_config = ranking_config.value("category_priors", json::object());
+
+			news_clustering::RankingModel::Features ranking_weights;
+			for (std::size_t f = 0; f < news_clustering::RankingModel::NUM_FEATURES; f++)
+			{
+				ranking_weights[f] = weights_config.value(news_clustering::RankingModel::feature_name((news_clustering::RankingModel::Feature) f), 1.0f);
+			}
+			// more recent news are more important, points are halved every half_life_days
+			float half_life_days = ranking_config.value("half_life_days", 30.0f);
+			std::vector<float> category_priors;
+			for (const auto& category : categories[english_language])
+			{
+				category_priors.push_back(priors_config.value(category[0], 1.0f));
+			}
+			float other_prior = priors_config.value("other", 0.0f);
 
+			// only this number of the best threads is selected overall and for the each category, all by default
+			std::size_t top_threads = ranking_config.value("top_threads", threads.size());
 
-	/// News arrange by relevance
-	
-	if (mode == TOP_MODE)
-	{		
-		//std::cerr << "Threads arranging..." << std::endl;  
+			auto ranking_model = news_clustering::RankingModel(ranking_weights, half_life_days, category_priors, other_prior);
+			auto news_ranger = news_clustering::NewsRanger(languages, text_embedders, language_boost_locales, today, ranking_model);
 
-		t0 = std::chrono::steady_clock::now();
-		t1 = std::chrono::steady_clock::now();
-	   	 
-		auto news_ranger = news_clustering::NewsRanger(languages, text_embedders, language_boost_locales, today);
-	
-		auto ranged_articles = news_ranger.arrange(clustered_articles, found_dates, ner_articles); 
-		std::unordered_map<std::string, std::vector<std::unordered_map<std::string, std::vector<std::string>>>> ranged_articles_by_categories;
-	
-		std::size_t found_filename_start;
-		std::string filename;
+			// threads are referenced by index, nothing is copied while grouping
+			auto ranked_threads = news_ranger.arrange_top_k(corpus, threads, top_threads); 
 
-		result = json();
-		for (auto thread : ranged_articles)
-		{
-			for (auto i = thread.begin(); i != thread.end(); i++)
+			auto category_name = [&](int category)
 			{
-				ranged_articles_by_categories["any"].push_back(thread);
-				ranged_articles_by_categories[articles_by_category[i->first]].push_back(thread);
+				return category >= 0 ? categories[english_language][category][0] : std::string("other");
+			};
+
+			top_scope.stop();
+
+			auto write_thread = [&](std::size_t k, bool with_category)
+			{
+				writer.begin_object();
+				writer.key("articles");
+				writer.begin_array();
+				for (auto doc : threads.thread(k))
+				{
+					writer.value(corpus.file_name(doc));
+				}
+				writer.end_array();
+				if (with_category)
+				{
+					writer.key("category");
+					writer.value(category_name(ranked_threads.categories[k]));
+				}
+				writer.key("title");
+				writer.value(corpus.title(threads.seeds[k]));
+				writer.end_object();
+			};
+
+			writer.begin_array();
+
+			writer.begin_object();
+			writer.key("category");
+			writer.value("any");
+			writer.key("threads");
+			writer.begin_array();
+			for (auto k : ranked_threads.order)
+			{
+				write_thread(k, true);
 			}
+			writer.end_array();
+			writer.end_object();
+
+			for (std::size_t g = 0; g < ranked_threads.num_groups(); g++) 
+			{ 
+				writer.begin_object();
+				writer.key("category");
+				writer.value(category_name(ranked_threads.group_categories[g]));
+				writer.key("threads");
+				writer.begin_array();
+				for (auto k : ranked_threads.group(g))
+				{
+					write_thread(k, false);
+				}
+				writer.end_array();
+				writer.end_object();
+			}
+
+			writer.end_array();
 		}
-		for (auto i = ranged_articles_by_categories.begin(); i != ranged_articles_by_categories.end(); i++) 
-		{ 
-			json top_item = {
-				{"category", i->first}, 		
-				{"threads", std::vector<json>()}
-			};
-			for (auto k : i->second)
+	
+		/// Cache update, only after name entities, titles and dates were found
+
+		if (cache && mode != LANGUAGES_MODE)
+		{
+			news_clustering::Profiler::Scope cache_scope("cache writing");
+
+			for (news_clustering::DocId i = 0; i < corpus.size(); i++)
 			{
-				for (auto p = k.begin(); p != k.end(); p++)
+				if (!is_cached[i] || cached_states[i] != cache_state(i))
 				{
-					json thread_item;
-					if (i->first == "any")
-					{
-						thread_item = {
-							{"title", title_articles[p->first]}, 
-							{"category", ""}, 		
-							{"articles", std::vector<std::string>()}
-						};
-					}
-					else
-					{
-						thread_item = {
-							{"title", title_articles[p->first]}, 		
-							{"articles", std::vector<std::string>()}
-						};
-					}
-					for (auto h : p->second)
-					{
-						if (i->first == "any")
-						{
-							thread_item["category"] = articles_by_category[h];
-						}
-						found_filename_start = h.find_last_of("/\\");
-						filename = h.substr(found_filename_start + 1);
-						thread_item["articles"].push_back(filename);
-					}
-					top_item["threads"].push_back(thread_item);
+					cache->put(content_keys[i], corpus, i);
 				}
 			}
-			result.push_back(top_item);
+			cache->flush();
 		}
+	
 
-		t2 = std::chrono::steady_clock::now();
-		//std::cerr << "Threads arranging have finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t0).count()) / 1000000 << " s)" << std::endl;
-		//std::cerr << std::endl;  
+		return EXIT_SUCCESS;
+	};
 
-		if (mode == TOP_MODE)
+	if (watch)
+	{
+		// files are taken from the directory as they land, snapshot is written after every interval with changes
+		news_clustering::DirectoryWatcher watcher(data_path);
+		while (true)
 		{
-			std::cout << result.dump(4, ' ', false, json::error_handler_t::replace) << std::endl;
+			auto result = run_pipeline(watcher.files());
+			if (result != EXIT_SUCCESS)
+			{
+				return result;
+			}
+			// every snapshot has its own report and trace, events of the previous ones are dropped
+			if (profile)
+			{
+				writer.flush();
+				if (profile_report)
+				{
+					profiler.write_report(profile_path);
+				}
+				if (!trace_path.empty())
+				{
+					profiler.write_chrome_trace(trace_path);
+				}
+				profiler.reset();
+			}
+			while (!watcher.wait(std::chrono::seconds(watch_interval)))
+			{
+			}
 		}
 	}
+
+	auto result = run_pipeline(mode != MERGE_MODE ? content_parser.selectHtmlFiles(data_path) : std::vector<std::string>());
+	if (result != EXIT_SUCCESS)
+	{
+		return result;
+	}
 	
-	t2 = std::chrono::steady_clock::now();
-	//std::cerr << "Total time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t2 - total_start_time).count()) / 1000000 << " s" << std::endl;
+	if (profile)
+	{
+		writer.flush();
+		if (profile_report)
+		{
+			profiler.write_report(profile_path);
+		}
+		if (!trace_path.empty())
+		{
+			profiler.write_chrome_trace(trace_path);
+		}
+	}
 
     return 0;
 }
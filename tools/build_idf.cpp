@@ -0,0 +1,209 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <iostream>
+#include <fstream>
+#include <thread>
+
+#include "modules/content_parser.hpp"
+#include "modules/language_detector.hpp"
+#include "modules/text_embedding.hpp"
+
+#include "3rdparty/json.hpp"
+
+
+using json = nlohmann::json;
+
+////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    boost::locale::generator gen;
+	#if defined(__linux__)
+		std::locale ru_boost_locale = gen("ru_RU.UTF-8");
+		std::locale en_boost_locale = gen("en_US.UTF-8");
+	#endif
+
+	#if defined(_WIN64)
+		std::locale ru_boost_locale = gen("russian_russia.65001");
+		std::locale en_boost_locale = gen("english_us.65001");
+		std::locale ru_locale("russian_russia.65001");
+		std::locale::global(ru_locale);
+	#endif
+
+	/// arguments: directory with the corpus, config
+
+	std::string corpus_path;
+	std::string config_filename = "assets/default.cfg";
+
+	if (argc > 1)
+	{
+		corpus_path = argv[1];
+		std::cout << "Using data path: " << corpus_path << std::endl;
+	}
+	else
+	{
+		std::cout << "You haven't specified corpus path, pleaes specify path, f.e. build_idf DataClusteringSample assets/default.cfg" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (argc > 2)
+	{
+		config_filename = argv[2];
+	}
+
+	std::ifstream config_fin(config_filename, std::ifstream::in);
+	json config;
+	if (!config_fin.is_open())
+	{
+		std::cerr << "Cannot open config file: " << config_filename << std::endl;
+		return EXIT_FAILURE;
+	}
+	config_fin >> config;
+
+	auto content_parser = news_clustering::ContentParser();
+	unsigned num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	/// vocabs, the same as tgnews does
+
+	auto english_language = news_clustering::Language(news_clustering::ENGLISH_LANGUAGE);
+	auto russian_language = news_clustering::Language(news_clustering::RUSSIAN_LANGUAGE);
+	std::vector<news_clustering::Language> languages = { english_language, russian_language };
+	std::vector<std::string> config_keys = { "en", "ru" };
+
+	std::unordered_map<news_clustering::Language, std::locale> language_boost_locales;
+	language_boost_locales[english_language] = en_boost_locale;
+	language_boost_locales[russian_language] = ru_boost_locale;
+
+	std::unordered_map<news_clustering::Language, news_clustering::Lemmatizer> lemmatizers;
+	lemmatizers[english_language] = news_clustering::Lemmatizer();
+	lemmatizers[russian_language] = news_clustering::Lemmatizer(config["ru"]["lemmatizer"], russian_language, "_PROPN");
+
+	std::unordered_map<news_clustering::Language, news_clustering::TextEmbedder> text_embedders;
+	std::vector<std::string> top_freq_vocab_paths;
+	for (std::size_t i = 0; i < languages.size(); i++)
+	{
+		text_embedders[languages[i]] = news_clustering::TextEmbedder(config[config_keys[i]]["clusterizer"], lemmatizers[languages[i]], languages[i]);
+		top_freq_vocab_paths.push_back(config[config_keys[i]]["top_freq_words"]);
+	}
+
+	/// documents
+
+	news_clustering::Corpus corpus;
+	for (const auto& file_name : content_parser.selectHtmlFiles(corpus_path))
+	{
+		corpus.add(file_name);
+	}
+	std::cout << "documents: " << corpus.size() << std::endl;
+
+	std::vector<std::thread> workers;
+	for (unsigned w = 0; w < num_threads; w++)
+	{
+		workers.emplace_back(
+			[w, num_threads, &corpus, &content_parser]()
+			{
+				for (news_clustering::DocId i = w; i < corpus.size(); i += num_threads)
+				{
+					corpus.set_tokens(i, content_parser.parse_content(content_parser.read_file(corpus.path(i)), ' ', 1));
+				}
+			}
+		);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	auto language_detector = news_clustering::LanguageDetector(languages, top_freq_vocab_paths, language_boost_locales);
+	auto found_languages = language_detector.detect_language(corpus, corpus.ids(), 300, 0.1);
+
+	/// document frequency of the clusters, the each language is written to its own vocab
+
+	for (std::size_t i = 0; i < languages.size(); i++)
+	{
+		auto& language = languages[i];
+		auto& text_embedder = text_embedders[language];
+		const auto& docs = found_languages[language];
+		std::string vocab_file_name = config[config_keys[i]]["clusterizer"];
+		if (text_embedder.vocab_clusters.empty())
+		{
+			continue;
+		}
+		if (docs.empty())
+		{
+			std::cout << language.to_string() << ": no documents, IDF is not computed" << std::endl;
+			continue;
+		}
+
+		std::vector<std::size_t> document_frequency(text_embedder.num_clusters, 0);
+		for (auto doc : docs)
+		{
+			auto histogram = text_embedder(corpus.tokens(doc), language_boost_locales[language], false);
+			for (std::size_t c = 0; c < histogram.size(); c++)
+			{
+				document_frequency[c] += histogram[c];
+			}
+		}
+
+		// smoothed, so clusters that are not found get the highest weight and the common ones are not zeroed
+		std::vector<float> idf(text_embedder.num_clusters);
+		for (std::size_t c = 0; c < idf.size(); c++)
+		{
+			idf[c] = std::log(float(docs.size() + 1) / (document_frequency[c] + 1)) + 1;
+		}
+
+		// write: the original vocab as it is and the IDF table as the last line
+
+		std::size_t pos = vocab_file_name.find(".bin");
+		std::string idf_file_name = vocab_file_name.substr(0, pos) + "-idf.bin";
+
+		std::ifstream file_reader(vocab_file_name, std::ios::binary);
+		std::string vocab((std::istreambuf_iterator<char>(file_reader)), std::istreambuf_iterator<char>());
+		file_reader.close();
+
+		// header and the rows only, so the table of the vocab that already has one is replaced
+		std::size_t vocab_end = 0;
+		long long original_vocab_size = std::atoll(vocab.c_str());
+		for (long long line = 0; line <= original_vocab_size && vocab_end != std::string::npos; line++)
+		{
+			vocab_end = vocab.find('\n', vocab_end);
+			vocab_end = vocab_end == std::string::npos ? vocab_end : vocab_end + 1;
+		}
+		if (vocab_end != std::string::npos)
+		{
+			vocab.resize(vocab_end);
+		}
+		else if (vocab.back() != '\n')
+		{
+			vocab += '\n';
+		}
+
+		std::ofstream file_writer(idf_file_name, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!file_writer.is_open())
+		{
+			std::cerr << "Cannot open file: " << idf_file_name << std::endl;
+			return EXIT_FAILURE;
+		}
+		file_writer << vocab << "idf";
+		for (auto value : idf)
+		{
+			file_writer << ' ' << value;
+		}
+		file_writer << '\n';
+		file_writer.close();
+
+		std::cout << language.to_string() << ": " << docs.size() << " documents, written: " << idf_file_name << std::endl;
+	}
+
+	std::cout << "Set the written vocabs as \"clusterizer\" of the config to cluster by the weighted histograms" << std::endl;
+
+	return 0;
+}
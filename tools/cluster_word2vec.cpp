@@ -6,11 +6,13 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 Copyright (c) 2019 Stepan Mamontov (Panda Team)
 */
 
-#include <unordered_map>
 #include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
 
-#include "metric/modules/mapping.hpp"
-#include "metric/modules/distance.hpp"
+#include "metric/modules/mapping/kmeans_engine.hpp"
+#include "modules/word2vec_file.hpp"
 
 
 
@@ -26,15 +28,13 @@ int main(int argc, char *argv[])
 	std::cout << std::endl;
 	
 	std::vector<std::string> words;
-	std::vector<float> embedding;
-	std::vector<std::vector<float>> embeddings;	
-	std::unordered_map<std::string, std::vector<float>> vocab;
+	// row-major words x dimensions
+	std::vector<float> embeddings;
 	
-	std::string string_for_read;
-	float value;
 	long long original_vocab_size, embedding_dimensions;
 
 	long long num_clusters;
+	std::size_t batch_size = 0;
 	
 	std::string original_file_name;
 
@@ -61,36 +61,38 @@ int main(int argc, char *argv[])
 		std::cout << "You haven't specified clusters number, pleaes specify it" << std::endl;  
 		return EXIT_FAILURE;
 	}
+
+	if (argc > 3)
+	{
+		// very big vocabs are clustered by mini-batches
+		batch_size = std::atoll(argv[3]);
+		std::cout << "Mini-batch size: " << batch_size << std::endl;  
+	}
 	std::cout << std::endl;
 
 
 	// read
 		
-	std::ifstream file_reader;
-	
-	file_reader.open(original_file_name, std::ios::binary | std::ios::out);	
-	
-	file_reader >> original_vocab_size >> embedding_dimensions;	
-	getline(file_reader, string_for_read);
+	news_clustering::Word2VecReader reader(original_file_name);
+	if (!reader.is_open())
+	{
+		return EXIT_FAILURE;
+	}
+	original_vocab_size = reader.size();
+	embedding_dimensions = reader.dimensions();
 	std::cout << "vocab size: " << original_vocab_size << " embedding dimensions: " << embedding_dimensions << std::endl;
-	for (auto i = 0; i < original_vocab_size; i++)
+	embeddings.resize(original_vocab_size * embedding_dimensions);
+	news_clustering::Word2VecReader::Row row;
+	for (auto i = 0; i < original_vocab_size && reader.next(row); i++)
 	{
-		getline(file_reader, string_for_read, ' ');
-		words.push_back(string_for_read);
-		embedding.clear();
-
-		for (auto j = 0; j < embedding_dimensions; j++)
-		{
-			file_reader.read(reinterpret_cast<char*>(&value), sizeof(float));
-			embedding.push_back(value);
-		}
-		embeddings.push_back(embedding);
-
-		vocab[words[i]] = embedding;
+		words.emplace_back(row.word);
+		row.copy_to(&embeddings[i * embedding_dimensions]);
 		
 		if ((i + 1) % 10000 == 0) std::cout << "progress: " << (i + 1) << " from " << original_vocab_size << std::endl;
 	}
-	file_reader.close();
+	// cut file keeps the rows that were read
+	original_vocab_size = words.size();
+	embeddings.resize(original_vocab_size * embedding_dimensions);
 	
 	std::cout << "reading finished" << std::endl;
 	std::cout << std::endl;
@@ -103,7 +105,11 @@ int main(int argc, char *argv[])
 	auto t0 = std::chrono::steady_clock::now();
 	auto t1 = std::chrono::steady_clock::now();
 
-	auto[assignments, means, counts] = metric::kmeans(embeddings, num_clusters, 200, "cosine"); // clusters the data in num_clusters groups.
+	metric::kmeans_engine::Options options;
+	options.batch_size = batch_size;
+	auto[assignments, means, counts] = batch_size > 0 ?
+		metric::kmeans_engine::mini_batch<metric::kmeans_engine::Spherical>(embeddings, embedding_dimensions, num_clusters, options) :
+		metric::kmeans_engine::lloyd<metric::kmeans_engine::Spherical>(embeddings, embedding_dimensions, num_clusters, options);
 
 
 	std::vector<std::vector<std::string>> clusters(num_clusters);
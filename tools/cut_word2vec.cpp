@@ -10,11 +10,10 @@ Copyright (c) 2019 Stepan Mamontov (Panda Team)
 #include <stdlib.h>
 #include <vector>
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <unordered_map>
 #include <algorithm>
-#include "metric/modules/distance.hpp"
+#include <cmath>
+#include "modules/word2vec_file.hpp"
 
 
 int main(int argc, char *argv[]) 
@@ -28,15 +27,6 @@ int main(int argc, char *argv[])
 	std::cout << "Cutting vocab have started" << std::endl;
 	std::cout << std::endl;
 	
-	std::string string_for_read;
-	float value;
-	long long original_vocab_size, embedding_dimensions;
-	
-	std::vector<std::string> words;
-	std::vector<float> embedding;
-	std::vector<std::vector<float>> embeddings;	
-	std::unordered_map<std::string, std::vector<float>> vocab;
-
 	long long cut_vocab_size;
 	std::string original_file_name;
 
@@ -72,84 +62,59 @@ int main(int argc, char *argv[])
 
 	std::cout << "cutting started..." << std::endl;
 
-	
-	std::ifstream file_reader;
-	std::ofstream file_writer;
-	
-	file_reader.open(original_file_name, std::ios::binary | std::ios::out);	
-	file_writer.open(cut_file_name, std::ios::binary | std::ios::out);	
-	
-	file_reader >> original_vocab_size >> embedding_dimensions;	
-	getline(file_reader, string_for_read);
-	file_writer << cut_vocab_size << " " << embedding_dimensions << "\n";	
-	std::cout << "original vocab size: " << original_vocab_size << " cut vocab size: " << cut_vocab_size << " embedding dimension: " << embedding_dimensions << std::endl;
-	for (auto i = 0; i < cut_vocab_size; i++)
+	// rows are copied from the mapped file to the buffered writer, nothing is kept in memory
+	news_clustering::Word2VecReader reader(original_file_name);
+	if (!reader.is_open())
 	{
-		getline(file_reader, string_for_read, ' ');
-		if(i < 100) std::cout << string_for_read << " ";
-		file_writer << string_for_read << ' ';	
+		return EXIT_FAILURE;
+	}
+	cut_vocab_size = std::min<long long>(cut_vocab_size, reader.size());
+	news_clustering::Word2VecWriter writer(cut_file_name, cut_vocab_size, reader.dimensions());
+	if (!writer.is_open())
+	{
+		return EXIT_FAILURE;
+	}
 
-		for (auto j = 0; j < embedding_dimensions; j++)
-		{
-			file_reader.read(reinterpret_cast<char*>(&value), sizeof(float));
-			//std::cout << value << " ";
-			file_writer.write(reinterpret_cast<char*>(&value), sizeof(float));
-		}
+	std::cout << "original vocab size: " << reader.size() << " cut vocab size: " << cut_vocab_size << " embedding dimension: " << reader.dimensions() << std::endl;
+	news_clustering::Word2VecReader::Row row;
+	for (auto i = 0; i < cut_vocab_size && reader.next(row); i++)
+	{
+		if(i < 100) std::cout << row.word << " ";
+		writer.write(row);
 
 		if ((i + 1) % 10000 == 0) std::cout << "progress: " << (i + 1) << " from " << cut_vocab_size << std::endl;
-
 	}
 	
-	file_reader.close();
-	file_writer.close();
+	if (!writer.close())
+	{
+		std::cerr << "Cannot write file: " << cut_file_name << std::endl;
+		return EXIT_FAILURE;
+	}
 
 	std::cout << "cutting finished" << std::endl;
 	std::cout << std::endl;
+	std::cout << std::endl;
+	std::cout << std::endl;
 
 
-	// check first 100 words	
-	
-	std::cout << "checking started..." << std::endl;	
-	
-	std::ifstream file_again_reader;
-	
-	file_again_reader.open(cut_file_name, std::ios::binary | std::ios::out);	
-	
-	file_again_reader >> original_vocab_size >> embedding_dimensions;	
-	getline(file_again_reader, string_for_read);
-	std::cout << "vocab size: " << original_vocab_size << " embedding dimension: " << embedding_dimensions << std::endl;
-	for (auto i = 0; i < original_vocab_size; i++)
-	{
-		getline(file_again_reader, string_for_read, ' ');
-		if(i < 100) std::cout << string_for_read << " ";
-		words.push_back(string_for_read);
-		embedding.clear();
+	// closest words are found by a pass over the cut vocab, it is mapped and not loaded
 
-		for (auto j = 0; j < embedding_dimensions; j++)
+	news_clustering::Word2VecReader cut_reader(cut_file_name);
+	if (!cut_reader.is_open() || cut_reader.size() < 3)
+	{
+		return EXIT_FAILURE;
+	}
+	std::vector<float> input_embedding(cut_reader.dimensions());
+	std::vector<float> embedding(cut_reader.dimensions());
+	auto norm = [](const std::vector<float>& values)
+	{
+		float sum = 0;
+		for (auto value : values)
 		{
-			file_again_reader.read(reinterpret_cast<char*>(&value), sizeof(float));
-			//std::cout << value << " ";
-			embedding.push_back(value);
+			sum += value * value;
 		}
-		embeddings.push_back(embedding);
-
-		vocab[words[i]] = embedding;
-
-		//if ((i + 1) % 10000 == 0) std::cout << "progress: " << (i + 1) << " from " << cut_vocab_size << std::endl;
-
-	}
-	
-	file_again_reader.close();
-	
-	std::cout << std::endl;
-	std::cout << "checking finished" << std::endl;
-
-	std::cout << std::endl;
-	std::cout << std::endl;
-	std::cout << std::endl;
-	
-	
-
+		return std::sqrt(sum);
+	};
 
 	std::string input = "";
 	while (input != "exit")
@@ -157,41 +122,52 @@ int main(int argc, char *argv[])
 		std::cout << "Type word:" << std::endl;
 		if (input == "")
 		{
-			input = words[2];
+			cut_reader.rewind();
+			for (auto i = 0; i < 3 && cut_reader.next(row); i++)
+			{
+				input = row.word;
+			}
 		}
-		else
+		else if (!std::getline(std::cin, input))
 		{
-			std::getline(std::cin, input);
+			break;
 		}
 		std::cout << std::endl;
 		std::cout << "Entered word: " << input << '\n';
 
-		//std::vector<std::string>::iterator it = std::find(words.begin(), words.end(), input);
-
-		if (vocab.find(input) != vocab.end())
+		bool found = false;
+		cut_reader.rewind();
+		while (!found && cut_reader.next(row))
 		{
-			std::vector<float> input_embedding = vocab[input];
-
-			auto cosineDistance = metric::Cosine<double>();
-
-			std::unordered_map<std::string, float> distances;
-			for (auto it = vocab.begin(); it != vocab.end(); ++it)
+			if (row.word == input)
 			{
-				distances[it->first] = cosineDistance(input_embedding, it->second);
+				row.copy_to(input_embedding.data());
+				found = true;
 			}
+		}
 
-			using pair = std::pair<std::string, float>;
-			// create a empty vector of pairs
+		if (found)
+		{
+			using pair = std::pair<std::string_view, float>;
 			std::vector<pair> vec;
+			float input_norm = norm(input_embedding);
 
-			// copy key-value pairs from the map to the vector
-			std::copy(distances.begin(),
-				distances.end(),
-				std::back_inserter<std::vector<pair>>(vec));
+			cut_reader.rewind();
+			while (cut_reader.next(row))
+			{
+				row.copy_to(embedding.data());
+				float dot = 0;
+				for (std::size_t j = 0; j < embedding.size(); j++)
+				{
+					dot += input_embedding[j] * embedding[j];
+				}
+				vec.emplace_back(row.word, dot / (input_norm * norm(embedding)));
+			}
 
-			// sort the vector by increasing order of its pair's second value
+			// sort the vector by decreasing order of its pair's second value
 			// if second value are equal, order by the pair's first value
-			std::sort(vec.begin(), vec.end(),
+			auto num_closest = std::min<std::size_t>(100, vec.size());
+			std::partial_sort(vec.begin(), vec.begin() + num_closest, vec.end(),
 				[](const pair& l, const pair& r) {
 				if (l.second != r.second)
 					return l.second > r.second;
@@ -200,7 +176,7 @@ int main(int argc, char *argv[])
 			});
 
 			// print the vector
-			for (size_t i = 0; i < 100; i++)
+			for (size_t i = 0; i < num_closest; i++)
 			{
 				std::cout << vec[i].first << " = " << vec[i].second << '\n';
 			}
@@ -0,0 +1,270 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#include "metric/modules/mapping/kmeans_engine.hpp"
+#include "modules/word2vec_file.hpp"
+#include "modules/word_vectors.hpp"
+
+
+namespace {
+
+	// codebooks are trained on the first (most frequent) words, the rest are only encoded
+	const std::size_t TRAINING_WORDS = 100000;
+	// words encoded at once by all the threads
+	const std::size_t ENCODING_BATCH = 65536;
+
+
+	void normalize(float* values, std::size_t size)
+	{
+		float norm = 0;
+		for (std::size_t j = 0; j < size; j++)
+		{
+			norm += values[j] * values[j];
+		}
+		norm = std::sqrt(norm);
+		if (norm > 0)
+		{
+			for (std::size_t j = 0; j < size; j++)
+			{
+				values[j] /= norm;
+			}
+		}
+	}
+
+
+	// index of the closest centroid of the each subspace
+	void encode(const float* vector, const std::vector<float>& codebooks, std::size_t subspaces, std::size_t subspace_dimensions, std::uint8_t* codes)
+	{
+		for (std::size_t m = 0; m < subspaces; m++)
+		{
+			const float* part = vector + m * subspace_dimensions;
+			float closest_distance = std::numeric_limits<float>::max();
+			for (std::size_t c = 0; c < news_clustering::WordVectors::CENTROIDS; c++)
+			{
+				const float* centroid = &codebooks[(m * news_clustering::WordVectors::CENTROIDS + c) * subspace_dimensions];
+				float distance = 0;
+				for (std::size_t j = 0; j < subspace_dimensions; j++)
+				{
+					float delta = part[j] - centroid[j];
+					distance += delta * delta;
+				}
+				if (distance < closest_distance)
+				{
+					closest_distance = distance;
+					codes[m] = (std::uint8_t) c;
+				}
+			}
+		}
+	}
+
+}  // namespace
+
+
+int main(int argc, char *argv[])
+{
+    // Create system default locale
+	#if defined(_WIN64)
+		std::locale ru_locale("russian_russia.65001");
+		std::locale::global(ru_locale);
+	#endif
+
+	std::cout << "Quantization have started" << std::endl;
+	std::cout << std::endl;
+
+	std::string original_file_name;
+	std::size_t subspaces = 0;
+
+	//
+
+	if (argc > 1)
+	{
+		original_file_name = argv[1];
+		std::cout << "Using data path: " << original_file_name << std::endl;
+	}
+	else
+	{
+		std::cout << "You haven't specified original vocab path, pleaes specify path" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	news_clustering::Word2VecReader reader(original_file_name);
+	if (!reader.is_open())
+	{
+		return EXIT_FAILURE;
+	}
+	std::size_t dimensions = reader.dimensions();
+
+	if (argc > 2)
+	{
+		subspaces = std::atoll(argv[2]);
+	}
+	else
+	{
+		// 4 dimensions per byte by default
+		subspaces = std::max<std::size_t>(dimensions / 4, 1);
+	}
+	if (subspaces == 0 || dimensions % subspaces != 0)
+	{
+		std::cout << "Number of subspaces should divide embedding dimensions: " << dimensions << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::size_t subspace_dimensions = dimensions / subspaces;
+	std::cout << "vocab size: " << reader.size() << " embedding dimensions: " << dimensions << " subspaces: " << subspaces << std::endl;
+	std::cout << std::endl;
+
+
+	// train
+
+	std::cout << "training started..." << std::endl;
+	auto t0 = std::chrono::steady_clock::now();
+
+	std::vector<float> training_vectors;
+	news_clustering::Word2VecReader::Row row;
+	std::size_t num_training_words = 0;
+	while (num_training_words < TRAINING_WORDS && reader.next(row))
+	{
+		training_vectors.resize((num_training_words + 1) * dimensions);
+		row.copy_to(&training_vectors[num_training_words * dimensions]);
+		normalize(&training_vectors[num_training_words * dimensions], dimensions);
+		num_training_words++;
+	}
+	if (num_training_words < news_clustering::WordVectors::CENTROIDS)
+	{
+		std::cout << "Vocab should have at least " << news_clustering::WordVectors::CENTROIDS << " words" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<float> codebooks(subspaces * news_clustering::WordVectors::CENTROIDS * subspace_dimensions);
+	std::vector<float> part(num_training_words * subspace_dimensions);
+	metric::kmeans_engine::Options options;
+	options.max_iterations = 50;
+	for (std::size_t m = 0; m < subspaces; m++)
+	{
+		for (std::size_t i = 0; i < num_training_words; i++)
+		{
+			std::copy_n(&training_vectors[i * dimensions + m * subspace_dimensions], subspace_dimensions, &part[i * subspace_dimensions]);
+		}
+		auto result = metric::kmeans_engine::lloyd<metric::kmeans_engine::Euclidian>(part, subspace_dimensions, news_clustering::WordVectors::CENTROIDS, options);
+		std::copy(result.means.begin(), result.means.end(), &codebooks[m * news_clustering::WordVectors::CENTROIDS * subspace_dimensions]);
+
+		if ((m + 1) % 10 == 0) std::cout << "progress: " << (m + 1) << " from " << subspaces << std::endl;
+	}
+	training_vectors = std::vector<float>();
+	part = std::vector<float>();
+
+	auto t1 = std::chrono::steady_clock::now();
+	std::cout << "training finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()) / 1000000 << " s)" << std::endl;
+	std::cout << std::endl;
+
+
+	// encode
+
+	std::cout << "encoding started..." << std::endl;
+
+	std::vector<std::string> words;
+	std::vector<std::uint8_t> codes;
+	std::vector<float> batch;
+	unsigned num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	reader.rewind();
+	while (true)
+	{
+		// rows are streamed from the mapped file by batches
+		std::size_t first_word = words.size();
+		batch.clear();
+		while (batch.size() < ENCODING_BATCH * dimensions && reader.next(row))
+		{
+			words.emplace_back(row.word);
+			batch.resize(batch.size() + dimensions);
+			row.copy_to(&batch[batch.size() - dimensions]);
+		}
+		std::size_t batch_size = batch.size() / dimensions;
+		if (batch_size == 0)
+		{
+			break;
+		}
+		codes.resize(words.size() * subspaces);
+
+		std::vector<std::thread> workers;
+		for (unsigned t = 0; t < num_threads; t++)
+		{
+			workers.emplace_back(
+				[&, t]()
+				{
+					for (auto i = t; i < batch_size; i += num_threads)
+					{
+						normalize(&batch[i * dimensions], dimensions);
+						encode(&batch[i * dimensions], codebooks, subspaces, subspace_dimensions, &codes[(first_word + i) * subspaces]);
+					}
+				}
+			);
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		std::cout << "progress: " << words.size() << " from " << reader.size() << std::endl;
+	}
+
+	t0 = std::chrono::steady_clock::now();
+	std::cout << "encoding finished (Time = " << double(std::chrono::duration_cast<std::chrono::microseconds>(t0 - t1).count()) / 1000000 << " s)" << std::endl;
+	std::cout << std::endl;
+
+
+	// write
+
+	std::size_t pos = original_file_name.find(".bin");
+	std::string quantized_file_name = original_file_name.substr(0, pos) + "-" + std::to_string(subspaces) + "-subspaces.pq";
+	if (!news_clustering::WordVectors::write(quantized_file_name, words, dimensions, subspaces, codebooks, codes))
+	{
+		return EXIT_FAILURE;
+	}
+	std::cout << "written: " << quantized_file_name << " (" << double(std::filesystem::file_size(quantized_file_name)) / (1 << 20) << " MB)" << std::endl;
+
+
+	// check: closest words of the first words by the quantized vectors
+
+	news_clustering::WordVectors vectors(quantized_file_name);
+	if (!vectors.is_open())
+	{
+		return EXIT_FAILURE;
+	}
+	std::vector<news_clustering::WordVectors::WordId> ids(vectors.size());
+	for (std::size_t i = 0; i < ids.size(); i++)
+	{
+		ids[i] = (news_clustering::WordVectors::WordId) i;
+	}
+	std::vector<float> distances;
+	for (std::size_t i = 0; i < std::min<std::size_t>(3, words.size()); i++)
+	{
+		auto query = vectors.query(vectors.find(words[i]));
+		vectors.cosine_distances(query, ids, distances);
+		std::vector<std::size_t> order(ids.size());
+		for (std::size_t j = 0; j < order.size(); j++)
+		{
+			order[j] = j;
+		}
+		auto num_closest = std::min<std::size_t>(10, order.size());
+		std::partial_sort(order.begin(), order.begin() + num_closest, order.end(), [&distances](std::size_t a, std::size_t b) { return distances[a] < distances[b]; });
+		std::cout << words[i] << ": ";
+		for (std::size_t j = 0; j < num_closest; j++)
+		{
+			std::cout << vectors.word(ids[order[j]]) << " = " << 1 - distances[order[j]] << (j + 1 < num_closest ? ", " : "\n");
+		}
+	}
+
+	return 0;
+}
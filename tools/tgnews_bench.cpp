@@ -0,0 +1,499 @@
+/*
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Copyright (c) 2019 Stepan Mamontov (Panda Team)
+*/
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <random>
+#include <ctime>
+#if defined(__linux__)
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
+#include "metric/modules/utils/ThreadPool.cpp"
+#include "modules/language_detector.hpp"
+#include "modules/name_entities_recognizer.hpp"
+#include "modules/news_detector.hpp"
+#include "modules/categories_detector.hpp"
+#include "modules/news_clusterizer.hpp"
+#include "modules/news_ranger.hpp"
+
+#include "3rdparty/json.hpp"
+
+
+using json = nlohmann::json;
+
+namespace fs = std::filesystem;
+
+////////////////////////////
+
+struct StageResult
+{
+	std::string name;
+	double seconds;
+	std::size_t docs;
+	std::size_t bytes;
+	// change of the current RSS over the stage, memory freed inside the stage isn't seen
+	long rss_delta_kb;
+	// peak of the whole process so far, not of the stage
+	long peak_rss_kb;
+};
+
+
+long peak_rss_kb()
+{
+	#if defined(__linux__)
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss;
+	#else
+		return 0;
+	#endif
+}
+
+
+long current_rss_kb()
+{
+	#if defined(__linux__)
+		long size = 0;
+		long resident = 0;
+		std::ifstream statm("/proc/self/statm");
+		statm >> size >> resident;
+		return resident * (sysconf(_SC_PAGESIZE) / 1024);
+	#else
+		return 0;
+	#endif
+}
+
+
+template <typename F>
+StageResult measure(const std::string& name, std::size_t docs, std::size_t bytes, F stage)
+{
+	auto start_rss_kb = current_rss_kb();
+	auto start = std::chrono::steady_clock::now();
+	stage();
+	auto end = std::chrono::steady_clock::now();
+
+	return { name, std::chrono::duration<double>(end - start).count(), docs, bytes, current_rss_kb() - start_rss_kb, peak_rss_kb() };
+}
+
+
+struct GeneratorVocab
+{
+	// frequent words make the text detectable by the language detector
+	std::vector<std::string> frequent;
+	std::vector<std::string> words;
+	// written capitalized, so they are found by the NER
+	std::vector<std::string> names;
+	std::vector<std::string> month_names;
+};
+
+
+// vocab words that can be written as a single token of the text
+GeneratorVocab generator_vocab(
+	news_clustering::TextEmbedder& embedder,
+	const news_clustering::Language& language,
+	const std::locale& locale,
+	const std::string& top_freq_words_path,
+	const std::string& month_names_path
+)
+{
+	news_clustering::ContentParser content_parser;
+	GeneratorVocab vocab;
+	std::string word;
+
+	vocab.frequent = content_parser.parse_by_lines(top_freq_words_path, locale);
+	vocab.month_names = content_parser.parse_by_lines(month_names_path, locale);
+
+	for (auto w = embedder.vocab_clusters.begin(); w != embedder.vocab_clusters.end(); w++)
+	{
+		word = w->first;
+		if (word.empty() || word.find_first_of(":#</>&\"") != std::string::npos)
+		{
+			continue;
+		}
+		if (language.id() == news_clustering::RUSSIAN_LANGUAGE)
+		{
+			// lemmatized vocab, f.e. год_NOUN
+			auto suffix_start = word.rfind('_');
+			if (suffix_start == std::string::npos || suffix_start == 0 || word.compare(suffix_start, std::string::npos, "_NUM") == 0)
+			{
+				continue;
+			}
+			bool is_name = word.compare(suffix_start, std::string::npos, "_PROPN") == 0;
+			word.resize(suffix_start);
+			if (is_name)
+			{
+				vocab.names.push_back(boost::locale::to_title(word, locale));
+				continue;
+			}
+		}
+		else
+		{
+			if (word.find('_') != std::string::npos)
+			{
+				continue;
+			}
+			// capitalized word that is never written in lower case
+			auto lower = boost::locale::to_lower(word, locale);
+			if (lower != word && word.size() > 1 && embedder.vocab_clusters.find(lower) == embedder.vocab_clusters.end())
+			{
+				vocab.names.push_back(word);
+				continue;
+			}
+		}
+		vocab.words.push_back(word);
+	}
+
+	// sorted, so the corpus is the same from run to run
+	std::sort(vocab.words.begin(), vocab.words.end());
+	std::sort(vocab.names.begin(), vocab.names.end());
+
+	return vocab;
+}
+
+
+// news like html: articles of the same topic share words and names, title and site name are in the open graph tags, today date is in the text
+void generate_corpus(
+	const std::string& path,
+	std::size_t num_docs,
+	const std::vector<news_clustering::Language>& languages,
+	std::unordered_map<news_clustering::Language, GeneratorVocab>& vocabs,
+	const std::vector<int>& today
+)
+{
+	const std::size_t docs_per_dir = 1000;
+	const std::size_t topic_words = 50;
+	const std::size_t topic_names = 5;
+	const std::size_t num_sites = 100;
+
+	std::size_t num_topics = std::max<std::size_t>(1, num_docs / 20);
+
+	std::mt19937 generator(42);
+	std::string text;
+
+	for (std::size_t i = 0; i < num_docs; i++)
+	{
+		auto language = languages[i % languages.size()];
+		auto& vocab = vocabs[language];
+		auto topic = generator() % num_topics;
+		auto words_start = (topic * 7919) % (vocab.words.size() - topic_words);
+		auto names_start = (topic * 104729) % (vocab.names.size() - topic_names);
+		auto num_words = 150 + generator() % 250;
+
+		auto next_word = [&]() -> const std::string&
+		{
+			auto kind = generator() % 10;
+			if (kind < 3)
+			{
+				return vocab.frequent[generator() % vocab.frequent.size()];
+			}
+			if (kind < 8)
+			{
+				return vocab.words[words_start + generator() % topic_words];
+			}
+			if (kind < 9)
+			{
+				return vocab.names[names_start + generator() % topic_names];
+			}
+			return vocab.words[generator() % vocab.words.size()];
+		};
+
+		std::string title;
+		for (auto k = 0; k < 8; k++)
+		{
+			title += (k > 0 ? " " : "") + next_word();
+		}
+
+		text.clear();
+		for (std::size_t k = 0; k < num_words; k++)
+		{
+			if (k == num_words / 3)
+			{
+				text += std::to_string(today[0]) + " " + vocab.month_names[today[1] - 1] + " " + std::to_string(today[2]) + " ";
+			}
+			text += next_word();
+			text += (k % 20 == 19) ? ".\n" : " ";
+		}
+
+		auto dir = path + "/" + std::to_string(i / docs_per_dir);
+		if (i % docs_per_dir == 0)
+		{
+			fs::create_directories(dir);
+		}
+
+		std::ofstream file(dir + "/" + std::to_string(i) + ".html", std::ios::binary);
+		file << "<!DOCTYPE html>\n<html>\n<head>\n"
+			<< "<meta property=\"og:title\" content=\"" << title << "\"/>\n"
+			<< "<meta property=\"og:site_name\" content=\"site" << generator() % num_sites << "\"/>\n"
+			<< "</head>\n<body>\n<article>\n<h1>" << title << "</h1>\n<p>" << text << "</p>\n</article>\n</body>\n</html>\n";
+	}
+
+	std::ofstream(path + "/.complete") << num_docs << std::endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+    boost::locale::generator gen;
+	#if defined(__linux__)
+		std::locale ru_boost_locale = gen("ru_RU.UTF-8");
+		std::locale en_boost_locale = gen("en_US.UTF-8");
+	#endif
+
+	#if defined(_WIN64)
+		std::locale ru_boost_locale = gen("russian_russia.65001");
+		std::locale en_boost_locale = gen("english_us.65001");
+		std::locale ru_locale("russian_russia.65001");
+		std::locale::global(ru_locale);
+	#endif
+
+	/// arguments: number of documents, config, directory for generated corpora
+
+	std::size_t num_docs = 10000;
+	std::string config_filename = "assets/default.cfg";
+	std::string work_path = "bench_corpus";
+
+	if (argc > 1)
+	{
+		num_docs = std::atoll(argv[1]);
+	}
+	if (argc > 2)
+	{
+		config_filename = argv[2];
+	}
+	if (argc > 3)
+	{
+		work_path = argv[3];
+	}
+	if (num_docs == 0)
+	{
+		std::cerr << "Number of documents should be positive, f.e. tgnews_bench 10000 assets/default.cfg bench_corpus" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ifstream config_fin(config_filename, std::ifstream::in);
+	json config;
+	if (!config_fin.is_open())
+	{
+		std::cerr << "Cannot open config file: " << config_filename << std::endl;
+		return EXIT_FAILURE;
+	}
+	config_fin >> config;
+
+	std::vector<StageResult> results;
+	auto content_parser = news_clustering::ContentParser();
+
+	std::time_t t = std::time(0);
+	std::tm* now = std::localtime(&t);
+	std::vector<int> today = {now->tm_mday, now->tm_mon + 1, now->tm_year + 1900};
+	unsigned num_threads = std::thread::hardware_concurrency();
+
+	/// vocabs, the same as tgnews does
+
+	auto english_language = news_clustering::Language(news_clustering::ENGLISH_LANGUAGE);
+	auto russian_language = news_clustering::Language(news_clustering::RUSSIAN_LANGUAGE);
+	std::vector<news_clustering::Language> languages = { english_language, russian_language };
+
+	std::unordered_map<news_clustering::Language, std::locale> language_boost_locales;
+	language_boost_locales[english_language] = en_boost_locale;
+	language_boost_locales[russian_language] = ru_boost_locale;
+
+	std::unordered_map<news_clustering::Language, news_clustering::Lemmatizer> lemmatizers;
+	std::unordered_map<news_clustering::Language, news_clustering::TextEmbedder> text_embedders;
+	std::vector<std::string> top_freq_vocab_paths;
+	std::unordered_map<news_clustering::Language, std::string> day_names_path;
+	std::unordered_map<news_clustering::Language, std::string> month_names_path;
+	std::unordered_map<news_clustering::Language, std::vector<std::vector<std::string>>> categories;
+
+	results.push_back(measure("vocabs", 0, 0, [&]()
+	{
+		lemmatizers[english_language] = news_clustering::Lemmatizer();
+		lemmatizers[russian_language] = news_clustering::Lemmatizer(config["ru"]["lemmatizer"], russian_language, "_PROPN");
+		text_embedders[english_language] = news_clustering::TextEmbedder(config["en"]["clusterizer"], lemmatizers[english_language], english_language);
+		text_embedders[russian_language] = news_clustering::TextEmbedder(config["ru"]["clusterizer"], lemmatizers[russian_language], russian_language);
+
+		top_freq_vocab_paths.push_back(config["en"]["top_freq_words"]);
+		top_freq_vocab_paths.push_back(config["ru"]["top_freq_words"]);
+		day_names_path[english_language] = config["en"]["day_names"];
+		day_names_path[russian_language] = config["ru"]["day_names"];
+		month_names_path[english_language] = config["en"]["month_names"];
+		month_names_path[russian_language] = config["ru"]["month_names"];
+		categories[english_language] = content_parser.parse_categories(config["en"]["categories"], en_boost_locale);
+		categories[russian_language] = content_parser.parse_categories(config["ru"]["categories"], en_boost_locale);
+	}));
+
+	/// synthetic corpus, generated once for the each size
+
+	auto corpus_path = work_path + "/" + std::to_string(num_docs);
+	if (!fs::exists(corpus_path + "/.complete"))
+	{
+		std::unordered_map<news_clustering::Language, GeneratorVocab> vocabs;
+		for (std::size_t i = 0; i < languages.size(); i++)
+		{
+			auto& language = languages[i];
+			vocabs[language] = generator_vocab(text_embedders[language], language, language_boost_locales[language], top_freq_vocab_paths[i], month_names_path[language]);
+			auto& vocab = vocabs[language];
+			if (vocab.frequent.empty() || vocab.words.size() < 100 || vocab.names.size() < 10 || vocab.month_names.size() < 12)
+			{
+				std::cerr << "Not enough words in the vocabs for the language: " << language.to_string() << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+
+		std::cout << "Generating " << num_docs << " documents to " << corpus_path << std::endl;
+		results.push_back(measure("generate", num_docs, 0, [&]()
+		{
+			generate_corpus(corpus_path, num_docs, languages, vocabs, today);
+		}));
+	}
+
+	/// stages
+
+	news_clustering::Corpus corpus;
+	news_clustering::DocIds language_docs;
+	news_clustering::DocIds news_docs;
+	news_clustering::Threads threads;
+	std::size_t total_bytes = 0;
+
+	auto total_start_rss_kb = current_rss_kb();
+	auto total_start = std::chrono::steady_clock::now();
+
+	for (const auto& file_name : content_parser.selectHtmlFiles(corpus_path))
+	{
+		corpus.add(file_name);
+	}
+
+	results.push_back(measure("parse", corpus.size(), 0, [&]()
+	{
+		std::vector<std::thread> workers;
+		std::vector<std::size_t> worker_bytes(num_threads, 0);
+		for (unsigned w = 0; w < num_threads; w++)
+		{
+			workers.emplace_back(
+				[w, num_threads, &corpus, &content_parser, &worker_bytes]()
+				{
+					for (news_clustering::DocId i = w; i < corpus.size(); i += num_threads)
+					{
+						auto bytes = content_parser.read_file(corpus.path(i));
+						corpus.set_tokens(i, content_parser.parse_content(bytes, ' ', 1));
+						worker_bytes[w] += bytes.size();
+						corpus.set_raw(i, std::move(bytes));
+					}
+				}
+			);
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		for (auto bytes : worker_bytes)
+		{
+			total_bytes += bytes;
+		}
+	}));
+	results.back().bytes = total_bytes;
+
+	results.push_back(measure("languages", corpus.size(), total_bytes, [&]()
+	{
+		auto language_detector = news_clustering::LanguageDetector(languages, top_freq_vocab_paths, language_boost_locales);
+		auto found_languages = language_detector.detect_language(corpus, corpus.ids(), 300, 0.1);
+		for (auto i = found_languages.begin(); i != found_languages.end(); i++)
+		{
+			if (i->first.id() != news_clustering::UNKNOWN_LANGUAGE)
+			{
+				language_docs.insert(language_docs.end(), i->second.begin(), i->second.end());
+			}
+		}
+	}));
+
+	results.push_back(measure("entities", language_docs.size(), 0, [&]()
+	{
+		auto ner = news_clustering::NER(languages, text_embedders, language_boost_locales);
+		ThreadPool pool(num_threads);
+		ner.find_name_entities(corpus, language_docs, pool);
+		pool.close();
+	}));
+
+	results.push_back(measure("titles", language_docs.size(), total_bytes, [&]()
+	{
+		auto title_extractor = news_clustering::TitleExtractor(language_boost_locales);
+		ThreadPool pool(num_threads);
+		title_extractor.find_titles(corpus, language_docs, pool);
+		pool.close();
+		for (news_clustering::DocId i = 0; i < corpus.size(); i++)
+		{
+			corpus.release_raw(i);
+		}
+	}));
+
+	results.push_back(measure("dates", language_docs.size(), 0, [&]()
+	{
+		auto dates_extractor = news_clustering::DatesExtractor(languages, language_boost_locales, day_names_path, month_names_path, today[2]);
+		dates_extractor.find_dates(corpus, language_docs);
+	}));
+
+	results.push_back(measure("news", language_docs.size(), 0, [&]()
+	{
+		auto news_detector = news_clustering::NewsDetector(languages, language_boost_locales, today);
+		news_docs = news_detector.detect_news(corpus, language_docs, 180, 1)[true];
+	}));
+
+	results.push_back(measure("embeddings", news_docs.size(), 0, [&]()
+	{
+		for (auto doc : news_docs)
+		{
+			text_embedders[corpus.languages[doc]].embed(corpus, doc, language_boost_locales[corpus.languages[doc]]);
+		}
+	}));
+
+	results.push_back(measure("categories", news_docs.size(), 0, [&]()
+	{
+		auto categories_detector = news_clustering::CategoriesDetector(languages, text_embedders, language_boost_locales, categories);
+		std::unordered_map<news_clustering::Language, std::vector<float>> category_detect_levels;
+		category_detect_levels[english_language] = {0.02, 0.02, 0.02, 0.02, 0.02, 0.04};
+		category_detect_levels[russian_language] = {0.05, 0.02, 0.15, 0.02, 0.15, 0.15};
+		categories_detector.detect_categories(corpus, news_docs, category_detect_levels);
+	}));
+
+	results.push_back(measure("threads", news_docs.size(), 0, [&]()
+	{
+		auto news_clusterizer = news_clustering::NewsClusterizer(languages, text_embedders, language_boost_locales);
+		threads = news_clusterizer.clusterize(corpus, news_docs, 12, 2, 0.5, 1000);
+	}));
+
+	results.push_back(measure("ranking", news_docs.size(), 0, [&]()
+	{
+		auto news_ranger = news_clustering::NewsRanger(languages, text_embedders, language_boost_locales, today);
+		news_ranger.arrange_top_k(corpus, threads, threads.size());
+	}));
+
+	auto total_end = std::chrono::steady_clock::now();
+	results.push_back({ "end-to-end", std::chrono::duration<double>(total_end - total_start).count(), corpus.size(), total_bytes, current_rss_kb() - total_start_rss_kb, peak_rss_kb() });
+
+	/// report
+
+	std::cout << "documents: " << corpus.size() << ", languages: " << language_docs.size() << ", news: " << news_docs.size()
+		<< ", threads: " << threads.size() << ", workers: " << num_threads << std::endl;
+	std::cout << std::left << std::setw(12) << "stage" << std::right
+		<< std::setw(12) << "seconds" << std::setw(14) << "docs/s" << std::setw(10) << "MB/s" << std::setw(14) << "RSS delta MB" << std::setw(18) << "process peak MB" << std::endl;
+	for (const auto& result : results)
+	{
+		std::cout << std::left << std::setw(12) << result.name << std::right << std::fixed
+			<< std::setw(12) << std::setprecision(3) << result.seconds
+			<< std::setw(14) << std::setprecision(0) << (result.seconds > 0 ? result.docs / result.seconds : 0)
+			<< std::setw(10) << std::setprecision(1) << (result.seconds > 0 ? result.bytes / result.seconds / (1 << 20) : 0)
+			<< std::setw(14) << std::setprecision(1) << result.rss_delta_kb / 1024.0
+			<< std::setw(18) << std::setprecision(1) << result.peak_rss_kb / 1024.0 << std::endl;
+	}
+
+	return 0;
+}